@@ -74,13 +74,11 @@ int main(int argc, char **argv)
     const int t = ts+k;
     tracker.set_current_timestep(t);
 
-    ftk::ndarray<double> scalar0 = nitrz0.slice({0, 0, ts+k}, {DW, DH, 1}); // unpreconditioned data
-    scalar0.reshape({DW, DH});
+    auto scalar0 = nitrz0.slice_time_view(ts+k); // unpreconditioned data
 #if GAUSSIAN_TIME
-    ftk::ndarray<double> scalar = nitrz.slice({0, 0, ts+k}, {DW, DH, 1});
-    scalar.reshape({DW, DH});
+    auto scalar = nitrz.slice_time_view(ts+k);
 #else
-    auto scalar = ftk::conv2D_gaussian(scalar0, 4.0/*sigma*/, 5/*ksizex*/, 5/*ksizey*/, 2/*padding*/);
+    auto scalar = ftk::conv2D_gaussian(ftk::ndarray<double>(scalar0), 4.0/*sigma*/, 5/*ksizex*/, 5/*ksizey*/, 2/*padding*/);
     // auto scalar = ftk::conv2D_gaussian(scalar, 1000.0/*sigma*/, 31/*ksizex*/, 31/*ksizey*/, 15/*padding*/);
 #endif
 
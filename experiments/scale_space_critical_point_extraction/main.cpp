@@ -1,6 +1,70 @@
 #include <iostream>
+#include <random>
+#include <ftk/filters/critical_point_tracker_2d_scale_space.hh>
+#include <ftk/ndarray/synthetic.hh>
+#include "ftk/external/cxxopts.hpp"
+
+// This experiment tracks critical points of a 2D scalar field across
+// scales, in order to pick the smoothing parameters for production runs.
+// The input is either a raw float64 file or a noisy synthetic field.
+// Each trajectory is printed with its time coordinate being the level
+// index; the sigmas of the levels are printed to stderr.
 
 int main(int argc, char **argv)
 {
+  diy::mpi::environment env(argc, argv);
+
+  std::string input_filename, output_filename;
+  int DW = 128, DH = 128, nlevels = 16;
+  double sigma0 = 0.5, sigma1 = 16.0, search_radius = 1.0, noise = 0.1;
+
+  cxxopts::Options options(argv[0]);
+  options.add_options()
+    ("i,input", "Input file (raw float64); synthetic data if not given",
+     cxxopts::value<std::string>(input_filename))
+    ("w,width", "Width", cxxopts::value<int>(DW))
+    ("h,height", "Height", cxxopts::value<int>(DH))
+    ("noise", "Amplitude of the noise added to the synthetic data",
+     cxxopts::value<double>(noise))
+    ("sigma0", "Finest scale", cxxopts::value<double>(sigma0))
+    ("sigma1", "Coarsest scale", cxxopts::value<double>(sigma1))
+    ("levels", "Number of scale levels", cxxopts::value<int>(nlevels))
+    ("search-radius", "Search radius around coarse critical points, in multiples of sigma; 0 for exhaustive sweeps",
+     cxxopts::value<double>(search_radius))
+    ("o,output", "Output file", cxxopts::value<std::string>(output_filename));
+  options.parse(argc, argv);
+
+  ftk::ndarray<double> scalar;
+  if (input_filename.empty()) {
+    scalar = ftk::synthetic_woven_2D<double>(DW, DH);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> dist(-noise, noise);
+    for (size_t i = 0; i < scalar.nelem(); i ++)
+      scalar[i] += dist(gen);
+  } else {
+    scalar.reshape(DW, DH);
+    scalar.from_binary_file(input_filename);
+  }
+
+  ftk::critical_point_tracker_2d_scale_space tracker(argc, argv);
+  tracker.set_domain(ftk::lattice({2, 2}, {size_t(DW-3), size_t(DH-3)}));
+  tracker.set_array_domain(ftk::lattice({0, 0}, {size_t(DW), size_t(DH)}));
+  tracker.set_input_array_partial(false);
+  tracker.set_scales(sigma0, sigma1, nlevels);
+  tracker.set_search_radius(search_radius);
+  tracker.initialize();
+
+  tracker.push_scalar_field(scalar);
+  tracker.update();
+  tracker.finalize();
+
+  for (int t = 0; t < tracker.get_num_levels(); t ++)
+    fprintf(stderr, "level=%d, sigma=%f\n", t, tracker.get_scale(t));
+
+  if (output_filename.empty())
+    tracker.write_traced_critical_points_text(std::cout);
+  else
+    tracker.write_traced_critical_points(output_filename);
+
   return 0;
 }
@@ -0,0 +1,92 @@
+#ifndef _FTK_COMPONENT_ATTRIBUTES_HH
+#define _FTK_COMPONENT_ATTRIBUTES_HH
+
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+
+namespace ftk {
+
+// Feature attributes of a connected component: its volume (number of
+// elements), centroid, and bounding box in grid coordinates, and the
+// range and mean of a scalar field over the component.  Attributes are
+// accumulated element by element, and partial attributes of parts of a
+// component, e.g. from different threads, are combined with merge().
+struct component_attributes {
+  size_t volume = 0;
+  double coord_sum[3] = {0, 0, 0};
+  size_t lb[3] = {std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max(), std::numeric_limits<size_t>::max()},
+         ub[3] = {0, 0, 0}; // inclusive
+  double min = std::numeric_limits<double>::max(),
+         max = -std::numeric_limits<double>::max(),
+         sum = 0;
+
+  double centroid(int i) const {return volume ? coord_sum[i] / volume : 0.0;}
+  double mean() const {return volume ? sum / volume : 0.0;}
+
+  void add(size_t x, size_t y, size_t z) {
+    const size_t c[3] = {x, y, z};
+    volume ++;
+    for (int i = 0; i < 3; i ++) {
+      coord_sum[i] += c[i];
+      lb[i] = std::min(lb[i], c[i]);
+      ub[i] = std::max(ub[i], c[i]);
+    }
+  }
+
+  void add(size_t x, size_t y, size_t z, double value) {
+    add(x, y, z);
+    add_value(value);
+  }
+
+  void add_run(size_t x0, size_t x1, size_t y, size_t z) { // elements x0 <= x < x1 of a row
+    const size_t n = x1 - x0;
+    volume += n;
+    coord_sum[0] += 0.5 * double(x0 + x1 - 1) * n;
+    coord_sum[1] += double(y) * n;
+    coord_sum[2] += double(z) * n;
+    lb[0] = std::min(lb[0], x0);
+    ub[0] = std::max(ub[0], x1 - 1);
+    lb[1] = std::min(lb[1], y);
+    ub[1] = std::max(ub[1], y);
+    lb[2] = std::min(lb[2], z);
+    ub[2] = std::max(ub[2], z);
+  }
+
+  void add_value(double value) { // of an element added by add_run
+    min = std::min(min, value);
+    max = std::max(max, value);
+    sum += value;
+  }
+
+  void merge(const component_attributes& a) {
+    volume += a.volume;
+    for (int i = 0; i < 3; i ++) {
+      coord_sum[i] += a.coord_sum[i];
+      lb[i] = std::min(lb[i], a.lb[i]);
+      ub[i] = std::max(ub[i], a.ub[i]);
+    }
+    min = std::min(min, a.min);
+    max = std::max(max, a.max);
+    sum += a.sum;
+  }
+
+  void translate(size_t dx, size_t dy, size_t dz) { // e.g. from the coordinates of a block
+    const size_t d[3] = {dx, dy, dz};
+    for (int i = 0; i < 3; i ++) {
+      coord_sum[i] += double(d[i]) * volume;
+      lb[i] += d[i];
+      ub[i] += d[i];
+    }
+  }
+
+  void swap_coords(int i, int j) { // e.g. to reorder the axes of the grid
+    std::swap(coord_sum[i], coord_sum[j]);
+    std::swap(lb[i], lb[j]);
+    std::swap(ub[i], ub[j]);
+  }
+};
+
+}
+
+#endif
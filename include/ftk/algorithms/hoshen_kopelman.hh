@@ -12,7 +12,7 @@ LabelIdType hoshen_kopelman_2d(ndarray<LabelIdType>& matrix)
   LabelIdType largest_label = 0;
 
   if (matrix.nd() != 2) return 0;
-  std::vector<LabelIdType> labels(matrix.nelem() / 2);
+  std::vector<LabelIdType> labels(matrix.nelem() / 2 + 2); // the counter and at most ceil(n/2) labels
 
   auto make_set = [&]() {
     labels[0] ++;
@@ -0,0 +1,297 @@
+#ifndef _FTK_PARALLEL_CCL_HH
+#define _FTK_PARALLEL_CCL_HH
+
+#include <ftk/ndarray.hh>
+#include <ftk/basic/concurrent_union_find.hh>
+#include <ftk/algorithms/component_attributes.hh>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cstdint>
+
+// Connected component labeling of binary arrays with threads.  Nonzero
+// elements are foreground; components are 4-connected in 2D and
+// 6-connected in 3D (face neighbors).  As in hoshen_kopelman_2d, the array
+// is relabeled in place with 1 ... n, numbered in the raster order of the
+// first element of each component, and n is returned.
+//
+// The array is split into slabs (strips of rows in 2D) along the slowest
+// dimension.  Each thread labels a slab in two passes, with a label table
+// that grows with the provisional labels of the slab, and numbers its
+// components densely; the components of all slabs are then merged across
+// the faces between slabs with a concurrent union-find, and slabs are
+// relabeled in parallel.
+//
+// The first pass follows a decision tree over the left, up, and front
+// neighbors: two labeled neighbors that share a foreground neighbor have
+// been united already, so that only the unions that may connect different
+// provisional labels are made.
+
+// Reference
+  // Paper: "Optimized Block-based Connected Components Labeling with Decision Trees" (BBDT)
+  // Paper: "Spaghetti Labeling: Directed Acyclic Graphs for Block-Based Connected Components Labeling"
+
+namespace ftk {
+
+// runs f(0) ... f(n-1) on up to nthreads threads
+inline void parallel_ccl_for(size_t n, int nthreads, const std::function<void(size_t)>& f)
+{
+  const size_t nworkers = std::min(n, size_t(std::max(nthreads, 1)));
+  if (nworkers <= 1) {
+    for (size_t i = 0; i < n; i ++) f(i);
+    return;
+  }
+
+  std::vector<std::thread> workers;
+  for (size_t k = 0; k < nworkers; k ++)
+    workers.push_back(std::thread([&, k]() {
+      for (size_t i = k; i < n; i += nworkers) f(i);
+    }));
+  for (auto &w : workers) w.join();
+}
+
+// labels z in [z0, z1) of an nx*ny*nz volume, of which fg(i) tells if the
+// i-th element is foreground; returns the number of components within the
+// slab, labeled 1 ... n in raster order, and background is set to 0.  If
+// attrs is given, the attributes of the components in the slab, with the
+// values of the field if given, are accumulated in the second pass.
+template <typename LabelIdType, typename Foreground, typename ValueType>
+size_t ccl_3d_slab(const Foreground& fg, LabelIdType *m, size_t nx, size_t ny, size_t z0, size_t z1,
+    const ValueType *values, std::vector<component_attributes> *attrs)
+{
+  const size_t sx = 1, sy = nx, sz = nx * ny;
+  std::vector<uint32_t> parent(1, 0); // provisional labels start from 1
+
+  auto find = [&](uint32_t x) {
+    while (parent[x] != x) {
+      parent[x] = parent[parent[x]];
+      x = parent[x];
+    }
+    return x;
+  };
+
+  auto unite = [&](uint32_t x, uint32_t y) { // the smaller root is kept
+    x = find(x);
+    y = find(y);
+    if (x < y) parent[y] = x;
+    else if (y < x) parent[x] = y;
+  };
+
+  // first pass
+  for (size_t z = z0; z < z1; z ++)
+    for (size_t y = 0; y < ny; y ++) {
+      LabelIdType *row = m + z * sz + y * sy;
+      for (size_t x = 0; x < nx; x ++) {
+        LabelIdType *p = row + x;
+        if (!fg(p - m)) {
+          *p = 0;
+          continue;
+        }
+
+        const bool has_left = x > 0, has_up = y > 0, has_front = z > z0;
+        const LabelIdType left = has_left ? p[-sx] : 0,
+                          up = has_up ? p[-sy] : 0,
+                          front = has_front ? p[-sz] : 0;
+
+        if (left) {
+          *p = left;
+          if (up && up != left && !p[-sx-sy]) unite(left, up); // otherwise connected through up-left
+          if (front && front != left && !p[-sx-sz]) unite(left, front); // ... through front-left
+        } else if (up) {
+          *p = up;
+          if (front && front != up && !p[-sy-sz]) unite(up, front); // ... through front-up
+        } else if (front) {
+          *p = front;
+        } else {
+          *p = parent.size();
+          parent.push_back(parent.size());
+        }
+      }
+    }
+
+  // second pass
+  std::vector<uint32_t> new_labels(parent.size(), 0);
+  size_t n = 0;
+  if (attrs) attrs->clear();
+  for (size_t z = z0; z < z1; z ++)
+    for (size_t y = 0; y < ny; y ++) {
+      const size_t i0 = z * sz + y * sy;
+      LabelIdType *row = m + i0;
+      LabelIdType last = 0, last_new = 0; // voxels in runs share labels
+      size_t run_begin = 0; // geometry is accumulated by runs
+      LabelIdType run_label = 0;
+      for (size_t x = 0; x < nx; x ++) {
+        if (!row[x]) {
+          if (attrs && run_label) {
+            (*attrs)[run_label - 1].add_run(run_begin, x, y, z);
+            run_label = 0;
+          }
+          continue;
+        }
+        if (row[x] != last) {
+          last = row[x];
+          const uint32_t r = find(last);
+          if (new_labels[r] == 0) {
+            new_labels[r] = ++ n;
+            if (attrs) attrs->push_back(component_attributes());
+          }
+          last_new = new_labels[r];
+        }
+        row[x] = last_new;
+
+        if (attrs) {
+          if (last_new != run_label) {
+            if (run_label) (*attrs)[run_label - 1].add_run(run_begin, x, y, z);
+            run_begin = x;
+            run_label = last_new;
+          }
+          if (values) (*attrs)[last_new - 1].add_value(values[i0 + x]);
+        }
+      }
+      if (attrs && run_label) (*attrs)[run_label - 1].add_run(run_begin, nx, y, z);
+    }
+  return n;
+}
+
+// labels an nx*ny*nz volume in slabs along z; attributes of the
+// components, if requested, are merged from the partials of the slabs
+template <typename LabelIdType, typename Foreground, typename ValueType=double>
+LabelIdType parallel_ccl_slabs(const Foreground& fg, LabelIdType *m, size_t nx, size_t ny, size_t nz, int nthreads,
+    const ValueType *values = NULL, std::vector<component_attributes> *attrs = NULL)
+{
+  const size_t sz = nx * ny;
+  if (sz * nz == 0) return 0;
+
+  const size_t nslabs = std::min(nz, size_t(std::max(nthreads, 1)));
+  std::vector<size_t> zs(nslabs + 1);
+  for (size_t s = 0; s <= nslabs; s ++)
+    zs[s] = nz * s / nslabs;
+
+  // label slabs independently
+  std::vector<size_t> offsets(nslabs + 1, 0); // of the components of each slab
+  std::vector<std::vector<component_attributes>> slab_attrs(attrs ? nslabs : 0);
+  parallel_ccl_for(nslabs, nthreads, [&](size_t s) {
+    offsets[s+1] = ccl_3d_slab(fg, m, nx, ny, zs[s], zs[s+1], values, attrs ? &slab_attrs[s] : NULL);
+  });
+  for (size_t s = 0; s < nslabs; s ++)
+    offsets[s+1] += offsets[s];
+
+  if (nslabs == 1) {
+    if (attrs) attrs->swap(slab_attrs[0]);
+    return offsets[1];
+  }
+
+  // merge components across faces between slabs
+  concurrent_union_find uf(offsets[nslabs]);
+  parallel_ccl_for(nslabs - 1, nthreads, [&](size_t f) {
+    const size_t s = f + 1;
+    const LabelIdType *below = m + (zs[s] - 1) * sz, *above = m + zs[s] * sz;
+    for (size_t i = 0; i < sz; i ++) {
+      if (!below[i] || !above[i]) continue;
+      if (i % nx > 0 && below[i-1] && above[i-1]) continue; // united with the left pair
+      uf.unite(offsets[s-1] + below[i] - 1, offsets[s] + above[i] - 1);
+    }
+  });
+
+  // components are numbered by their smallest ids, which are in raster
+  // order; roots are the largest ids in their sets
+  std::vector<LabelIdType> final_labels(offsets[nslabs], 0);
+  LabelIdType n = 0;
+  for (size_t i = 0; i < final_labels.size(); i ++) {
+    const uint64_t r = uf.find(i);
+    if (final_labels[r] == 0) final_labels[r] = ++ n;
+    final_labels[i] = final_labels[r];
+  }
+
+  parallel_ccl_for(nslabs, nthreads, [&](size_t s) {
+    const LabelIdType *labels = final_labels.data() + offsets[s];
+    for (size_t i = zs[s] * sz; i < zs[s+1] * sz; i ++)
+      if (m[i]) m[i] = labels[m[i] - 1];
+  });
+
+  if (attrs) {
+    attrs->assign(n, component_attributes());
+    for (size_t s = 0; s < nslabs; s ++)
+      for (size_t j = 0; j < slab_attrs[s].size(); j ++)
+        (*attrs)[final_labels[offsets[s] + j] - 1].merge(slab_attrs[s][j]);
+  }
+
+  return n;
+}
+
+// 4-connected components of a 2D array, labeled in strips of rows; the
+// same labels as hoshen_kopelman_2d
+template <typename LabelIdType>
+LabelIdType parallel_ccl_2d(ndarray<LabelIdType>& matrix,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  if (matrix.nd() != 2) return 0;
+  const LabelIdType *m = matrix.data();
+  auto fg = [m](size_t i) {return m[i] != 0;};
+  return parallel_ccl_slabs(fg, matrix.data(), matrix.dim(0), 1, matrix.dim(1), nthreads);
+}
+
+template <typename LabelIdType>
+LabelIdType parallel_ccl_3d(ndarray<LabelIdType>& matrix,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  if (matrix.nd() != 3) return 0;
+  const LabelIdType *m = matrix.data();
+  auto fg = [m](size_t i) {return m[i] != 0;};
+  return parallel_ccl_slabs(fg, matrix.data(), matrix.dim(0), matrix.dim(1), matrix.dim(2), nthreads);
+}
+
+// Labels the set bits of a packed bitmask of a 2D or 3D shape into a
+// separate array of nelem elements, without unpacking the mask.  If attrs
+// is given, it gets the attributes of each component (of label l at l-1),
+// with the range and mean of values if given.
+template <typename LabelIdType, typename ValueType=double>
+LabelIdType parallel_ccl_bitmask(const std::vector<uint64_t>& bits, const std::vector<size_t>& shape,
+    LabelIdType *labels, int nthreads = std::thread::hardware_concurrency(),
+    const ValueType *values = NULL, std::vector<component_attributes> *attrs = NULL)
+{
+  const uint64_t *b = bits.data();
+  auto fg = [b](size_t i) {return (b[i >> 6] >> (i & 63)) & 1;};
+  if (shape.size() == 2) {
+    const LabelIdType n = parallel_ccl_slabs(fg, labels, shape[0], 1, shape[1], nthreads, values, attrs);
+    if (attrs) // rows are slabs along the third axis
+      for (auto &a : *attrs) a.swap_coords(1, 2);
+    return n;
+  } else if (shape.size() == 3)
+    return parallel_ccl_slabs(fg, labels, shape[0], shape[1], shape[2], nthreads, values, attrs);
+  else return 0;
+}
+
+// Packs Compare()(a[i], threshold) of n values into bits, 64 per word and
+// the first value in the lowest bit.  The comparison, e.g.
+// std::greater_equal<double>, is resolved at compile time, and words are
+// filled without branches so that the compares are vectorized.
+template <typename Compare, typename T>
+void threshold_bitmask(const T *a, size_t n, double threshold, std::vector<uint64_t>& bits,
+    int nthreads = std::thread::hardware_concurrency())
+{
+  const size_t nwords = (n + 63) / 64;
+  bits.resize(nwords);
+
+  const size_t nchunks = std::max(nthreads, 1);
+  parallel_ccl_for(nchunks, nthreads, [&](size_t c) {
+    const Compare cmp = Compare();
+    for (size_t w = nwords * c / nchunks; w < nwords * (c+1) / nchunks; w ++) {
+      const T *q = a + w * 64;
+      uint64_t word = 0;
+      if (n - w * 64 >= 64) {
+        for (int k = 0; k < 64; k ++)
+          word |= uint64_t(cmp(double(q[k]), threshold)) << k;
+      } else {
+        for (size_t k = 0; k < n - w * 64; k ++)
+          word |= uint64_t(cmp(double(q[k]), threshold)) << k;
+      }
+      bits[w] = word;
+    }
+  });
+}
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef _FTK_CONCURRENT_UNION_FIND_H
+#define _FTK_CONCURRENT_UNION_FIND_H
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <ftk/basic/integer_union_find.hh>
+
+// Lock-free union-find over ids in [0, n), for threads uniting elements
+// concurrently.  Parents are atomic; a root is linked under the larger of
+// the two roots with a compare-and-swap, so that ids strictly increase
+// along every path.  Find is wait-free: paths only shrink, by path
+// splitting, and each step moves to a larger id.  Unite retries only if
+// another thread linked one of the roots in the meantime.
+//
+// The number of elements is fixed at construction; get_sets may only be
+// called when no other thread is uniting.
+
+// Reference
+  // Paper: "A Randomized Concurrent Algorithm for Disjoint Set Union"
+  // Paper: "Wait-free Parallel Algorithms for the Union-Find Problem"
+
+namespace ftk {
+
+struct concurrent_union_find
+{
+  concurrent_union_find(size_t n = 0) {reset(n);}
+
+  // Initialization; not thread-safe
+  void reset(size_t n) {
+    n_ = n;
+    parent.reset(new std::atomic<uint64_t>[n]);
+    for (size_t i = 0; i < n; i ++)
+      parent[i].store(i, std::memory_order_relaxed);
+  }
+  size_t size() const {return n_;}
+
+  // Operations; thread-safe
+
+  // Returns false if already in the same set
+  bool unite(uint64_t i, uint64_t j) {
+    while (true) {
+      i = find(i);
+      j = find(j);
+      if (i == j) return false;
+      if (i > j) std::swap(i, j);
+
+      uint64_t expected = i; // link the smaller root if it is still a root
+      if (parent[i].compare_exchange_strong(expected, j, std::memory_order_acq_rel))
+        return true;
+    }
+  }
+
+  // Queries; thread-safe
+
+  // Find the root of an element.
+    // Path compression by path splitting with compare-and-swap
+  uint64_t find(uint64_t i) {
+    while (true) {
+      uint64_t p = parent[i].load(std::memory_order_acquire);
+      if (p == i) return i;
+      const uint64_t g = parent[p].load(std::memory_order_acquire);
+      if (p != g) // fails harmlessly if another thread has shortened the path
+        parent[i].compare_exchange_weak(p, g, std::memory_order_acq_rel);
+      i = p;
+    }
+  }
+
+  bool same_set(uint64_t i, uint64_t j) {
+    while (true) {
+      i = find(i);
+      j = find(j);
+      if (i == j) return true;
+      if (parent[i].load(std::memory_order_acquire) == i) return false; // i was still a root
+    }
+  }
+
+  // Get sets of elements in CSR form, as dense_union_find::get_sets: the
+  // k-th set is ids[offsets[k]] ... ids[offsets[k+1]-1] in increasing
+  // order, and sets are ordered by their smallest members.
+  size_t get_sets(std::vector<size_t>& offsets, std::vector<uint64_t>& ids);
+
+private:
+  size_t n_ = 0;
+  std::unique_ptr<std::atomic<uint64_t>[]> parent;
+};
+
+/////
+inline size_t concurrent_union_find::get_sets(std::vector<size_t>& offsets, std::vector<uint64_t>& ids)
+{
+  return get_union_find_sets<uint64_t>(n_,
+      [this](uint64_t i) {return find(i);}, offsets, ids);
+}
+
+}
+
+#endif
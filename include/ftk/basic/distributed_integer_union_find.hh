@@ -0,0 +1,311 @@
+#ifndef _FTK_DISTRIBUTED_INTEGER_UNION_FIND_H
+#define _FTK_DISTRIBUTED_INTEGER_UNION_FIND_H
+
+#include <ftk/ftk_config.hh>
+#include <ftk/basic/integer_union_find.hh>
+#include <ftk/external/diy/mpi.hpp>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstdio>
+
+// Union-find with distributed-memory parallelism over 64-bit element ids.
+// Each element is owned by the process given by the owner function.
+// Processes unite pairs of elements, either of which may be owned by
+// another process, and then call exchange(), after which the root of
+// every element is the smallest id in its set.
+//
+// Unions are first applied locally, so that only one edge per pair of
+// local set and remote element is left.  exchange() then alternates in
+// bulk-synchronous rounds between pointer jumping, until every element
+// points to a root, and hooking the larger root of each remaining edge to
+// the smaller one.  In every round, all ids sent to the same process are
+// aggregated in one buffer and exchanged with a single all-to-all.
+
+// Reference
+  // Paper: "Evaluation of connected-component labeling algorithms for distributed-memory systems"
+  // Paper: "An O(log n) parallel connectivity algorithm" (Shiloach and Vishkin)
+
+namespace ftk {
+
+struct distributed_integer_union_find
+{
+  distributed_integer_union_find(const diy::mpi::communicator& comm_, std::function<int(uint64_t)> owner_)
+    : comm(comm_), owner(owner_) {}
+
+  // Initialization
+  void add(uint64_t i) {slot(i);} // adds a singleton, e.g. an owned element without unions
+
+  // Operations
+  void unite(uint64_t i, uint64_t j) {
+    slot(i);
+    slot(j);
+    local.unite(i, j);
+  }
+
+  void exchange(); // collective; after all unions
+
+  // Queries, after exchange
+  bool has(uint64_t i) const {return local.has(i);}
+  uint64_t find(uint64_t i) const; // of an owned element
+
+  // owned elements and their roots
+  void get_roots(std::vector<uint64_t>& ids, std::vector<uint64_t>& roots) const;
+
+  struct statistics {
+    int hook_rounds = 0, jump_rounds = 0;
+    uint64_t messages_sent = 0, bytes_sent = 0; // by this process
+  } stats;
+
+  void print_stats(FILE *fp = stderr) const; // collective; totals of all processes
+
+protected:
+  bool is_owned(uint64_t i) const {return owner(i) == comm.rank();}
+  uint32_t slot(uint64_t i) { // adds i if new
+    const uint32_t k = local.add(i);
+    if (k >= parent.size()) parent.push_back(i);
+    return k;
+  }
+
+  void contract(); // applies unions locally, leaving edges across processes
+  bool jump(); // one round of pointer jumping; false if all elements point to roots
+  size_t hook(); // one round of hooking; returns the number of hooks sent
+
+  // the current parents of ids (sorted and unique) owned by any process
+  void query(const std::vector<uint64_t>& ids, std::vector<uint64_t>& parents);
+
+  // sends a buffer to each process and receives those sent to this one
+  void all_to_all(const std::vector<std::vector<uint64_t>>& out,
+      std::vector<uint64_t>& in, std::vector<int>& in_counts);
+
+protected:
+  diy::mpi::communicator comm;
+  std::function<int(uint64_t)> owner;
+
+  sparse_union_find<uint64_t> local; // elements known to this process, and local unions
+  std::vector<uint64_t> parent; // global parent of each owned element, by local id
+  std::vector<std::pair<uint64_t, uint64_t>> edges; // unions left to other processes
+};
+
+///////
+inline uint64_t distributed_integer_union_find::find(uint64_t i) const
+{
+  const uint32_t k = local.id(i);
+  return k == local.none ? i : parent[k];
+}
+
+inline void distributed_integer_union_find::get_roots(std::vector<uint64_t>& ids, std::vector<uint64_t>& roots) const
+{
+  ids.clear();
+  roots.clear();
+  for (size_t k = 0; k < local.size(); k ++)
+    if (is_owned(local.key(k))) {
+      ids.push_back(local.key(k));
+      roots.push_back(parent[k]);
+    }
+}
+
+inline void distributed_integer_union_find::exchange()
+{
+  contract();
+
+  while (true) {
+    while (jump())
+      stats.jump_rounds ++;
+
+    const uint64_t nhooks = hook();
+    uint64_t total_hooks;
+    diy::mpi::all_reduce(comm, nhooks, total_hooks, std::plus<uint64_t>());
+    if (total_hooks == 0) break;
+    stats.hook_rounds ++;
+  }
+}
+
+inline void distributed_integer_union_find::contract()
+{
+  std::vector<size_t> offsets;
+  std::vector<uint32_t> ids;
+  const size_t nsets = local.dense().get_sets(offsets, ids);
+
+  for (size_t s = 0; s < nsets; s ++) {
+    uint64_t rep = 0;
+    bool has_owned = false;
+    for (size_t j = offsets[s]; j < offsets[s+1]; j ++) {
+      const uint64_t i = local.key(ids[j]);
+      if (is_owned(i) && (!has_owned || i < rep)) {
+        rep = i;
+        has_owned = true;
+      }
+    }
+
+    for (size_t j = offsets[s]; j < offsets[s+1]; j ++) {
+      const uint64_t i = local.key(ids[j]);
+      if (has_owned && is_owned(i)) parent[ids[j]] = rep;
+      else if (!has_owned && j == offsets[s]) rep = i; // the set is connected through its first element
+      else if (i != rep) edges.push_back(std::make_pair(std::min(rep, i), std::max(rep, i)));
+    }
+  }
+
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+}
+
+inline bool distributed_integer_union_find::jump()
+{
+  // parents are smaller than elements; owned chains are followed locally
+  std::vector<uint64_t> remote;
+  for (size_t k = 0; k < local.size(); k ++) {
+    if (!is_owned(local.key(k))) continue;
+    uint64_t p = parent[k];
+    while (is_owned(p)) {
+      const uint64_t pp = find(p); // p may only be known as a root
+      if (pp == p) break;
+      p = pp;
+    }
+    parent[k] = p;
+    if (!is_owned(p)) remote.push_back(p);
+  }
+
+  std::sort(remote.begin(), remote.end());
+  remote.erase(std::unique(remote.begin(), remote.end()), remote.end());
+  std::vector<uint64_t> grandparents;
+  query(remote, grandparents);
+
+  uint64_t changes = 0;
+  for (size_t k = 0; k < local.size(); k ++) {
+    if (!is_owned(local.key(k)) || is_owned(parent[k])) continue;
+    const size_t r = std::lower_bound(remote.begin(), remote.end(), parent[k]) - remote.begin();
+    if (grandparents[r] != parent[k]) {
+      parent[k] = grandparents[r];
+      changes ++;
+    }
+  }
+
+  uint64_t total_changes;
+  diy::mpi::all_reduce(comm, changes, total_changes, std::plus<uint64_t>());
+  return total_changes > 0;
+}
+
+inline size_t distributed_integer_union_find::hook()
+{
+  // edges are replaced by their roots, which are connected to the original ends
+  std::vector<uint64_t> ends;
+  for (const auto &e : edges) {
+    ends.push_back(e.first);
+    ends.push_back(e.second);
+  }
+  std::sort(ends.begin(), ends.end());
+  ends.erase(std::unique(ends.begin(), ends.end()), ends.end());
+  std::vector<uint64_t> roots;
+  query(ends, roots);
+
+  auto root = [&](uint64_t i) {
+    return roots[std::lower_bound(ends.begin(), ends.end(), i) - ends.begin()];
+  };
+
+  std::vector<std::vector<uint64_t>> out(comm.size());
+  size_t nhooks = 0, n = 0;
+  for (const auto &e : edges) {
+    const uint64_t r0 = root(e.first), r1 = root(e.second);
+    if (r0 == r1) continue; // connected
+    const uint64_t lo = std::min(r0, r1), hi = std::max(r0, r1);
+    out[owner(hi)].push_back(hi); // hi --> lo
+    out[owner(hi)].push_back(lo);
+    edges[n ++] = std::make_pair(lo, hi);
+    nhooks ++;
+  }
+  edges.resize(n);
+  std::sort(edges.begin(), edges.end());
+  edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+  std::vector<uint64_t> in;
+  std::vector<int> in_counts;
+  all_to_all(out, in, in_counts);
+
+  // each root is hooked to the smallest of the roots requested
+  for (size_t j = 0; j < in.size(); j += 2) {
+    const uint32_t k = slot(in[j]);
+    parent[k] = std::min(parent[k], in[j+1]);
+  }
+
+  return nhooks;
+}
+
+inline void distributed_integer_union_find::query(const std::vector<uint64_t>& ids, std::vector<uint64_t>& parents)
+{
+  std::vector<std::vector<uint64_t>> out(comm.size());
+  for (const auto i : ids)
+    out[owner(i)].push_back(i);
+
+  std::vector<uint64_t> in;
+  std::vector<int> in_counts;
+  all_to_all(out, in, in_counts);
+
+  // answers go back in the same order and with the same counts
+  std::vector<std::vector<uint64_t>> answers(comm.size());
+  size_t j = 0;
+  for (int p = 0; p < comm.size(); p ++)
+    for (int c = 0; c < in_counts[p]; c ++, j ++)
+      answers[p].push_back(find(in[j]));
+
+  all_to_all(answers, in, in_counts);
+
+  std::vector<size_t> pos(comm.size(), 0), displs(comm.size(), 0);
+  for (int p = 1; p < comm.size(); p ++)
+    displs[p] = displs[p-1] + in_counts[p-1];
+  parents.resize(ids.size());
+  for (size_t k = 0; k < ids.size(); k ++) {
+    const int p = owner(ids[k]);
+    parents[k] = in[displs[p] + pos[p] ++];
+  }
+}
+
+inline void distributed_integer_union_find::all_to_all(
+    const std::vector<std::vector<uint64_t>>& out,
+    std::vector<uint64_t>& in, std::vector<int>& in_counts)
+{
+  const int np = comm.size();
+  std::vector<int> out_counts(np), out_displs(np, 0), in_displs(np, 0);
+  for (int p = 0; p < np; p ++) {
+    out_counts[p] = out[p].size();
+    if (p > 0) out_displs[p] = out_displs[p-1] + out_counts[p-1];
+    if (p != comm.rank() && out_counts[p] > 0) {
+      stats.messages_sent ++;
+      stats.bytes_sent += out_counts[p] * sizeof(uint64_t);
+    }
+  }
+
+  std::vector<uint64_t> buffer;
+  buffer.reserve(out_displs[np-1] + out_counts[np-1]);
+  for (const auto &o : out)
+    buffer.insert(buffer.end(), o.begin(), o.end());
+
+#ifndef DIY_NO_MPI
+  in_counts.resize(np);
+  MPI_Alltoall(out_counts.data(), 1, MPI_INT, in_counts.data(), 1, MPI_INT, comm);
+  for (int p = 1; p < np; p ++)
+    in_displs[p] = in_displs[p-1] + in_counts[p-1];
+  in.resize(in_displs[np-1] + in_counts[np-1]);
+  MPI_Alltoallv(buffer.data(), out_counts.data(), out_displs.data(), MPI_UINT64_T,
+      in.data(), in_counts.data(), in_displs.data(), MPI_UINT64_T, comm);
+#else
+  in_counts = out_counts;
+  in.swap(buffer);
+#endif
+}
+
+inline void distributed_integer_union_find::print_stats(FILE *fp) const
+{
+  uint64_t messages, bytes;
+  diy::mpi::all_reduce(comm, stats.messages_sent, messages, std::plus<uint64_t>());
+  diy::mpi::all_reduce(comm, stats.bytes_sent, bytes, std::plus<uint64_t>());
+  if (comm.rank() == 0)
+    fprintf(fp, "[FTK] distributed union-find: hook_rounds=%d, jump_rounds=%d, messages=%llu, bytes=%llu\n",
+        stats.hook_rounds, stats.jump_rounds, (unsigned long long)messages, (unsigned long long)bytes);
+}
+
+}
+
+#endif
@@ -2,21 +2,44 @@
 #define _FTK_DUF_HH
 
 #include <ftk/ftk_config.hh>
+#include <ftk/external/diy/mpi.hpp>
+#include <ftk/external/diy/serialization.hpp>
 #include <map>
+#include <vector>
+#include <functional>
+#include <algorithm>
 
 namespace ftk {
 
+// Lightweight distributed union-find.  Each process unites elements it
+// knows, and exchange() makes the processes agree on the roots, which are
+// the smallest elements of the sets.  An element is owned by the process
+// pid(element); the owner of an element collects all unions involving it
+// that other processes know of, and answers their queries for its root.
 template <typename T>
 struct duf {
   void unite(T, T);
   T find(T);
 
-  std::function<int(T)> pid = [](int){return 0;};
+  std::function<int(T)> pid = [](T){return 0;};
 
-  void exchange();
+  // collective; iterates until no process changes its roots
+  void exchange(const diy::mpi::communicator& comm = diy::mpi::communicator());
+  int nrounds = 0; // of the last exchange
 
   std::map<T, T> parents; // pointer to the parent in the local process
   std::map<T, size_t> sz;
+
+protected:
+  bool unite_changed(T i, T j) { // true if i and j were in different sets
+    if (find(i) == find(j)) return false;
+    unite(i, j);
+    return true;
+  }
+
+  // sends a batch to each process and receives those sent to this one
+  static void all_to_all(const diy::mpi::communicator& comm,
+      const std::vector<std::vector<T>>& out, std::vector<std::vector<T>>& in);
 };
 
 //////
@@ -46,14 +69,91 @@ T duf<T>::find(T i)
 }
 
 template <typename T>
-void duf<T>::exchange()
+void duf<T>::exchange(const diy::mpi::communicator& comm)
+{
+  const int np = comm.size();
+  nrounds = 0;
+
+  while (true) {
+    size_t changes = 0;
+
+    // elements owned by other processes
+    std::vector<T> remote;
+    for (const auto &kv : parents)
+      if (pid(kv.first) != comm.rank())
+        remote.push_back(kv.first);
+
+    // 1. unions with remote elements are sent to their owners
+    std::vector<std::vector<T>> out(np), in;
+    for (const auto &i : remote) {
+      const T r = find(i);
+      if (r != i) {
+        out[pid(i)].push_back(i);
+        out[pid(i)].push_back(r);
+      }
+    }
+    all_to_all(comm, out, in);
+    for (const auto &batch : in)
+      for (size_t j = 0; j + 1 < batch.size(); j += 2)
+        changes += unite_changed(batch[j], batch[j+1]);
+
+    // 2. roots of remote elements are queried from their owners
+    out.assign(np, std::vector<T>());
+    for (const auto &i : remote)
+      out[pid(i)].push_back(i);
+    all_to_all(comm, out, in);
+
+    std::vector<std::vector<T>> answers(np);
+    for (int p = 0; p < np; p ++)
+      for (const auto &i : in[p])
+        answers[p].push_back(find(i));
+    all_to_all(comm, answers, in);
+
+    for (int p = 0; p < np; p ++) // answers are in the order of queries
+      for (size_t j = 0; j < in[p].size(); j ++)
+        changes += unite_changed(out[p][j], in[p][j]);
+
+    nrounds ++;
+    size_t total_changes;
+    diy::mpi::all_reduce(comm, changes, total_changes, std::plus<size_t>());
+    if (total_changes == 0) break;
+  }
+}
+
+template <typename T>
+void duf<T>::all_to_all(const diy::mpi::communicator& comm,
+    const std::vector<std::vector<T>>& out, std::vector<std::vector<T>>& in)
 {
-  std::set<T> local_roots;
-  for (const auto &kv : parents) {
-    if (kv.first == find(kv.second))
-      local_roots.insert(kv.first);
+  const int np = comm.size();
+  std::vector<int> out_counts(np), out_displs(np, 0), in_counts(np), in_displs(np, 0);
+  std::vector<char> sendbuf;
+  for (int p = 0; p < np; p ++) {
+    diy::MemoryBuffer bb;
+    diy::save(bb, out[p]);
+    out_counts[p] = bb.buffer.size();
+    out_displs[p] = sendbuf.size();
+    sendbuf.insert(sendbuf.end(), bb.buffer.begin(), bb.buffer.end());
+  }
+
+  std::vector<char> recvbuf;
+#ifndef DIY_NO_MPI
+  MPI_Alltoall(out_counts.data(), 1, MPI_INT, in_counts.data(), 1, MPI_INT, comm);
+  for (int p = 1; p < np; p ++)
+    in_displs[p] = in_displs[p-1] + in_counts[p-1];
+  recvbuf.resize(in_displs[np-1] + in_counts[np-1]);
+  MPI_Alltoallv(sendbuf.data(), out_counts.data(), out_displs.data(), MPI_BYTE,
+      recvbuf.data(), in_counts.data(), in_displs.data(), MPI_BYTE, comm);
+#else
+  in_counts = out_counts;
+  recvbuf.swap(sendbuf);
+#endif
+
+  in.resize(np);
+  for (int p = 0; p < np; p ++) {
+    diy::MemoryBuffer bb;
+    bb.buffer.assign(recvbuf.begin() + in_displs[p], recvbuf.begin() + in_displs[p] + in_counts[p]);
+    diy::load(bb, in[p]);
   }
-  
 }
 
 }
@@ -0,0 +1,219 @@
+#ifndef _FTK_INTEGER_UNION_FIND_H
+#define _FTK_INTEGER_UNION_FIND_H
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <cstddef>
+
+// Union-find over integer element IDs, kept in flat arrays.  Unlike
+// union_find<IdType>, which keeps elements in ordered maps, lookups are
+// array accesses, and sets are grouped in linear time.
+//
+// dense_union_find takes IDs in [0, n); sparse_union_find takes arbitrary
+// integer keys, which are numbered densely in the order they are added
+// with an open-addressing hash table.  Neither is thread-safe.
+
+// Reference
+  // Paper: "Worst-case Analysis of Set Union Algorithms"
+
+namespace ftk {
+
+template <typename IdType=uint32_t>
+struct dense_union_find
+{
+  dense_union_find(size_t n = 0) {reset(n);}
+
+  // Initialization
+  void reset(size_t n) { // n singletons
+    parent.resize(n);
+    rank.assign(n, 0);
+    for (size_t i = 0; i < n; i ++)
+      parent[i] = i;
+  }
+  IdType add() { // appends a singleton and returns its id
+    parent.push_back(parent.size());
+    rank.push_back(0);
+    return parent.size() - 1;
+  }
+  size_t size() const {return parent.size();}
+
+  // Operations
+
+  // Union by rank; false if already in the same set
+  bool unite(IdType i, IdType j) {
+    i = find(i);
+    j = find(j);
+    if (i == j) return false;
+
+    if (rank[i] < rank[j]) parent[i] = j;
+    else if (rank[i] > rank[j]) parent[j] = i;
+    else {
+      parent[j] = i;
+      rank[i] ++;
+    }
+    return true;
+  }
+
+  // Queries
+
+  // Find the root of an element.
+    // Path compression by path halving method
+  IdType find(IdType i) {
+    while (i != parent[i]) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+    }
+    return i;
+  }
+
+  bool same_set(IdType i, IdType j) {return find(i) == find(j);}
+
+  // Get sets of elements in CSR form with a counting sort: members of the
+  // k-th set are ids[offsets[k]] ... ids[offsets[k+1]-1] in increasing
+  // order, and sets are ordered by their smallest members.  Returns the
+  // number of sets.
+  size_t get_sets(std::vector<size_t>& offsets, std::vector<IdType>& ids);
+
+private:
+  std::vector<IdType> parent;
+  std::vector<uint8_t> rank; // at most log2(n)
+};
+
+template <typename Key=uint64_t, typename IdType=uint32_t>
+struct sparse_union_find
+{
+  sparse_union_find(size_t n = 0) {reserve(n);}
+
+  void reserve(size_t n);
+
+  // Initialization
+  // Add an element if it is new; returns its dense id
+  IdType add(Key k);
+
+  // Operations
+  bool unite(Key i, Key j) {return uf.unite(id(i), id(j));}
+
+  // Queries
+  bool has(Key k) const {return table[slot(k)] != none;}
+  IdType id(Key k) const {return table[slot(k)];} // none if absent
+  Key key(IdType i) const {return keys[i];}
+  size_t size() const {return keys.size();}
+
+  Key find(Key k) {return keys[uf.find(id(k))];}
+  bool same_set(Key i, Key j) {return uf.same_set(id(i), id(j));}
+
+  // Sets of keys in CSR form; see dense_union_find::get_sets
+  size_t get_sets(std::vector<size_t>& offsets, std::vector<Key>& members);
+
+  // union-find of the dense ids
+  dense_union_find<IdType>& dense() {return uf;}
+
+  static const IdType none = std::numeric_limits<IdType>::max();
+
+private:
+  static uint64_t hash(uint64_t x) { // splitmix64 finalizer
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+  size_t slot(Key k) const { // linear probing; the slot of k, or the empty slot for it
+    size_t s = hash(k) & mask;
+    while (table[s] != none && keys[table[s]] != k)
+      s = (s + 1) & mask;
+    return s;
+  }
+
+private:
+  dense_union_find<IdType> uf;
+  std::vector<Key> keys; // by dense id
+  std::vector<IdType> table = std::vector<IdType>(16, none); // power-of-two size, at most half full
+  size_t mask = 15;
+};
+
+/////
+// Group the ids [0, n) by their roots, find(i), in CSR form with a
+// counting sort; shared by the union-find structures over integer ids
+template <typename IdType, typename Find>
+inline size_t get_union_find_sets(size_t n, Find find, std::vector<size_t>& offsets, std::vector<IdType>& ids)
+{
+  const IdType none = std::numeric_limits<IdType>::max();
+
+  // number the sets in the order of their smallest members
+  std::vector<IdType> label(n, none), set_of(n);
+  size_t nsets = 0;
+  for (size_t i = 0; i < n; i ++) {
+    const IdType r = find(i);
+    if (label[r] == none) label[r] = nsets ++;
+    set_of[i] = label[r];
+  }
+
+  offsets.assign(nsets + 1, 0);
+  for (size_t i = 0; i < n; i ++)
+    offsets[set_of[i] + 1] ++;
+  for (size_t k = 0; k < nsets; k ++)
+    offsets[k + 1] += offsets[k];
+
+  ids.resize(n);
+  std::vector<size_t> pos(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < n; i ++)
+    ids[pos[set_of[i]] ++] = i;
+
+  return nsets;
+}
+
+template <typename IdType>
+inline size_t dense_union_find<IdType>::get_sets(std::vector<size_t>& offsets, std::vector<IdType>& ids)
+{
+  return get_union_find_sets<IdType>(parent.size(),
+      [this](IdType i) {return find(i);}, offsets, ids);
+}
+
+template <typename Key, typename IdType>
+const IdType sparse_union_find<Key, IdType>::none;
+
+template <typename Key, typename IdType>
+inline void sparse_union_find<Key, IdType>::reserve(size_t n)
+{
+  size_t capacity = table.size();
+  while (capacity < 2 * n) capacity *= 2;
+  if (capacity == table.size()) return;
+
+  table.assign(capacity, none);
+  mask = capacity - 1;
+  for (size_t i = 0; i < keys.size(); i ++)
+    table[slot(keys[i])] = i;
+}
+
+template <typename Key, typename IdType>
+inline IdType sparse_union_find<Key, IdType>::add(Key k)
+{
+  size_t s = slot(k);
+  if (table[s] != none) return table[s];
+
+  if (2 * (keys.size() + 1) > table.size()) {
+    reserve(keys.size() + 1);
+    s = slot(k);
+  }
+
+  const IdType i = uf.add();
+  keys.push_back(k);
+  table[s] = i;
+  return i;
+}
+
+template <typename Key, typename IdType>
+inline size_t sparse_union_find<Key, IdType>::get_sets(std::vector<size_t>& offsets, std::vector<Key>& members)
+{
+  std::vector<IdType> ids;
+  const size_t nsets = uf.get_sets(offsets, ids);
+
+  members.resize(ids.size());
+  for (size_t i = 0; i < ids.size(); i ++)
+    members[i] = keys[ids[i]];
+  return nsets;
+}
+
+}
+
+#endif
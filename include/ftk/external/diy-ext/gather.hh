@@ -1,8 +1,11 @@
 #ifndef _DIYEXT_GATHER_HH
 #define _DIYEXT_GATHER_HH
 
+#include <ftk/ftk_config.hh>
 #include <ftk/external/diy/mpi.hpp>
 #include <ftk/external/diy-ext/serialization.hh>
+#include <numeric>
+#include <vector>
 
 namespace diy { namespace mpi {
 
@@ -56,6 +59,43 @@ inline void gather(const communicator& comm, const std::map<K, V>& in, std::map<
 #endif
 }
 
+template <typename T> // concatenating std::vectors to root using gather, in the order of ranks
+inline void gatherv(const communicator& comm, const std::vector<T>& in, std::vector<T>& out, int root)
+{
+#if FTK_HAVE_MPI
+  diy::MemoryBuffer bb;
+  diy::save(bb, in);
+
+  int length = bb.buffer.size();
+  std::vector<int> lengths(comm.size(), 0), displs(comm.size(), 0);
+  MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, root, comm);
+
+  std::vector<char> buffer;
+  if (comm.rank() == root) {
+    for (int i = 1; i < comm.size(); i ++)
+      displs[i] = displs[i-1] + lengths[i-1];
+    buffer.resize(displs.back() + lengths.back());
+  }
+
+  MPI_Gatherv(bb.buffer.data(), length, MPI_CHAR,
+      buffer.data(), lengths.data(), displs.data(), MPI_CHAR,
+      root, comm);
+
+  out.clear();
+  if (comm.rank() == root) {
+    for (int i = 0; i < comm.size(); i ++) {
+      diy::MemoryBuffer b;
+      b.buffer.assign(buffer.begin() + displs[i], buffer.begin() + displs[i] + lengths[i]);
+      std::vector<T> v;
+      diy::load(b, v);
+      out.insert(out.end(), v.begin(), v.end());
+    }
+  }
+#else
+  out = in;
+#endif
+}
+
 }
 }
 
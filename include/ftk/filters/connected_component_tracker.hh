@@ -3,12 +3,22 @@
 
 #include <ftk/filters/filter.hh>
 #include <ftk/tracking_graph/tracking_graph.hh>
+#include <ftk/external/diy-ext/gather.hh>
+#include <unordered_map>
+#include <thread>
 
 namespace ftk {
 
-template <typename TimeIndexType=size_t, typename LabelIdType=size_t>
+// Tracks labeled components over time by their overlaps.  If distributed,
+// each process pushes the labels of its own part of the domain, labeled
+// consistently across processes, and the overlaps of all processes are
+// combined into the tracking graph of rank 0; otherwise each process
+// tracks its snapshots on its own.
+template <typename TimeIndexType=size_t, typename LabelIdType=uint32_t>
 struct connected_component_tracker : public filter
 {
+  typedef ftk::tracking_graph<TimeIndexType, LabelIdType, size_t, size_t> tracking_graph_type; // weighted by overlap sizes
+
   connected_component_tracker() {}
   virtual ~connected_component_tracker() {};
 
@@ -17,7 +27,11 @@ struct connected_component_tracker : public filter
   void update() {};
   void finalize();
 
-  virtual void push_labeled_data_snapshot(const std::vector<LabelIdType>& labels);
+  virtual void push_labeled_data_snapshot(std::vector<LabelIdType> labels); // moved into the snapshots
+
+  // labels with the attributes of their components, of label l at l-1,
+  // which become the node attributes of the current timestep
+  void push_labeled_data_snapshot(std::vector<LabelIdType> labels, const std::vector<component_attributes>& attributes);
   const std::vector<LabelIdType>& get_last_labeled_data_snapshot() const {return labeled_data_snapshots.back();}
   
   template <typename ContainerType>
@@ -25,12 +39,25 @@ struct connected_component_tracker : public filter
 
   bool pop_snapshot();
 
-  const ftk::tracking_graph<>& get_tracking_graph() const {return tg;}
+  void set_distributed(bool b) {distributed = b;} // snapshots of processes are parts of the same labeled domain
+
+  const tracking_graph_type& get_tracking_graph() const {return tg;}
+
+protected:
+  typedef std::pair<LabelIdType, LabelIdType> label_pair;
+  struct label_pair_hash {
+    size_t operator()(const label_pair& p) const {return (uint64_t(p.first) * 0x9e3779b97f4a7c15ULL) ^ uint64_t(p.second);}
+  };
+
+  // numbers of elements labeled l0 in the first and l1 in the second snapshot
+  void count_overlaps(const std::vector<LabelIdType>& labels0, const std::vector<LabelIdType>& labels1,
+      std::unordered_map<label_pair, size_t, label_pair_hash>& overlaps) const;
 
 protected:
-  ftk::tracking_graph<TimeIndexType, LabelIdType> tg;
+  tracking_graph_type tg;
   std::deque<std::vector<LabelIdType>> labeled_data_snapshots;
   TimeIndexType current_timestep = 0;
+  bool distributed = false;
 };
 
 /////
@@ -46,14 +73,59 @@ void connected_component_tracker<TimeIndexType, LabelIdType>::update_timestep()
 {
   if (labeled_data_snapshots.size() < 2) return;
 
-  const auto &labels0 = labeled_data_snapshots[0],
-             &labels1 = labeled_data_snapshots[1];
+  std::unordered_map<label_pair, size_t, label_pair_hash> overlaps;
+  count_overlaps(labeled_data_snapshots[0], labeled_data_snapshots[1], overlaps);
+
+  if (distributed) { // overlaps of all processes are added up on rank 0
+    std::vector<std::pair<label_pair, size_t>> local(overlaps.begin(), overlaps.end()), all;
+    diy::mpi::gatherv(comm, local, all, 0);
+
+    overlaps.clear();
+    for (const auto &e : all)
+      overlaps[e.first] += e.second;
+  }
 
-  for (size_t i = 0; i < labels0.size(); i ++)
-    if (labels0[i] != 0 && labels1[i] != 0) {
-      // fprintf(stderr, "edge: %d --> %d\n", labels0[i], labels1[i]);
-      tg.add_edge(current_timestep-1, labels0[i], current_timestep, labels1[i]);
+  for (const auto &kv : overlaps)
+    tg.add_edge(current_timestep-1, kv.first.first, current_timestep, kv.first.second, kv.second);
+}
+
+template <typename TimeIndexType, typename LabelIdType>
+void connected_component_tracker<TimeIndexType, LabelIdType>::count_overlaps(
+    const std::vector<LabelIdType>& labels0, const std::vector<LabelIdType>& labels1,
+    std::unordered_map<label_pair, size_t, label_pair_hash>& overlaps) const
+{
+  const size_t n = std::min(labels0.size(), labels1.size());
+  const size_t nworkers = std::min(size_t(std::max(nthreads, 1)), std::max(n, size_t(1)));
+
+  // each thread counts a range of elements in its own map; runs of the
+  // same pair are counted before they are added
+  std::vector<std::unordered_map<label_pair, size_t, label_pair_hash>> local(nworkers);
+  auto count = [&](size_t k) {
+    label_pair last(0, 0);
+    size_t run = 0;
+    for (size_t i = n * k / nworkers; i < n * (k+1) / nworkers; i ++) {
+      if (labels0[i] == 0 || labels1[i] == 0) continue;
+      if (labels0[i] == last.first && labels1[i] == last.second) {
+        run ++;
+        continue;
+      }
+      if (run) local[k][last] += run;
+      last = label_pair(labels0[i], labels1[i]);
+      run = 1;
     }
+    if (run) local[k][last] += run;
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t k = 1; k < nworkers; k ++)
+    workers.push_back(std::thread(count, k));
+  count(0);
+  for (auto &w : workers) w.join();
+
+  overlaps.swap(local[0]);
+  for (size_t k = 1; k < nworkers; k ++)
+    for (const auto &kv : local[k])
+      overlaps[kv.first] += kv.second;
 }
 
 template <typename TimeIndexType, typename LabelIdType>
@@ -70,9 +142,17 @@ bool connected_component_tracker<TimeIndexType, LabelIdType>::advance_timestep()
 }
 
 template <typename TimeIndexType, typename LabelIdType>
-void connected_component_tracker<TimeIndexType, LabelIdType>::push_labeled_data_snapshot(const std::vector<LabelIdType>& labels)
+void connected_component_tracker<TimeIndexType, LabelIdType>::push_labeled_data_snapshot(std::vector<LabelIdType> labels)
+{
+  labeled_data_snapshots.push_back(std::move(labels));
+}
+
+template <typename TimeIndexType, typename LabelIdType>
+void connected_component_tracker<TimeIndexType, LabelIdType>::push_labeled_data_snapshot(std::vector<LabelIdType> labels, const std::vector<component_attributes>& attributes)
 {
-  labeled_data_snapshots.push_back(labels);
+  for (size_t i = 0; i < attributes.size(); i ++)
+    tg.set_node_attributes(current_timestep, i + 1, attributes[i]);
+  push_labeled_data_snapshot(std::move(labels));
 }
 
 template <typename TimeIndexType, typename LabelIdType>
@@ -35,6 +35,7 @@ namespace diy {
         diy::load(bb, cp.x[i]);
       diy::load(bb, cp.scalar);
       diy::load(bb, cp.type);
+      diy::load(bb, cp.tag);
     }
   // };
 }
@@ -2,9 +2,12 @@
 #define _FTK_CRITICAL_POINT_TRACKER_HH
 
 #include <ftk/ftk_config.hh>
+#include <ftk/ndarray.hh>
 #include <ftk/filters/filter.hh>
 #include <ftk/filters/critical_point.hh>
 #include <ftk/geometry/points2vtk.hh>
+#include <ftk/io/vtp.hh>
+#include <memory>
 
 namespace ftk {
 
@@ -22,6 +25,14 @@ struct critical_point_tracker : public filter {
   void write_traced_critical_points_vtk(const std::string& filename);
   void write_discrete_critical_points_vtk(const std::string& filename);
 
+  // Binary vtp output without VTK; collective.  Trajectories are traced
+  // on rank 0.  If the filename ends with .pvtp, rank 0 sends contiguous
+  // ranges of trajectories to the other processes, and each process
+  // builds and writes its piece to <name>_<rank>.vtp, so that only the
+  // encoding, compression, and file writes are parallel; rank 0 also
+  // writes the index.  Otherwise rank 0 writes a single file.
+  virtual void write_traced_critical_points_vtp(const std::string& filename, bool compressed = false) = 0;
+
   virtual void write_traced_critical_points_text(std::ostream& os) const = 0;
   virtual void write_discrete_critical_points_text(std::ostream &os) const = 0;
 
@@ -29,7 +40,14 @@ struct critical_point_tracker : public filter {
   void write_discrete_critical_points_text(const std::string& filename);
 
   struct field_data_snapshot_t {
-    ndarray<double> scalar, vector, jacobian;
+    ndarray_view<const double> scalar, vector, jacobian;
+
+    // arrays owned by the snapshot; views may also refer to caller-owned memory
+    std::vector<std::shared_ptr<const ndarray<double>>> storage;
+    ndarray_view<const double> own(ndarray<double>&& array) {
+      storage.push_back(std::make_shared<const ndarray<double>>(std::move(array)));
+      return storage.back()->view();
+    }
   };
 
   bool pop_field_data_snapshot();
@@ -39,12 +57,36 @@ struct critical_point_tracker : public filter {
       const ndarray<double> &jacobian);
   virtual void push_scalar_field_snapshot(const ndarray<double> &scalar); // push scalar only
 
+  // zero-copy variants; the viewed data must outlive the snapshot
+  virtual void push_field_data_snapshot(
+      const ndarray_view<const double> &scalar, 
+      const ndarray_view<const double> &vector,
+      const ndarray_view<const double> &jacobian);
+  virtual void push_scalar_field_snapshot(const ndarray_view<const double> &scalar);
+
+  // the spacetime volumes are sliced without copying; they must outlive the tracking
   virtual void push_field_data_spacetime(
       const ndarray<double> &scalars, 
       const ndarray<double> &vectors,
       const ndarray<double> &jacobians);
   void push_scalar_field_spacetime(const ndarray<double>& scalars);
 
+  virtual void push_field_data_spacetime( // e.g. volumes in mapped files
+      const ndarray_view<const double> &scalars, 
+      const ndarray_view<const double> &vectors,
+      const ndarray_view<const double> &jacobians);
+  void push_scalar_field_spacetime(const ndarray_view<const double>& scalars);
+
+protected:
+  template <int N>
+  void write_traced_vtp(const std::string& filename, bool compressed,
+      const std::vector<std::vector<critical_point_t<N, double>>>& curves);
+
+  template <int N> // curves [begin, end), whose ids start from first_id
+  static void traced_critical_points_to_vtp(
+      const std::vector<std::vector<critical_point_t<N, double>>>& curves,
+      size_t begin, size_t end, size_t first_id, vtp_polydata& poly);
+
 protected:
   std::deque<field_data_snapshot_t> field_data_snapshots;
 };
@@ -55,21 +97,42 @@ inline void critical_point_tracker::push_field_data_snapshot(
     const ndarray<double>& scalar,
     const ndarray<double>& vector,
     const ndarray<double>& jacobian)
+{
+  field_data_snapshot_t snapshot;
+  snapshot.scalar = snapshot.own(ndarray<double>(scalar));
+  snapshot.vector = snapshot.own(ndarray<double>(vector));
+  snapshot.jacobian = snapshot.own(ndarray<double>(jacobian));
+
+  field_data_snapshots.emplace_back(std::move(snapshot));
+}
+
+inline void critical_point_tracker::push_scalar_field_snapshot(const ndarray<double>& scalar)
+{
+  field_data_snapshot_t snapshot;
+  snapshot.scalar = snapshot.own(ndarray<double>(scalar));
+
+  field_data_snapshots.emplace_back(std::move(snapshot));
+}
+
+inline void critical_point_tracker::push_field_data_snapshot(
+    const ndarray_view<const double>& scalar,
+    const ndarray_view<const double>& vector,
+    const ndarray_view<const double>& jacobian)
 {
   field_data_snapshot_t snapshot;
   snapshot.scalar = scalar;
   snapshot.vector = vector;
   snapshot.jacobian = jacobian;
 
-  field_data_snapshots.emplace_back(snapshot);
+  field_data_snapshots.emplace_back(std::move(snapshot));
 }
 
-inline void critical_point_tracker::push_scalar_field_snapshot(const ndarray<double>& scalar)
+inline void critical_point_tracker::push_scalar_field_snapshot(const ndarray_view<const double>& scalar)
 {
   field_data_snapshot_t snapshot;
   snapshot.scalar = scalar;
 
-  field_data_snapshots.emplace_back(snapshot);
+  field_data_snapshots.emplace_back(std::move(snapshot));
 }
 
 inline void critical_point_tracker::push_field_data_spacetime(
@@ -77,16 +140,27 @@ inline void critical_point_tracker::push_field_data_spacetime(
     const ndarray<double>& vectors,
     const ndarray<double>& jacobians)
 {
-  for (size_t t = 0; t < scalars.shape(scalars.nd()-1); t ++) {
-    auto scalar = scalars.slice_time(t);
-    auto vector = vectors.slice_time(t);
-    auto jacobian = jacobians.slice_time(t);
-
-    push_field_data_snapshot(scalar, vector, jacobian);
-  }
+  push_field_data_spacetime(scalars.view(), vectors.view(), jacobians.view());
 }
 
 inline void critical_point_tracker::push_scalar_field_spacetime(const ndarray<double>& scalars)
+{
+  push_scalar_field_spacetime(scalars.view());
+}
+
+inline void critical_point_tracker::push_field_data_spacetime(
+    const ndarray_view<const double>& scalars,
+    const ndarray_view<const double>& vectors,
+    const ndarray_view<const double>& jacobians)
+{
+  for (size_t t = 0; t < scalars.shape(scalars.nd()-1); t ++)
+    push_field_data_snapshot(
+        scalars.slice_time(t), 
+        vectors.slice_time(t), 
+        jacobians.slice_time(t));
+}
+
+inline void critical_point_tracker::push_scalar_field_spacetime(const ndarray_view<const double>& scalars)
 {
   for (size_t t = 0; t < scalars.shape(scalars.nd()-1); t ++)
     push_scalar_field_snapshot( scalars.slice_time(t) );
@@ -132,6 +206,119 @@ inline void critical_point_tracker::write_discrete_critical_points_vtk(const std
 }
 #endif
 
+template <int N>
+inline void critical_point_tracker::traced_critical_points_to_vtp(
+    const std::vector<std::vector<critical_point_t<N, double>>>& curves,
+    size_t begin, size_t end, size_t first_id, vtp_polydata& poly)
+{
+  size_t np = 0, nverts = 0;
+  for (size_t k = begin; k < end; k ++) {
+    np += curves[k].size();
+    if (curves[k].size() < 2) nverts ++;
+  }
+
+  poly.points.resize(np * 3);
+  poly.verts_connectivity.reserve(nverts);
+  poly.verts_offsets.reserve(nverts);
+  poly.lines_connectivity.reserve(np);
+  poly.lines_offsets.reserve(end - begin - nverts);
+
+  double *time = N > 3 ? poly.add_point_data<double>("time") : NULL; // spacetime of 3D
+  uint32_t *types = poly.add_point_data<uint32_t>("type");
+  uint32_t *ids = poly.add_point_data<uint32_t>("id");
+  double *scalars = poly.add_point_data<double>("scalar");
+
+  size_t i = 0;
+  for (size_t k = begin; k < end; k ++) {
+    const auto &curve = curves[k];
+    const bool isolated = curve.size() < 2;
+    for (const auto &cp : curve) {
+      for (int j = 0; j < 3; j ++)
+        poly.points[i*3+j] = cp[j];
+      if (time) time[i] = cp[3];
+      types[i] = cp.type;
+      ids[i] = first_id + k - begin;
+      scalars[i] = cp.scalar;
+      (isolated ? poly.verts_connectivity : poly.lines_connectivity).push_back(i ++);
+    }
+    if (isolated) poly.verts_offsets.push_back(poly.verts_connectivity.size());
+    else poly.lines_offsets.push_back(poly.lines_connectivity.size());
+  }
+}
+
+template <int N>
+inline void critical_point_tracker::write_traced_vtp(const std::string& filename, bool compressed,
+    const std::vector<std::vector<critical_point_t<N, double>>>& curves)
+{
+  const std::string ext = ".pvtp";
+  const bool parallel = filename.size() > ext.size()
+    && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+
+  if (!parallel) {
+    if (comm.rank() == 0) {
+      vtp_polydata poly;
+      traced_critical_points_to_vtp(curves, 0, curves.size(), 0, poly);
+      poly.write(filename, compressed);
+    }
+    return;
+  }
+
+  // trajectories are traced on rank 0, which holds all of them and sends
+  // each process a contiguous range with a balanced number of points
+  const int tag = 0;
+  const std::string stem = filename.substr(0, filename.size() - ext.size());
+  std::vector<std::vector<critical_point_t<N, double>>> received;
+  size_t begin = 0, end = 0, first_id = 0;
+
+  if (comm.rank() == 0) {
+    size_t total = 0;
+    for (const auto &curve : curves)
+      total += curve.size();
+
+    std::vector<size_t> bounds(comm.size() + 1, curves.size());
+    bounds[0] = 0;
+    size_t points = 0;
+    int r = 1;
+    for (size_t k = 0; k < curves.size() && r < comm.size(); k ++) {
+      points += curves[k].size();
+      while (r < comm.size() && points * comm.size() >= total * r)
+        bounds[r ++] = k + 1;
+    }
+
+    for (int p = 1; p < comm.size(); p ++) {
+      diy::MemoryBuffer bb;
+      diy::save(bb, bounds[p]);
+      diy::save(bb, bounds[p+1] - bounds[p]);
+      for (size_t k = bounds[p]; k < bounds[p+1]; k ++)
+        diy::save(bb, curves[k]);
+      comm.send(p, tag, bb.buffer);
+    }
+    end = bounds[1];
+  } else {
+    diy::MemoryBuffer bb;
+    comm.recv(0, tag, bb.buffer);
+    size_t n;
+    diy::load(bb, first_id);
+    diy::load(bb, n);
+    received.resize(n);
+    for (auto &curve : received)
+      diy::load(bb, curve);
+    end = n;
+  }
+
+  vtp_polydata poly;
+  traced_critical_points_to_vtp(comm.rank() == 0 ? curves : received, begin, end, first_id, poly);
+  poly.write(stem + "_" + std::to_string(comm.rank()) + ".vtp", compressed);
+
+  if (comm.rank() == 0) {
+    const std::string base = stem.substr(stem.find_last_of('/') + 1); // relative to the index
+    std::vector<std::string> pieces;
+    for (int p = 0; p < comm.size(); p ++)
+      pieces.push_back(base + "_" + std::to_string(p) + ".vtp");
+    poly.write_pvtp(filename, pieces);
+  }
+}
+
 inline void critical_point_tracker::write_traced_critical_points_text(const std::string& filename)
 {
   if (comm.rank() == 0) {
@@ -63,8 +63,12 @@ struct critical_point_tracker_2d_regular : public critical_point_tracker_regular
 
   void update_timestep();
 
+  using critical_point_tracker_regular::push_scalar_field_snapshot;
+  using critical_point_tracker_regular::push_vector_field_snapshot;
   void push_scalar_field_snapshot(const ndarray<double>&);
   void push_vector_field_snapshot(const ndarray<double>&);
+  void push_scalar_field_snapshot(const ndarray_view<const double>&);
+  void push_vector_field_snapshot(const ndarray_view<const double>&);
 
 #if FTK_HAVE_VTK
   virtual vtkSmartPointer<vtkPolyData> get_traced_critical_points_vtk() const;
@@ -78,6 +82,9 @@ struct critical_point_tracker_2d_regular : public critical_point_tracker_regular
   void write_traced_critical_points(const std::string& filename) const;
   
   void write_traced_critical_points_text(std::ostream& os) const;
+  void write_traced_critical_points_vtp(const std::string& filename, bool compressed = false) {
+    write_traced_vtp(filename, compressed, traced_critical_points);
+  }
   void write_discrete_critical_points_text(std::ostream &os) const;
 
 protected:
@@ -101,6 +108,11 @@ protected:
   virtual void simplex_jacobians(const std::vector<std::vector<int>>& vertices, 
       double Js[][2][2]) const;
 
+  // derivatives are normalized by the dimensions of the input array; those
+  // of partial arrays are rescaled as if taken on the entire array
+  bool derivative_scales(size_t DW, size_t DH, double r[2]) const;
+  void rescale_derivatives(size_t DW, size_t DH, ndarray<double>* grad, ndarray<double>* J, bool J_of_grad) const;
+
 protected: // working in progress
   bool robust_check_simplex0(const element_t& s, critical_point_2dt_t &cp);
   bool robust_check_simplex1(const element_t& s, critical_point_2dt_t &cp);
@@ -125,17 +137,17 @@ inline void critical_point_tracker_2d_regular::initialize()
   if (use_default_domain_partition) {
     lattice_partitioner partitioner(domain);
     
-    // a ghost size of 2 is necessary for jacobian derivaition; 
-    // even if jacobian is not necessary, a ghost size of 1 is 
-    // necessary for accessing values on boundaries
+    // only the cores are used; the ghost layers of partial input arrays 
+    // may extend beyond the domain, see default_local_array_domain()
     partitioner.partition(comm.size(), {}, {2, 2});
 
     local_domain = partitioner.get_core(comm.rank());
-    local_array_domain = partitioner.get_ext(comm.rank());
   }
 
   if (!is_input_array_partial)
     local_array_domain = array_domain;
+  else if (use_default_domain_partition || local_array_domain.nd() == 0)
+    local_array_domain = default_local_array_domain();
 }
 
 inline void critical_point_tracker_2d_regular::finalize()
@@ -159,29 +171,83 @@ inline void critical_point_tracker_2d_regular::reset()
   connected_components.clear();
 }
 
-inline void critical_point_tracker_2d_regular::push_scalar_field_snapshot(const ndarray<double>& s)
+inline void critical_point_tracker_2d_regular::push_scalar_field_snapshot(const ndarray_view<const double>& s)
 {
   field_data_snapshot_t snapshot;
   
   snapshot.scalar = s;
   if (vector_field_source == SOURCE_DERIVED) {
-    snapshot.vector = gradient2D(s);
-    if (jacobian_field_source == SOURCE_DERIVED)
-      snapshot.jacobian = jacobian2D(snapshot.vector);
+    ndarray<double> grad;
+    if (jacobian_field_source == SOURCE_DERIVED) {
+      ndarray<double> J;
+      gradient_jacobian2D(s, grad, J);
+      rescale_derivatives(s.shape(0), s.shape(1), &grad, &J, true);
+      snapshot.jacobian = snapshot.own(std::move(J));
+    } else {
+      gradient2D(s, grad);
+      rescale_derivatives(s.shape(0), s.shape(1), &grad, NULL, true);
+    }
+    snapshot.vector = snapshot.own(std::move(grad));
   }
 
-  field_data_snapshots.emplace_back( snapshot );
+  field_data_snapshots.emplace_back( std::move(snapshot) );
 }
 
-inline void critical_point_tracker_2d_regular::push_vector_field_snapshot(const ndarray<double>& v)
+inline void critical_point_tracker_2d_regular::push_vector_field_snapshot(const ndarray_view<const double>& v)
 {
   field_data_snapshot_t snapshot;
  
   snapshot.vector = v;
-  if (jacobian_field_source == SOURCE_DERIVED)
-    snapshot.jacobian = jacobian2D(snapshot.vector);
+  if (jacobian_field_source == SOURCE_DERIVED) {
+    ndarray<double> J = jacobian2D(snapshot.vector);
+    rescale_derivatives(v.shape(1), v.shape(2), NULL, &J, false);
+    snapshot.jacobian = snapshot.own(std::move(J));
+  }
+
+  field_data_snapshots.emplace_back( std::move(snapshot) );
+}
+
+inline bool critical_point_tracker_2d_regular::derivative_scales(size_t DW, size_t DH, double r[2]) const
+{
+  if (!is_input_array_partial) return false;
+  r[0] = double(array_domain.size(0) - 1) / (DW - 1);
+  r[1] = double(array_domain.size(1) - 1) / (DH - 1);
+  return r[0] != 1.0 || r[1] != 1.0;
+}
+
+inline void critical_point_tracker_2d_regular::rescale_derivatives(
+    size_t DW, size_t DH, ndarray<double>* grad, ndarray<double>* J, bool J_of_grad) const
+{
+  double r[2];
+  if (!derivative_scales(DW, DH, r)) return;
+
+  if (grad) 
+    for (size_t i = 0; i < grad->nelem(); i += 2) {
+      (*grad)[i] *= r[0];
+      (*grad)[i+1] *= r[1];
+    }
+
+  if (J) { // J(k, l) is the derivative of the k-th component along the l-th axis
+    const double s[4] = {
+      J_of_grad ? r[0] * r[0] : r[0], 
+      J_of_grad ? r[1] * r[0] : r[0], 
+      J_of_grad ? r[0] * r[1] : r[1], 
+      J_of_grad ? r[1] * r[1] : r[1]};
+    for (size_t i = 0; i < J->nelem(); i += 4)
+      for (int k = 0; k < 4; k ++)
+        (*J)[i+k] *= s[k];
+  }
+}
+
+inline void critical_point_tracker_2d_regular::push_scalar_field_snapshot(const ndarray<double>& s)
+{
+  // keep a private copy, so that the caller may release s
+  push_scalar_field_snapshot(std::make_shared<const ndarray<double>>(s));
+}
 
-  field_data_snapshots.emplace_back( snapshot );
+inline void critical_point_tracker_2d_regular::push_vector_field_snapshot(const ndarray<double>& v)
+{
+  push_vector_field_snapshot(std::make_shared<const ndarray<double>>(v));
 }
 
 inline void critical_point_tracker_2d_regular::update_timestep()
@@ -218,33 +284,35 @@ inline void critical_point_tracker_2d_regular::update_timestep()
     };
 
   if (xl == FTK_XL_NONE) {
-    // m.element_for_ordinal(2, current_timestep, func2);
-    m.element_for(2, lattice({ // ordinal
-          local_domain.start(0), 
-          local_domain.start(1), 
-          static_cast<size_t>(current_timestep), 
-        }, {
-          local_domain.size(0), 
-          local_domain.size(1), 
-          1
-        }), 
-        ftk::ELEMENT_SCOPE_ORDINAL, 
-        func2, nthreads);
-    
-    if (field_data_snapshots.size() >= 2) { // interval
-      // m.element_for_interval(2, current_timestep-1, current_timestep, func2);
-      m.element_for(2, lattice({
-            local_domain.start(0), 
-            local_domain.start(1), 
-            // static_cast<size_t>(current_timestep - 1), 
-            static_cast<size_t>(current_timestep),
+    for (const auto &d : get_local_sweep_domains()) {
+      // m.element_for_ordinal(2, current_timestep, func2);
+      m.element_for(2, lattice({ // ordinal
+            d.start(0), 
+            d.start(1), 
+            static_cast<size_t>(current_timestep), 
           }, {
-            local_domain.size(0), 
-            local_domain.size(1), 
+            d.size(0), 
+            d.size(1), 
             1
-          }),
-          ftk::ELEMENT_SCOPE_INTERVAL, 
+          }), 
+          ftk::ELEMENT_SCOPE_ORDINAL, 
           func2, nthreads);
+    
+      if (field_data_snapshots.size() >= 2) { // interval
+        // m.element_for_interval(2, current_timestep-1, current_timestep, func2);
+        m.element_for(2, lattice({
+              d.start(0), 
+              d.start(1), 
+              // static_cast<size_t>(current_timestep - 1), 
+              static_cast<size_t>(current_timestep),
+            }, {
+              d.size(0), 
+              d.size(1), 
+              1
+            }),
+            ftk::ELEMENT_SCOPE_INTERVAL, 
+            func2, nthreads);
+      }
     }
   } else if (xl == FTK_XL_CUDA) {
 #if FTK_HAVE_CUDA
@@ -375,11 +443,10 @@ inline void critical_point_tracker_2d_regular::trace_connected_components()
     return neighbors;
   };
 
-  std::set<element_t> elements;
+  std::vector<element_t> elements; // in order
   for (const auto &kv : discrete_critical_points)
-    elements.insert(kv.first);
-  connected_components = extract_connected_components<element_t, std::set<element_t>>(
-      neighbors, elements);
+    elements.push_back(kv.first);
+  connected_components = get_connected_components(m, elements);
 
   for (const auto &component : connected_components) {
     std::vector<std::vector<double>> mycurves;
@@ -630,28 +697,21 @@ inline vtkSmartPointer<vtkPolyData> critical_point_tracker_2d_regular::get_trace
   vtkSmartPointer<vtkCellArray> lines = vtkCellArray::New();
   vtkSmartPointer<vtkCellArray> verts = vtkCellArray::New();
 
+  size_t nv = 0;
   for (const auto &curve : traced_critical_points)
-    for (auto i = 0; i < curve.size(); i ++) {
-      double p[3] = {curve[i][0], curve[i][1], curve[i][2]};
-      points->InsertNextPoint(p);
-    }
+    nv += curve.size();
+  points->SetNumberOfPoints(nv);
 
-  size_t nv = 0;
+  std::vector<vtkIdType> ids;
+  vtkIdType k = 0;
   for (const auto &curve : traced_critical_points) {
-    if (curve.size() < 2) { // isolated vertex
-      vtkSmartPointer<vtkVertex> obj = vtkVertex::New();
-      obj->GetPointIds()->SetNumberOfIds(curve.size());
-      for (int i = 0; i < curve.size(); i ++)
-        obj->GetPointIds()->SetId(i, i+nv);
-      verts->InsertNextCell(obj);
-    } else { // lines
-      vtkSmartPointer<vtkPolyLine> obj = vtkPolyLine::New();
-      obj->GetPointIds()->SetNumberOfIds(curve.size());
-      for (int i = 0; i < curve.size(); i ++)
-        obj->GetPointIds()->SetId(i, i+nv);
-      lines->InsertNextCell(obj);
+    ids.resize(curve.size());
+    for (auto i = 0; i < curve.size(); i ++) {
+      points->SetPoint(k, curve[i][0], curve[i][1], curve[i][2]);
+      ids[i] = k ++;
     }
-    nv += curve.size();
+    if (curve.size() < 2) verts->InsertNextCell(ids.size(), ids.data()); // isolated vertex
+    else lines->InsertNextCell(ids.size(), ids.data());
   }
  
   polyData->SetPoints(points);
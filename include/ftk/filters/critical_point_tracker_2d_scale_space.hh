@@ -0,0 +1,140 @@
+#ifndef _FTK_CRITICAL_POINT_TRACKER_2D_SCALE_SPACE_HH
+#define _FTK_CRITICAL_POINT_TRACKER_2D_SCALE_SPACE_HH
+
+#include <ftk/ftk_config.hh>
+#include <ftk/filters/critical_point_tracker_2d_regular.hh>
+#include <ftk/ndarray/conv.hh>
+#include <cmath>
+#include <array>
+
+namespace ftk {
+
+// Tracking 2D critical points across scales, where the "time" axis is
+// the level of a Gaussian scale space.  Each level is smoothed from the
+// previous (finer) one by the difference of the two scales, so the input
+// is never convolved with a large kernel.  Levels are swept from the
+// coarsest (timestep 0) to the finest, and the sweep of a level only
+// covers the neighborhoods of the critical points of the coarser level.
+// Critical points that appear only at fine scales are hence ignored.
+struct critical_point_tracker_2d_scale_space : public critical_point_tracker_2d_regular {
+  critical_point_tracker_2d_scale_space() {set_default_sources();}
+  critical_point_tracker_2d_scale_space(int argc, char **argv)
+    : critical_point_tracker_2d_regular(argc, argv) {set_default_sources();}
+  virtual ~critical_point_tracker_2d_scale_space() {}
+
+  void set_scales(const std::vector<double>& sigmas_) {sigmas = sigmas_;} // increasing
+  void set_scales(double sigma0, double sigma1, int nlevels); // geometrically spaced
+  void set_search_radius(double r) {search_radius = r;} // in multiples of the coarser sigma (plus two cells); 0 sweeps entire levels
+
+  int get_num_levels() const {return sigmas.size();}
+  double get_scale(int t) const {return sigmas[sigmas.size() - 1 - t];} // sigma of timestep t
+
+  void push_scalar_field(const ndarray<double>& scalar); // builds the scale space
+  void update(); // sweeps all levels; call finalize() afterwards
+
+  void update_timestep();
+
+protected:
+  void set_default_sources();
+  std::vector<lattice> candidate_domains() const;
+
+protected:
+  std::vector<double> sigmas;
+  double search_radius = 1.0;
+  std::vector<ndarray<double>> levels; // finest first
+};
+
+////////////////////
+inline void critical_point_tracker_2d_scale_space::set_default_sources()
+{
+  scalar_field_source = SOURCE_GIVEN;
+  vector_field_source = SOURCE_DERIVED;
+  jacobian_field_source = SOURCE_DERIVED;
+}
+
+inline void critical_point_tracker_2d_scale_space::set_scales(double sigma0, double sigma1, int nlevels)
+{
+  sigmas.resize(nlevels);
+  for (int i = 0; i < nlevels; i ++)
+    sigmas[i] = nlevels == 1 ? sigma0 : sigma0 * std::pow(sigma1 / sigma0, double(i) / (nlevels - 1));
+}
+
+inline void critical_point_tracker_2d_scale_space::push_scalar_field(const ndarray<double>& scalar)
+{
+  levels.clear();
+  levels.reserve(sigmas.size());
+
+  // cascaded smoothing: G(s1) * f = G(sqrt(s1^2 - s0^2)) * (G(s0) * f)
+  double s0 = 0.0;
+  for (size_t i = 0; i < sigmas.size(); i ++) {
+    const double ds = std::sqrt(sigmas[i] * sigmas[i] - s0 * s0);
+    const ndarray<double> &prev = i == 0 ? scalar : levels.back();
+    if (ds > 0) levels.push_back(gaussian_filter(prev, ds));
+    else levels.push_back(prev);
+    s0 = sigmas[i];
+  }
+}
+
+inline void critical_point_tracker_2d_scale_space::update()
+{
+  for (size_t t = 0; t < levels.size(); t ++) {
+    push_scalar_field_snapshot(levels[levels.size() - 1 - t].view()); // levels outlive the snapshots
+    if (t != 0) advance_timestep();
+  }
+  update_timestep(); // the finest level
+}
+
+inline void critical_point_tracker_2d_scale_space::update_timestep()
+{
+  if (current_timestep > 0 && search_radius > 0) {
+    const auto domains = candidate_domains();
+    if (domains.empty()) return; // nothing survives at the coarser level
+    set_local_sweep_domains(domains);
+  }
+
+  critical_point_tracker_2d_regular::update_timestep();
+}
+
+inline std::vector<lattice> critical_point_tracker_2d_scale_space::candidate_domains() const
+{
+  const double r = search_radius * get_scale(current_timestep - 1) + 2;
+
+  // boxes around the critical points of the coarser level, as {x0, y0, x1, y1}
+  std::vector<std::array<long, 4>> boxes;
+  for (const auto &kv : discrete_critical_points) {
+    const auto &cp = kv.second;
+    if (cp[2] < current_timestep - 1) continue;
+    boxes.push_back({{
+      static_cast<long>(std::floor(cp[0] - r)),
+      static_cast<long>(std::floor(cp[1] - r)),
+      static_cast<long>(std::ceil(cp[0] + r)) + 1,
+      static_cast<long>(std::ceil(cp[1] + r)) + 1}});
+  }
+
+  // merge overlapping boxes, so that no cell is swept twice
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (size_t i = 0; i < boxes.size() && !merged; i ++)
+      for (size_t j = i + 1; j < boxes.size() && !merged; j ++) {
+        auto &a = boxes[i], &b = boxes[j];
+        if (a[0] < b[2] && b[0] < a[2] && a[1] < b[3] && b[1] < a[3]) {
+          a = {{std::min(a[0], b[0]), std::min(a[1], b[1]), std::max(a[2], b[2]), std::max(a[3], b[3])}};
+          boxes.erase(boxes.begin() + j);
+          merged = true;
+        }
+      }
+  }
+
+  std::vector<lattice> domains;
+  for (const auto &b : boxes) {
+    const long x0 = std::max(b[0], 0L), y0 = std::max(b[1], 0L);
+    if (b[2] > x0 && b[3] > y0)
+      domains.push_back(lattice({size_t(x0), size_t(y0)}, {size_t(b[2] - x0), size_t(b[3] - y0)}));
+  }
+  return domains;
+}
+
+}
+
+#endif
@@ -60,6 +60,9 @@ struct critical_point_tracker_3d_regular : public critical_point_tracker_regular
   virtual ~critical_point_tracker_3d_regular() {}
   
   void write_traced_critical_points_text(std::ostream& os) const;
+  void write_traced_critical_points_vtp(const std::string& filename, bool compressed = false) {
+    write_traced_vtp(filename, compressed, traced_critical_points);
+  }
   void write_discrete_critical_points_text(std::ostream &os) const;
 
   void initialize();
@@ -67,8 +70,12 @@ struct critical_point_tracker_3d_regular : public critical_point_tracker_regular
 
   void update_timestep();
   
+  using critical_point_tracker_regular::push_scalar_field_snapshot;
+  using critical_point_tracker_regular::push_vector_field_snapshot;
   void push_scalar_field_snapshot(const ndarray<double>&);
   void push_vector_field_snapshot(const ndarray<double>&);
+  void push_scalar_field_snapshot(const ndarray_view<const double>&);
+  void push_vector_field_snapshot(const ndarray_view<const double>&);
   
 #if FTK_HAVE_VTK
   virtual vtkSmartPointer<vtkPolyData> get_traced_critical_points_vtk() const;
@@ -116,17 +123,17 @@ void critical_point_tracker_3d_regular::initialize()
   if (use_default_domain_partition) {
     lattice_partitioner partitioner(domain);
     
-    // a ghost size of 2 is necessary for jacobian derivaition; 
-    // even if jacobian is not necessary, a ghost size of 1 is 
-    // necessary for accessing values on boundaries
+    // only the cores are used; the ghost layers of partial input arrays 
+    // may extend beyond the domain, see default_local_array_domain()
     partitioner.partition(comm.size(), {}, {2, 2, 2});
 
     local_domain = partitioner.get_core(comm.rank());
-    local_array_domain = partitioner.get_ext(comm.rank());
   }
 
   if (!is_input_array_partial)
     local_array_domain = array_domain;
+  else if (use_default_domain_partition || local_array_domain.nd() == 0)
+    local_array_domain = default_local_array_domain();
 }
 
 void critical_point_tracker_3d_regular::finalize()
@@ -140,29 +147,45 @@ void critical_point_tracker_3d_regular::finalize()
   }
 }
 
-inline void critical_point_tracker_3d_regular::push_scalar_field_snapshot(const ndarray<double>& s)
+inline void critical_point_tracker_3d_regular::push_scalar_field_snapshot(const ndarray_view<const double>& s)
 {
   field_data_snapshot_t snapshot;
   
   snapshot.scalar = s;
   if (vector_field_source == SOURCE_DERIVED) {
-    snapshot.vector = gradient3D(s);
-    if (jacobian_field_source == SOURCE_DERIVED)
-      snapshot.jacobian = jacobian3D(snapshot.vector);
+    ndarray<double> grad;
+    if (jacobian_field_source == SOURCE_DERIVED) {
+      ndarray<double> J;
+      gradient_jacobian3D(s, grad, J);
+      snapshot.jacobian = snapshot.own(std::move(J));
+    } else 
+      gradient3D(s, grad);
+    snapshot.vector = snapshot.own(std::move(grad));
   }
 
-  field_data_snapshots.emplace_back( snapshot );
+  field_data_snapshots.emplace_back( std::move(snapshot) );
 }
 
-inline void critical_point_tracker_3d_regular::push_vector_field_snapshot(const ndarray<double>& v)
+inline void critical_point_tracker_3d_regular::push_vector_field_snapshot(const ndarray_view<const double>& v)
 {
   field_data_snapshot_t snapshot;
  
   snapshot.vector = v;
   if (jacobian_field_source == SOURCE_DERIVED)
-    snapshot.jacobian = jacobian3D(snapshot.vector);
+    snapshot.jacobian = snapshot.own(jacobian3D(snapshot.vector));
 
-  field_data_snapshots.emplace_back( snapshot );
+  field_data_snapshots.emplace_back( std::move(snapshot) );
+}
+
+inline void critical_point_tracker_3d_regular::push_scalar_field_snapshot(const ndarray<double>& s)
+{
+  // keep a private copy, so that the caller may release s
+  push_scalar_field_snapshot(std::make_shared<const ndarray<double>>(s));
+}
+
+inline void critical_point_tracker_3d_regular::push_vector_field_snapshot(const ndarray<double>& v)
+{
+  push_vector_field_snapshot(std::make_shared<const ndarray<double>>(v));
 }
 
 inline void critical_point_tracker_3d_regular::update_timestep()
@@ -181,34 +204,36 @@ inline void critical_point_tracker_3d_regular::update_timestep()
     };
 
   if (xl == FTK_XL_NONE) {
-    m.element_for(3, lattice({ // ordinal
-          local_domain.start(0), 
-          local_domain.start(1), 
-          local_domain.start(2), 
-          static_cast<size_t>(current_timestep), 
-        }, {
-          local_domain.size(0), 
-          local_domain.size(1), 
-          local_domain.size(2), 
-          1
-        }), 
-        ftk::ELEMENT_SCOPE_ORDINAL, 
-        func3, nthreads);
-
-    if (field_data_snapshots.size() >= 2) { // interval
-      m.element_for(3, lattice({
-            local_domain.start(0), 
-            local_domain.start(1), 
-            local_domain.start(2), 
-            static_cast<size_t>(current_timestep - 1), 
+    for (const auto &d : get_local_sweep_domains()) {
+      m.element_for(3, lattice({ // ordinal
+            d.start(0), 
+            d.start(1), 
+            d.start(2), 
+            static_cast<size_t>(current_timestep), 
           }, {
-            local_domain.size(0), 
-            local_domain.size(1), 
-            local_domain.size(2), 
+            d.size(0), 
+            d.size(1), 
+            d.size(2), 
             1
-          }),
-          ftk::ELEMENT_SCOPE_INTERVAL, 
+          }), 
+          ftk::ELEMENT_SCOPE_ORDINAL, 
           func3, nthreads);
+
+      if (field_data_snapshots.size() >= 2) { // interval
+        m.element_for(3, lattice({
+              d.start(0), 
+              d.start(1), 
+              d.start(2), 
+              static_cast<size_t>(current_timestep - 1), 
+            }, {
+              d.size(0), 
+              d.size(1), 
+              d.size(2), 
+              1
+            }),
+            ftk::ELEMENT_SCOPE_INTERVAL, 
+            func3, nthreads);
+      }
     }
   } else if (xl == FTK_XL_CUDA) {
 #if FTK_HAVE_CUDA
@@ -317,11 +342,10 @@ void critical_point_tracker_3d_regular::trace_connected_components()
     return neighbors;
   };
 
-  std::set<element_t> elements;
+  std::vector<element_t> elements; // in order
   for (const auto &kv : discrete_critical_points)
-    elements.insert(kv.first);
-  connected_components = extract_connected_components<element_t, std::set<element_t>>(
-      neighbors, elements);
+    elements.push_back(kv.first);
+  connected_components = get_connected_components(m, elements);
 
   for (const auto &component : connected_components) {
     std::vector<std::vector<double>> mycurves;
@@ -434,21 +458,20 @@ vtkSmartPointer<vtkPolyData> critical_point_tracker_3d_regular::get_traced_criti
   vtkSmartPointer<vtkPoints> points = vtkPoints::New();
   vtkSmartPointer<vtkCellArray> cells = vtkCellArray::New();
 
+  size_t nv = 0;
   for (const auto &curve : traced_critical_points)
-    for (auto i = 0; i < curve.size(); i ++) {
-      double p[3] = {curve[i][0], curve[i][1], curve[i][2]};
-      points->InsertNextPoint(p);
-    }
+    nv += curve.size();
+  points->SetNumberOfPoints(nv);
 
-  size_t nv = 0;
+  std::vector<vtkIdType> ids;
+  vtkIdType k = 0;
   for (const auto &curve : traced_critical_points) {
-    vtkSmartPointer<vtkPolyLine> polyLine = vtkPolyLine::New();
-    polyLine->GetPointIds()->SetNumberOfIds(curve.size());
-    for (int i = 0; i < curve.size(); i ++)
-      polyLine->GetPointIds()->SetId(i, i+nv);
-
-    cells->InsertNextCell(polyLine);
-    nv += curve.size();
+    ids.resize(curve.size());
+    for (auto i = 0; i < curve.size(); i ++) {
+      points->SetPoint(k, curve[i][0], curve[i][1], curve[i][2]);
+      ids[i] = k ++;
+    }
+    cells->InsertNextCell(ids.size(), ids.data());
   }
   
   polyData->SetPoints(points);
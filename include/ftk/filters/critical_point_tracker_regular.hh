@@ -4,7 +4,13 @@
 #include <ftk/ndarray.hh>
 #include <ftk/hypermesh/lattice_partitioner.hh>
 #include <ftk/filters/critical_point_tracker.hh>
+#include <ftk/io/data_stream.hh>
 #include <ftk/external/diy-ext/gather.hh>
+#include <ftk/hypermesh/regular_simplex_mesh.hh>
+#include <ftk/basic/integer_union_find.hh>
+#include <ftk/basic/concurrent_union_find.hh>
+#include <set>
+#include <thread>
 
 namespace ftk {
 
@@ -24,10 +30,15 @@ struct critical_point_tracker_regular : public critical_point_tracker {
   void set_start_timestep(int);
   void set_end_timestep(int);
 
-  void set_use_default_domain_partition(bool b) {use_default_domain_partition = true;}
-  void set_input_array_partial(bool b) {is_input_array_partial = b;}
-  void set_local_domain(const lattice&); // rank-specific "core" region of the block
-  void set_local_array_domain(const lattice&); // rank-specific "ext" region of the block
+  void set_use_default_domain_partition(bool b) {use_default_domain_partition = b;}
+  void set_input_array_partial(bool b) {is_input_array_partial = b;} // input arrays cover only the local array domain
+  void set_local_domain(const lattice& l) {local_domain = l; use_default_domain_partition = false;} // rank-specific "core" region of the block
+  void set_local_array_domain(const lattice& l) {local_array_domain = l;} // rank-specific "ext" region of the block
+
+  // available after initialize(); with partial input, each rank reads only the local array domain
+  const lattice& get_local_domain() const {return local_domain;}
+  const lattice& get_local_array_domain() const {return local_array_domain;}
+  void set_local_sweep_domains(const std::vector<lattice>& l) {local_sweep_domains = l;} // restrict the sweep of the following timesteps to spatial subdomains of the local domain; empty for the whole local domain
 
   void set_scalar_field_source(int s) {scalar_field_source = s;}
   void set_vector_field_source(int s) {vector_field_source = s;}
@@ -36,6 +47,10 @@ struct critical_point_tracker_regular : public critical_point_tracker {
 
   virtual void push_scalar_field_snapshot(const ndarray<double>&) = 0;
   virtual void push_vector_field_snapshot(const ndarray<double>&) = 0;
+  virtual void push_scalar_field_snapshot(const ndarray_view<const double>&) = 0; // zero-copy
+  virtual void push_vector_field_snapshot(const ndarray_view<const double>&) = 0; // zero-copy
+  void push_scalar_field_snapshot(const std::shared_ptr<const ndarray<double>>&); // shared with the caller
+  void push_vector_field_snapshot(const std::shared_ptr<const ndarray<double>>&);
 
   void set_type_filter(unsigned int);
 
@@ -46,6 +61,10 @@ struct critical_point_tracker_regular : public critical_point_tracker {
   virtual bool advance_timestep();
   virtual void update_timestep() = 0;
 
+  // tracks all remaining timesteps of an initialized stream; the variable
+  // is pushed as the scalar field if given, otherwise as the vector field
+  void consume(data_stream& stream, const std::string& key);
+
   void set_coordinates(const ndarray<double>& coords_) {coords = coords_; use_explicit_coords = true;}
 #if 0
   virtual void push_snapshot_scalar_field(const ndarray<double>& scalar0) {scalar.push_back(scalar0);}
@@ -66,9 +85,18 @@ protected:
   template <int N, typename T=double>
   bool filter_critical_point_type(const critical_point_t<N, T>& cp);
 
+  std::vector<lattice> get_local_sweep_domains() const; // sweep domains clipped to the local domain
+  lattice default_local_array_domain() const; // local domain with the ghost layers needed, clipped to the array domain
+
+  // groups critical elements, given in order, into components of elements
+  // sharing a cell of the mesh
+  std::vector<std::set<regular_simplex_mesh_element>> get_connected_components(
+      const regular_simplex_mesh& m, const std::vector<regular_simplex_mesh_element>& elements) const;
+
 protected: // config
   lattice domain, array_domain, 
           local_domain, local_array_domain;
+  std::vector<lattice> local_sweep_domains;
   // lattice_partitioner partitioner;
 
   bool use_default_domain_partition = true;
@@ -101,6 +129,116 @@ inline bool critical_point_tracker_regular::advance_timestep()
   return field_data_snapshots.size() > 0;
 }
 
+inline void critical_point_tracker_regular::push_scalar_field_snapshot(const std::shared_ptr<const ndarray<double>>& s)
+{
+  push_scalar_field_snapshot(s->view());
+  field_data_snapshots.back().storage.push_back(s);
+}
+
+inline void critical_point_tracker_regular::push_vector_field_snapshot(const std::shared_ptr<const ndarray<double>>& v)
+{
+  push_vector_field_snapshot(v->view());
+  field_data_snapshots.back().storage.push_back(v);
+}
+
+inline void critical_point_tracker_regular::consume(data_stream& stream, const std::string& key)
+{
+  int k = 0;
+  while (stream.advance_timestep()) {
+    if (k >= 2) advance_timestep(); // need to push two timesteps before one can advance
+    const auto array = stream.get_ptr<double>(key); // shared with the stream, not copied
+    if (scalar_field_source == SOURCE_GIVEN) push_scalar_field_snapshot(array);
+    else push_vector_field_snapshot(array);
+    k ++;
+  }
+  if (k > 0) update_timestep(); // the last timestep
+}
+
+inline lattice critical_point_tracker_regular::default_local_array_domain() const
+{
+  // mesh elements anchored in the local domain span one more vertex on the
+  // upper side, and derived jacobians need two more layers of values on
+  // each side of a vertex
+  const size_t ghost_low = 2, ghost_high = 3;
+
+  std::vector<size_t> starts(local_domain.nd()), sizes(local_domain.nd());
+  for (size_t i = 0; i < local_domain.nd(); i ++) {
+    const size_t lo = std::max(array_domain.start(i), local_domain.start(i) - std::min(local_domain.start(i), ghost_low)),
+                 hi = std::min(array_domain.start(i) + array_domain.size(i), local_domain.start(i) + local_domain.size(i) + ghost_high);
+    starts[i] = lo;
+    sizes[i] = hi - lo;
+  }
+  return lattice(starts, sizes);
+}
+
+inline std::vector<std::set<regular_simplex_mesh_element>> critical_point_tracker_regular::get_connected_components(
+    const regular_simplex_mesh& m, const std::vector<regular_simplex_mesh_element>& elements) const
+{
+  // elements are identified by their integer indices in the mesh, which
+  // are unique for corners within the bounds
+  auto in_mesh = [&](const regular_simplex_mesh_element& f) {
+    for (int i = 0; i < m.nd(); i ++)
+      if (f.corner[i] < m.lb(i) || f.corner[i] > m.ub(i)) return false;
+    return true;
+  };
+
+  sparse_union_find<uint64_t> index(elements.size()); // only for dense ids, in order
+  for (const auto &e : elements)
+    index.add(e.to_integer<uint64_t>(m));
+
+  // neighboring elements are united by all threads without locking.  This
+  // is not done in the sweep: ids must be dense and fixed up front, the
+  // elements of other processes are only known after the gather, and the
+  // CUDA sweep has no per-element callback
+  concurrent_union_find uf(elements.size());
+  auto unite_neighbors = [&](int tid) {
+    for (size_t i = tid; i < elements.size(); i += nthreads)
+      for (const auto &c : elements[i].side_of(m))
+        for (const auto &f : c.sides(m))
+          if (in_mesh(f)) {
+            const uint32_t j = index.id(f.to_integer<uint64_t>(m));
+            if (j != index.none) uf.unite(i, j);
+          }
+  };
+  std::vector<std::thread> workers;
+  for (int tid = 1; tid < nthreads; tid ++)
+    workers.push_back(std::thread(unite_neighbors, tid));
+  unite_neighbors(0);
+  for (auto &w : workers) w.join();
+
+  std::vector<size_t> offsets;
+  std::vector<uint64_t> ids;
+  const size_t ncomponents = uf.get_sets(offsets, ids);
+  std::vector<std::set<regular_simplex_mesh_element>> components(ncomponents);
+  for (size_t k = 0; k < ncomponents; k ++)
+    for (size_t j = offsets[k]; j < offsets[k+1]; j ++) // ids are in order
+      components[k].insert(components[k].end(), elements[ids[j]]);
+  return components;
+}
+
+inline std::vector<lattice> critical_point_tracker_regular::get_local_sweep_domains() const
+{
+  if (local_sweep_domains.empty()) 
+    return {local_domain};
+
+  std::vector<lattice> results;
+  for (const auto &l : local_sweep_domains) {
+    std::vector<size_t> starts(local_domain.nd()), sizes(local_domain.nd());
+    bool empty = false;
+    for (size_t i = 0; i < local_domain.nd(); i ++) {
+      const size_t lo = std::max(l.start(i), local_domain.start(i)), 
+                   hi = std::min(l.start(i) + l.size(i), local_domain.start(i) + local_domain.size(i));
+      if (lo >= hi) empty = true;
+      else {
+        starts[i] = lo;
+        sizes[i] = hi - lo;
+      }
+    }
+    if (!empty) results.push_back(lattice(starts, sizes));
+  }
+  return results;
+}
+
 inline void critical_point_tracker_regular::set_type_filter(unsigned int f)
 {
   use_type_filter = true;
@@ -2,7 +2,11 @@
 #define _FTK_LEVELSET_TRACKER
 
 #include <ftk/filters/connected_component_tracker.hh>
-#include <ftk/algorithms/hoshen_kopelman.hh>
+#include <ftk/algorithms/parallel_ccl.hh>
+#include <ftk/basic/distributed_integer_union_find.hh>
+#include <ftk/hypermesh/lattice_partitioner.hh>
+#include <ftk/io/data_stream.hh>
+#include <stdexcept>
 
 namespace ftk {
 
@@ -13,7 +17,13 @@ enum {
   FTK_COMPARE_LT // less than
 };
 
-template <typename TimeIndexType=size_t, typename LabelIdType=size_t>
+// Tracks the connected components of the region of a scalar field above
+// (or below) a threshold.  With partial input arrays, the domain is
+// partitioned regularly among processes, and each process is given only
+// its local array domain, the core and one ghost layer, and labels the
+// core; components crossing cores are merged with a distributed
+// union-find, so that labels are the same as with a single process.
+template <typename TimeIndexType=size_t, typename LabelIdType=uint32_t>
 struct levelset_tracker : public connected_component_tracker<TimeIndexType, LabelIdType>
 {
   levelset_tracker() {}
@@ -22,16 +32,45 @@ struct levelset_tracker : public connected_component_tracker<TimeIndexType, Labe
   void set_threshold(double threshold, int mode=FTK_COMPARE_GE);
   void set_input_shape(const lattice& shape);
 
+  void set_domain(const lattice& l) {domain = l;} // whole domain, for partial input arrays
+  void set_input_array_partial(bool b) {is_input_array_partial = b;} // input arrays cover only the local array domain
+  void initialize(); // partitions the domain if the input arrays are partial; throws if it cannot
+
   template <typename FloatType>
   void push_scalar_field_data_snapshot(const ndarray<FloatType>&);
 
-  ndarray<LabelIdType> get_last_labeled_array_snapshot() const;
+  template <typename FloatType>
+  void push_scalar_field_data_snapshot(const ndarray_view<FloatType>&);
+
+  ndarray<LabelIdType> get_last_labeled_array_snapshot() const; // of the local domain
+  const lattice& get_local_domain() const {return local_domain;} // the core of this process
+  const lattice& get_local_array_domain() const {return local_array_domain;} // available after initialize()
+
+  void consume(data_stream& stream, const std::string& key); // tracks all remaining timesteps of a stream
+
+protected:
+  bool in_levelset(double value) const;
+
+  // thresholds and labels an array; returns the number of components
+  template <typename FloatType>
+  size_t label(const ndarray_view<FloatType>& array, std::vector<LabelIdType>& labels,
+      std::vector<component_attributes>& attributes) const;
+
+  template <typename FloatType>
+  void push_distributed_scalar_field_data_snapshot(const ndarray_view<FloatType>&);
 
 protected:
   double threshold = 0.0;
   int mode = FTK_COMPARE_GE;
 
   std::vector<size_t> input_shape;
+  lattice domain, local_domain, local_array_domain;
+  bool is_input_array_partial = false;
+
+  // owners of elements of the domain; cores form a grid with cuts at
+  // their starts, relative to the domain
+  std::vector<size_t> cuts[3];
+  std::vector<int> grid_owner;
 };
 
 ///////////////
@@ -42,35 +81,263 @@ void levelset_tracker<TimeIndexType, LabelIdType>::set_threshold(double t, int m
   mode = m;
 }
 
+template <typename TimeIndexType, typename LabelIdType>
+void levelset_tracker<TimeIndexType, LabelIdType>::initialize()
+{
+  if (!is_input_array_partial) { // every process is given whole arrays
+    local_domain = local_array_domain = domain;
+    return;
+  }
+
+  const auto &comm = this->comm;
+  const int nd = domain.nd();
+  if (nd != 2 && nd != 3) 
+    throw std::invalid_argument("[FTK] levelset tracking needs a 2D or 3D domain");
+
+  lattice_partitioner partitioner(domain);
+  // only the cores are labeled; the ghost layers are the face neighbors
+  // read when merging components across cores
+  partitioner.partition(comm.size(), {}, std::vector<size_t>(nd, 1));
+  if (partitioner.np() != size_t(comm.size()))
+    throw std::runtime_error("[FTK] cannot partition the domain for " + std::to_string(comm.size()) + " processes");
+
+  local_domain = partitioner.get_core(comm.rank());
+  local_array_domain = partitioner.get_ext(comm.rank());
+
+  for (int d = 0; d < 3; d ++) {
+    cuts[d].clear();
+    for (size_t p = 0; p < partitioner.np(); p ++)
+      cuts[d].push_back(d < nd ? partitioner.get_core(p).start(d) - domain.start(d) : 0);
+    std::sort(cuts[d].begin(), cuts[d].end());
+    cuts[d].erase(std::unique(cuts[d].begin(), cuts[d].end()), cuts[d].end());
+  }
+
+  grid_owner.resize(cuts[0].size() * cuts[1].size() * cuts[2].size());
+  for (size_t p = 0; p < partitioner.np(); p ++) {
+    size_t c[3] = {0, 0, 0};
+    for (int d = 0; d < nd; d ++)
+      c[d] = std::lower_bound(cuts[d].begin(), cuts[d].end(), partitioner.get_core(p).start(d) - domain.start(d)) - cuts[d].begin();
+    grid_owner[c[0] + cuts[0].size() * (c[1] + cuts[1].size() * c[2])] = p;
+  }
+
+  // the snapshots of processes are parts of the same domain
+  this->set_distributed(true);
+}
+
 template <typename TimeIndexType, typename LabelIdType>
 template <typename FloatType>
 void levelset_tracker<TimeIndexType, LabelIdType>::push_scalar_field_data_snapshot(const ndarray<FloatType>& array)
 {
+  push_scalar_field_data_snapshot(array.view());
+}
+
+template <typename TimeIndexType, typename LabelIdType>
+bool levelset_tracker<TimeIndexType, LabelIdType>::in_levelset(double value) const
+{
+  switch (mode) {
+  case FTK_COMPARE_GE: return value >= threshold;
+  case FTK_COMPARE_GT: return value > threshold;
+  case FTK_COMPARE_LE: return value <= threshold;
+  case FTK_COMPARE_LT: return value < threshold;
+  default: return false;
+  }
+}
+
+template <typename TimeIndexType, typename LabelIdType>
+template <typename FloatType>
+size_t levelset_tracker<TimeIndexType, LabelIdType>::label(const ndarray_view<FloatType>& array, 
+    std::vector<LabelIdType>& labels, std::vector<component_attributes>& attributes) const
+{
+  typedef typename ndarray_view<FloatType>::value_type value_type;
+  std::vector<value_type> dense; // strided views are thresholded in logical order
+  const value_type *p = array.data();
+  if (!array.is_contiguous()) {
+    dense.resize(array.nelem());
+    array.copy_to(dense.data());
+    p = dense.data();
+  }
+
+  // threshold to a bitmask
+  std::vector<uint64_t> mask;
+  const size_t n = array.nelem();
+  switch (mode) {
+  case FTK_COMPARE_GE: threshold_bitmask<std::greater_equal<double>>(p, n, threshold, mask, this->nthreads); break;
+  case FTK_COMPARE_GT: threshold_bitmask<std::greater<double>>(p, n, threshold, mask, this->nthreads); break;
+  case FTK_COMPARE_LE: threshold_bitmask<std::less_equal<double>>(p, n, threshold, mask, this->nthreads); break;
+  case FTK_COMPARE_LT: threshold_bitmask<std::less<double>>(p, n, threshold, mask, this->nthreads); break;
+  default: mask.assign((n + 63) / 64, 0); break;
+  }
+
+  // label w/ ccl, accumulating the attributes of components
+  labels.resize(n);
+  return parallel_ccl_bitmask(mask, array.shape(), labels.data(), this->nthreads, p, &attributes);
+}
+
+template <typename TimeIndexType, typename LabelIdType>
+template <typename FloatType>
+void levelset_tracker<TimeIndexType, LabelIdType>::push_scalar_field_data_snapshot(const ndarray_view<FloatType>& array)
+{
+  if (array.nd() != 2 && array.nd() != 3) assert(false); // not yet implemented
+
+  if (is_input_array_partial) {
+    push_distributed_scalar_field_data_snapshot(array);
+    return;
+  }
+
   input_shape = array.shape();
+  local_domain = lattice(input_shape);
+
+  std::vector<LabelIdType> labels;
+  std::vector<component_attributes> attributes;
+  label(array, labels, attributes);
+
+  this->push_labeled_data_snapshot(std::move(labels), attributes);
+}
+
+template <typename TimeIndexType, typename LabelIdType>
+template <typename FloatType>
+void levelset_tracker<TimeIndexType, LabelIdType>::push_distributed_scalar_field_data_snapshot(const ndarray_view<FloatType>& array)
+{
+  const auto &comm = this->comm;
+  const int nd = array.nd();
+  if (array.shape() != local_array_domain.sizes()) 
+    throw std::invalid_argument("[FTK] the input array does not cover the local array domain");
+  input_shape = domain.sizes();
+
+  // 2D domains have a third dimension of size 1; starts of the core are
+  // relative to the domain, offsets relative to the local array domain
+  size_t dims[3] = {1, 1, 1}, starts[3] = {0, 0, 0}, sizes[3] = {1, 1, 1}, 
+         offsets[3] = {0, 0, 0}, ext_dims[3] = {1, 1, 1};
+  for (int d = 0; d < nd; d ++) {
+    dims[d] = domain.size(d);
+    starts[d] = local_domain.start(d) - domain.start(d);
+    sizes[d] = local_domain.size(d);
+    offsets[d] = local_domain.start(d) - local_array_domain.start(d);
+    ext_dims[d] = local_array_domain.size(d);
+  }
+  const uint64_t strides[3] = {1, dims[0], dims[0] * dims[1]}, 
+                 ext_strides[3] = {1, ext_dims[0], ext_dims[0] * ext_dims[1]};
+
+  // label the core of this process
+  std::vector<LabelIdType> labels;
+  std::vector<component_attributes> attributes;
+  const size_t nlocal = label(array.slice(
+        std::vector<size_t>(offsets, offsets + nd), local_domain.sizes()), labels, attributes);
+
+  auto cell = [&](int d, size_t x) -> size_t {
+    return std::upper_bound(cuts[d].begin(), cuts[d].end(), x) - cuts[d].begin() - 1;
+  };
+  auto owner = [&](uint64_t i) {
+    const size_t x = i % dims[0], y = (i / dims[0]) % dims[1], z = i / strides[2];
+    return grid_owner[cell(0, x) + cuts[0].size() * (cell(1, y) + cuts[1].size() * cell(2, z))];
+  };
+
+  auto global_index = [&](size_t x, size_t y, size_t z) {
+    return (x + starts[0]) * strides[0] + (y + starts[1]) * strides[1] + (z + starts[2]) * strides[2];
+  };
+  auto ext_index = [&](size_t x, size_t y, size_t z) {
+    return (x + offsets[0]) * ext_strides[0] + (y + offsets[1]) * ext_strides[1] + (z + offsets[2]) * ext_strides[2];
+  };
+
+  // each local component is represented by its first element, which is
+  // the smallest global index of the component in the core
+  std::vector<uint64_t> reps(nlocal);
+  LabelIdType next = 1;
+  for (size_t z = 0, i = 0; z < sizes[2]; z ++)
+    for (size_t y = 0; y < sizes[1]; y ++)
+      for (size_t x = 0; x < sizes[0]; x ++, i ++)
+        if (labels[i] == next)
+          reps[(next ++) - 1] = global_index(x, y, z);
 
-  ndarray<LabelIdType> labels; 
-  labels.reshape(array);
-  for (auto i = 0; i < array.nelem(); i ++) {
-    switch (mode) {
-    case FTK_COMPARE_GE: labels[i] = array[i] >= threshold; break;
-    case FTK_COMPARE_GT: labels[i] = array[i] > threshold; break;
-    case FTK_COMPARE_LE: labels[i] = array[i] <= threshold; break;
-    case FTK_COMPARE_LT: labels[i] = array[i] < threshold; break;
-    default: break;
+  distributed_integer_union_find uf(comm, owner);
+  for (const auto r : reps)
+    uf.add(r);
+
+  // an element on a face of the core is united with its component if the
+  // neighbor across the face is in the levelset; the neighbor, owned by
+  // another process, is united likewise by its owner
+  for (int d = 0; d < nd; d ++) {
+    const bool has_low = starts[d] > 0, 
+               has_high = starts[d] + sizes[d] < dims[d];
+
+    for (int side = 0; side < 2; side ++) {
+      if ((side == 0 && !has_low) || (side == 1 && !has_high)) continue;
+
+      size_t lo[3] = {0, 0, 0}, hi[3] = {sizes[0], sizes[1], sizes[2]};
+      lo[d] = side == 0 ? 0 : sizes[d] - 1;
+      hi[d] = lo[d] + 1;
+
+      for (size_t z = lo[2]; z < hi[2]; z ++)
+        for (size_t y = lo[1]; y < hi[1]; y ++)
+          for (size_t x = lo[0]; x < hi[0]; x ++) {
+            const LabelIdType l = labels[x + sizes[0] * (y + sizes[1] * z)];
+            if (!l) continue;
+
+            const uint64_t i = global_index(x, y, z), 
+                           j = side == 0 ? i - strides[d] : i + strides[d], 
+                           k = side == 0 ? ext_index(x, y, z) - ext_strides[d] : ext_index(x, y, z) + ext_strides[d];
+            if (!in_levelset(array[k])) continue;
+
+            if (side == 0) uf.unite(reps[l-1], i);
+            else uf.unite(reps[l-1], j);
+          }
     }
   }
 
-  // relabel w/ ccl
-  if (array.nd() == 2) hoshen_kopelman_2d(labels);
-  else assert(false); // not yet implemented
+  uf.exchange();
+
+  // roots are the first elements of global components; components are
+  // labeled in the order of their roots, as with a single process
+  std::vector<uint64_t> roots(nlocal), owned_roots;
+  for (size_t k = 0; k < nlocal; k ++) {
+    roots[k] = uf.find(reps[k]);
+    if (roots[k] == reps[k]) owned_roots.push_back(roots[k]);
+  }
+
+  std::vector<std::vector<uint64_t>> gathered_roots;
+  diy::mpi::all_gather(comm, owned_roots, gathered_roots);
+  std::vector<uint64_t> all_roots;
+  for (const auto &r : gathered_roots)
+    all_roots.insert(all_roots.end(), r.begin(), r.end());
+  std::sort(all_roots.begin(), all_roots.end());
+
+  std::vector<LabelIdType> global_labels(nlocal);
+  for (size_t k = 0; k < nlocal; k ++)
+    global_labels[k] = std::lower_bound(all_roots.begin(), all_roots.end(), roots[k]) - all_roots.begin() + 1;
+  for (auto &l : labels)
+    if (l) l = global_labels[l-1];
 
-  this->push_labeled_data_snapshot(labels.std_vector());
+  // attributes of the parts of components are merged on rank 0
+  std::vector<std::pair<LabelIdType, component_attributes>> partials, all_partials;
+  for (size_t k = 0; k < nlocal; k ++) {
+    attributes[k].translate(starts[0], starts[1], starts[2]);
+    partials.push_back(std::make_pair(global_labels[k], attributes[k]));
+  }
+  diy::mpi::gatherv(comm, partials, all_partials, 0);
+
+  attributes.clear();
+  if (comm.rank() == 0) {
+    attributes.resize(all_roots.size());
+    for (const auto &p : all_partials)
+      attributes[p.first - 1].merge(p.second);
+  }
+
+  this->push_labeled_data_snapshot(std::move(labels), attributes);
+}
+
+template <typename TimeIndexType, typename LabelIdType>
+void levelset_tracker<TimeIndexType, LabelIdType>::consume(data_stream& stream, const std::string& key)
+{
+  while (stream.advance_timestep()) {
+    push_scalar_field_data_snapshot(stream.get<double>(key));
+    this->advance_timestep();
+  }
 }
 
 template <typename TimeIndexType, typename LabelIdType>
 ndarray<LabelIdType> levelset_tracker<TimeIndexType, LabelIdType>::get_last_labeled_array_snapshot() const
 {
-  ndarray<LabelIdType> array(input_shape);
+  ndarray<LabelIdType> array(local_domain.sizes());
   array.from_vector(this->get_last_labeled_data_snapshot());
   return array;
 }
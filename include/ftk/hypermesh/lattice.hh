@@ -143,15 +143,13 @@ inline void lattice::reshape(const std::vector<int> &sizes)
 }
 
 template <typename uint> 
-inline uint lattice::to_integer(const std::vector<int> &idx1) const
+inline uint lattice::to_integer(const std::vector<int> &idx) const
 {
-  std::vector<int> idx(idx1);
-  for (auto j = 0; j < nd(); j ++)
-    idx[j] -= starts_[j];
-
-  uint i(idx[0]);
-  for (auto j = 1; j < nd(); j ++)
-    i += idx[j] * prod_[j];
+  // offsets and strides are accumulated in uint; an int product would 
+  // overflow past 2^31 elements
+  uint i = static_cast<uint>(idx[0] - static_cast<long long>(starts_[0]));
+  for (size_t j = 1; j < nd(); j ++)
+    i += static_cast<uint>(idx[j] - static_cast<long long>(starts_[j])) * static_cast<uint>(prod_[j]);
   return i;
 }
 
@@ -159,11 +157,12 @@ template <typename uint>
 inline std::vector<int> lattice::from_integer(uint i) const
 {
   std::vector<int> idx(nd());
-  for (auto j = nd()-1; j > 0; j --) {
-    idx[j] = i / prod_[j];
-    i -= idx[j] * prod_[j];
+  for (size_t j = nd()-1; j > 0; j --) {
+    const uint q = i / prod_[j];
+    idx[j] = static_cast<int>(q);
+    i -= q * prod_[j];
   }
-  idx[0] = i;
+  idx[0] = static_cast<int>(i);
 
   for (auto j = 0; j < nd(); j ++)
     idx[j] += starts_[j];
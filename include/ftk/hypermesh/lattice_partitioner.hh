@@ -80,13 +80,11 @@ inline bool is_vector_zero(const std::vector<size_t> vec) {
 }
 
 inline void lattice_partitioner::partition(size_t np) {
-  std::vector<size_t> vector_zero(0, nd());
-  partition(np, vector_zero, vector_zero, vector_zero);
+  partition(np, {}, {}, {});
 }
 
 inline void lattice_partitioner::partition(size_t np, const std::vector<size_t> &given) {
-  std::vector<size_t> vector_zero(0, nd());
-  partition(np, given, vector_zero, vector_zero); 
+  partition(np, given, {}, {}); 
 }
 
 inline void lattice_partitioner::partition(size_t np, const std::vector<size_t> &given, const std::vector<size_t> &ghost)
@@ -159,7 +157,11 @@ inline void lattice_partitioner::partition(size_t np,
 
   if (cores.size() == 0) return;
 
-  // apply ghosts
+  // apply ghosts; missing ghost sizes are zero
+  auto ghost_size = [](const std::vector<size_t>& ghost, int d) {
+    return d < ghost.size() ? ghost[d] : size_t(0);
+  };
+
   for(const auto& core : cores) {
     auto starts = core.starts(), 
          sizes = core.sizes();
@@ -168,8 +170,8 @@ inline void lattice_partitioner::partition(size_t np,
       // ghost_low layer
       {
         size_t offset = starts[d] - l.start(d); 
-        if(ghost_low[d] < offset) {
-          offset = ghost_low[d]; 
+        if(ghost_size(ghost_low, d) < offset) {
+          offset = ghost_size(ghost_low, d); 
         }
 
         starts[d] -= offset; 
@@ -179,8 +181,8 @@ inline void lattice_partitioner::partition(size_t np,
       // ghost_high layer
       {
         size_t offset = (l.start(d) + l.size(d)) - (starts[d] + sizes[d]); 
-        if(ghost_high[d] < offset) {
-          offset = ghost_high[d]; 
+        if(ghost_size(ghost_high, d) < offset) {
+          offset = ghost_size(ghost_high, d); 
         }
 
         sizes[d] += offset;
@@ -210,7 +210,7 @@ private:
   const int nd_;
   std::vector<int> lb_, ub_; // lower and upper bounds of each dimension
   std::vector<int> ntypes_, ntypes_ordinal_, ntypes_interval_; // number of types for k-simplex
-  std::vector<int> dimprod_;
+  std::vector<size_t> dimprod_; // strides of corners; 64-bit to support >2^31 vertices
 
   struct lattice lattice_; 
 
@@ -398,8 +398,17 @@ inline std::ostream& operator<<(std::ostream& os, const regular_simplex_mesh_ele
 
 inline size_t regular_simplex_mesh_element::to_work_index(const regular_simplex_mesh& m, const lattice& l, int scope) const
 {
-  size_t idx = l.to_integer(corner);
-  return idx * m.ntypes(dim, scope);
+  size_t itype = type; // index of the type within the given scope
+  if (scope == ELEMENT_SCOPE_ORDINAL) {
+    const auto &types = m.unit_ordinal_simplex_types[dim];
+    itype = std::find(types.begin(), types.end(), type) - types.begin();
+  } else if (scope == ELEMENT_SCOPE_INTERVAL) {
+    const auto &types = m.unit_interval_simplex_types[dim];
+    itype = std::find(types.begin(), types.end(), type) - types.begin();
+  }
+
+  const size_t idx = l.to_integer<size_t>(corner);
+  return idx * m.ntypes(dim, scope) + itype;
 }
 
 inline void regular_simplex_mesh_element::from_work_index(const regular_simplex_mesh& m, size_t i, const lattice& l, int scope)
@@ -422,7 +431,7 @@ uint regular_simplex_mesh_element::to_integer(const regular_simplex_mesh& m) con
 {
   uint corner_index = 0;
   for (size_t i = 0; i < m.nd(); i ++)
-    corner_index += (corner[i] - m.lb(i)) * m.dimprod_[i];
+    corner_index += static_cast<uint>(corner[i] - m.lb(i)) * static_cast<uint>(m.dimprod_[i]);
   return corner_index * m.ntypes(dim) + type;
 }
 
@@ -433,8 +442,9 @@ void regular_simplex_mesh_element::from_integer(const regular_simplex_mesh& m, u
   uint corner_index = index / m.ntypes(dim); // m.dimprod_[m.nd()];
 
   for (int i = m.nd() - 1; i >= 0; i --) {
-    corner[i] = corner_index / m.dimprod_[i]; 
-    corner_index -= corner[i] * m.dimprod_[i];
+    const uint q = corner_index / m.dimprod_[i];
+    corner[i] = static_cast<int>(q);
+    corner_index -= q * m.dimprod_[i];
   }
   for (int i = 0; i < m.nd(); i ++) 
     corner[i] += m.lb(i);
@@ -830,7 +840,7 @@ inline void regular_simplex_mesh::set_lb_ub(const std::vector<int>& l, const std
 
   for (int i = 0; i < nd()+1; i ++) {
     if (i == 0) dimprod_[i] = 1;
-    else dimprod_[i] = (u[i-1] - l[i-1] + 1) * dimprod_[i-1];
+    else dimprod_[i] = static_cast<size_t>(u[i-1] - l[i-1] + 1) * dimprod_[i-1];
   }
 }
 
@@ -917,7 +927,7 @@ inline void regular_simplex_mesh::element_for(
   const auto ntasks = l.n() * ntypes(d, scope);
   // fprintf(stderr,  "ntasks=%lu\n", ntasks);
 #if FTK_HAVE_KOKKOS
-  Kokkos::parallel_for("element_for", ntasks, KOKKOS_LAMBDA(const int& j) {f(j);});
+  Kokkos::parallel_for("element_for", ntasks, KOKKOS_LAMBDA(const size_t& j) {lambda(j);});
 #elif FTK_HAVE_TBB
   tbb::parallel_for(tbb::blocked_range<size_t>(0, ntasks),
       [=](const tbb::blocked_range<size_t>& r) {
@@ -0,0 +1,140 @@
+#ifndef _FTK_BOV_HH
+#define _FTK_BOV_HH
+
+#include <ftk/ftk_config.hh>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+
+namespace ftk {
+
+// header of a brick-of-values (.bov) file, as used by VisIt
+struct bov_header {
+  std::string data_file; // resolved against the directory of the header
+  std::vector<size_t> data_size; // x, y, z
+  std::string dtype; // in numpy notation, e.g. "f4"
+  std::string variable = "data";
+  size_t components = 1;
+  size_t byte_offset = 0;
+  bool big_endian = false;
+  double time = 0.0;
+
+  bool parse(const std::string& filename);
+  void write(const std::string& filename) const;
+
+  std::vector<size_t> dims() const; // {x, y[, z]}, or {components, x, y[, z]}
+
+  static std::string dtype_from_format(const std::string& format);
+  static std::string format_from_dtype(const std::string& dtype);
+};
+
+///////
+inline std::string bov_header::dtype_from_format(const std::string& f)
+{
+  if (f == "BYTE") return "u1";
+  else if (f == "SHORT") return "i2";
+  else if (f == "INT") return "i4";
+  else if (f == "FLOAT") return "f4";
+  else if (f == "DOUBLE") return "f8";
+  else return std::string();
+}
+
+inline std::string bov_header::format_from_dtype(const std::string& t)
+{
+  if (t == "u1") return "BYTE";
+  else if (t == "i2") return "SHORT";
+  else if (t == "i4") return "INT";
+  else if (t == "f4") return "FLOAT";
+  else if (t == "f8") return "DOUBLE";
+  else return std::string();
+}
+
+inline bool bov_header::parse(const std::string& filename)
+{
+  std::ifstream in(filename);
+  if (!in.is_open()) return false;
+
+  std::string line;
+  while (std::getline(in, line)) {
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos || line[0] == '#') continue;
+
+    std::string key = line.substr(0, colon);
+    key.erase(std::remove(key.begin(), key.end(), ' '), key.end());
+    std::transform(key.begin(), key.end(), key.begin(), ::toupper);
+    std::istringstream ss(line.substr(colon + 1));
+
+    if (key == "DATA_FILE") ss >> data_file;
+    else if (key == "DATA_SIZE") {
+      size_t n;
+      data_size.clear();
+      while (ss >> n) data_size.push_back(n);
+    } else if (key == "DATA_FORMAT") {
+      std::string f;
+      ss >> f;
+      std::transform(f.begin(), f.end(), f.begin(), ::toupper);
+      dtype = dtype_from_format(f);
+    } else if (key == "VARIABLE") ss >> variable;
+    else if (key == "DATA_COMPONENTS") ss >> components;
+    else if (key == "BYTE_OFFSET") ss >> byte_offset;
+    else if (key == "TIME") ss >> time;
+    else if (key == "DATA_ENDIAN") {
+      std::string e;
+      ss >> e;
+      std::transform(e.begin(), e.end(), e.begin(), ::toupper);
+      big_endian = e == "BIG";
+    }
+  }
+
+  if (data_file.empty() || data_size.empty() || dtype.empty()) return false;
+
+  const size_t slash = filename.find_last_of('/');
+  if (data_file[0] != '/' && slash != std::string::npos)
+    data_file = filename.substr(0, slash + 1) + data_file;
+
+  return true;
+}
+
+inline void bov_header::write(const std::string& filename) const
+{
+  std::string f = data_file;
+  const size_t slash = f.find_last_of('/'); // relative to the header
+  if (slash != std::string::npos) f = f.substr(slash + 1);
+
+  std::ofstream out(filename);
+  out << "TIME: " << time << std::endl
+      << "DATA_FILE: " << f << std::endl
+      << "DATA_SIZE:";
+  for (size_t i = 0; i < 3; i ++)
+    out << " " << (i < data_size.size() ? data_size[i] : 1);
+  out << std::endl
+      << "DATA_FORMAT: " << format_from_dtype(dtype) << std::endl
+      << "VARIABLE: " << variable << std::endl
+      << "DATA_ENDIAN: LITTLE" << std::endl
+      << "CENTERING: nodal" << std::endl
+      << "BRICK_ORIGIN: 0 0 0" << std::endl
+      << "BRICK_SIZE:";
+  for (size_t i = 0; i < 3; i ++)
+    out << " " << (i < data_size.size() ? data_size[i] : 1);
+  out << std::endl;
+  if (components > 1)
+    out << "DATA_COMPONENTS: " << components << std::endl;
+  if (byte_offset > 0)
+    out << "BYTE_OFFSET: " << byte_offset << std::endl;
+}
+
+inline std::vector<size_t> bov_header::dims() const
+{
+  std::vector<size_t> d;
+  if (components > 1) d.push_back(components);
+  d.insert(d.end(), data_size.begin(), data_size.end());
+  if (data_size.size() == 3 && data_size[2] == 1) d.pop_back(); // 2D
+  return d;
+}
+
+}
+
+#endif
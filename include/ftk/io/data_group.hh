@@ -2,57 +2,83 @@
 #define _FTK_NDARRAY_GROUP_HH
 
 #include <ftk/ndarray.hh>
+#include <memory>
+#include <cstdint>
+#include <type_traits>
 
 namespace ftk {
 
 enum {
   NDARRAY_TYPE_FLOAT32,
   NDARRAY_TYPE_FLOAT64,
-  NDARRAY_TYPE_INT32
-  // TBA
+  NDARRAY_TYPE_INT32,
+  NDARRAY_TYPE_INT8,
+  NDARRAY_TYPE_UINT8,
+  NDARRAY_TYPE_INT16,
+  NDARRAY_TYPE_UINT16,
+  NDARRAY_TYPE_UINT32,
+  NDARRAY_TYPE_INT64,
+  NDARRAY_TYPE_UINT64,
+  NDARRAY_TYPE_CHAR,
+  NDARRAY_TYPE_LONGLONG, // the 64-bit integer distinct from int64_t, i.e. long long on LP64
+  NDARRAY_TYPE_ULONGLONG,
+  NDARRAY_TYPE_UNKNOWN
 };
 
+// char is distinct from int8_t and uint8_t; one of long and long long is
+// distinct from int64_t
+typedef std::conditional<std::is_same<int64_t, long long>::value, long, long long>::type ndarray_longlong_t;
+typedef std::conditional<std::is_same<uint64_t, unsigned long long>::value, unsigned long, unsigned long long>::type ndarray_ulonglong_t;
+
+// Named arrays of one timestep.  Arrays are immutable and held by shared
+// pointers, so that one decoded timestep can feed several consumers, e.g.
+// the snapshots of different trackers, without being copied.
 struct data_group {
   static data_group* create() {return new data_group;}
-  ~data_group() {
-    for (auto kv : data) 
-      this->free(kv.first);
-  }
-
-  std::map<std::string, std::pair<int/*type*/, void* /*ndarray*/>> data;
+  ~data_group() {}
 
   template <typename T> const ndarray<T>& get(const std::string& key) const {
-    static ndarray<T> local_null_array;
+    static const ndarray<T> local_null_array;
+    const auto p = get_ptr<T>(key);
+    return p ? *p : local_null_array;
+  }
+
+  // shared ownership; null if the key does not exist
+  template <typename T> std::shared_ptr<const ndarray<T>> get_ptr(const std::string& key) const {
     const auto it = data.find(key);
-    if (it == data.end()) {
-      return local_null_array;
-    } else {
-      assert(type<T>() == it->second.first); // make sure type is consistent
-      return *static_cast<ndarray<T>*>(it->second.second);
-    }
+    if (it == data.end()) return std::shared_ptr<const ndarray<T>>();
+    assert(type<T>() == it->second.first); // make sure type is consistent
+    return std::static_pointer_cast<const ndarray<T>>(it->second.second);
   }
 
-  template <typename T> void set(const std::string& key, const ndarray<T>& array) {
-    auto it = data.find(key);
-    if (it != data.end()) this->free(it->first);
-    data[key] = std::make_pair(type<T>(), new ndarray<T>(array));
+  template <typename T> void set(const std::string& key, const ndarray<T>& array) { // copy
+    set(key, std::make_shared<const ndarray<T>>(array));
   }
 
-  void free(const std::string& key) {
-    auto it = data.find(key);
-    if (it != data.end()) 
-      free(it->second.first, it->second.second);
+  template <typename T> void set(const std::string& key, ndarray<T>&& array) { // move
+    set(key, std::make_shared<const ndarray<T>>(std::move(array)));
   }
 
-  template <typename T> static int type();
-  template <typename T> static ndarray<T>* cast(void* p) {return static_cast<ndarray<T>*>(p);}
-  static void free(int type, void* p) {
-    if (type == NDARRAY_TYPE_FLOAT32) delete cast<float>(p);
-    else if (type == NDARRAY_TYPE_FLOAT64) delete cast<double>(p);
-    else if (type == NDARRAY_TYPE_INT32) delete cast<int>(p);
-    else assert(false);
+  template <typename T> void set(const std::string& key, std::shared_ptr<const ndarray<T>> p) { // share
+    data[key] = std::make_pair(type<T>(), std::shared_ptr<const void>(std::move(p)));
+  }
+
+  template <typename T> void set(const std::string& key, std::shared_ptr<ndarray<T>> p) {
+    set(key, std::shared_ptr<const ndarray<T>>(std::move(p)));
   }
 
+  bool has(const std::string& key) const {return data.find(key) != data.end();}
+  int type(const std::string& key) const {
+    const auto it = data.find(key);
+    return it == data.end() ? NDARRAY_TYPE_UNKNOWN : it->second.first;
+  }
+
+  void free(const std::string& key) {data.erase(key);}
+
+  template <typename T> static int type();
+
+  std::map<std::string, std::pair<int/*type*/, std::shared_ptr<const void> /*ndarray*/>> data;
+
 private: // non-copyable
   data_group() {};
   data_group(const data_group&) = delete;
@@ -60,9 +86,25 @@ private: // non-copyable
 };
 
 /////
-template<> int data_group::type<float>() {return NDARRAY_TYPE_FLOAT32;}
-template<> int data_group::type<double>() {return NDARRAY_TYPE_FLOAT64;}
-template<> int data_group::type<int>() {return NDARRAY_TYPE_INT32;}
+template <typename T> inline int data_group::type() {
+  // e.g. bool, for which ndarray has no contiguous storage
+  static_assert(sizeof(T) == 0, "unsupported ndarray type in data_group");
+  return NDARRAY_TYPE_UNKNOWN;
+}
+
+template<> inline int data_group::type<float>() {return NDARRAY_TYPE_FLOAT32;}
+template<> inline int data_group::type<double>() {return NDARRAY_TYPE_FLOAT64;}
+template<> inline int data_group::type<int8_t>() {return NDARRAY_TYPE_INT8;}
+template<> inline int data_group::type<uint8_t>() {return NDARRAY_TYPE_UINT8;}
+template<> inline int data_group::type<int16_t>() {return NDARRAY_TYPE_INT16;}
+template<> inline int data_group::type<uint16_t>() {return NDARRAY_TYPE_UINT16;}
+template<> inline int data_group::type<int32_t>() {return NDARRAY_TYPE_INT32;}
+template<> inline int data_group::type<uint32_t>() {return NDARRAY_TYPE_UINT32;}
+template<> inline int data_group::type<int64_t>() {return NDARRAY_TYPE_INT64;}
+template<> inline int data_group::type<uint64_t>() {return NDARRAY_TYPE_UINT64;}
+template<> inline int data_group::type<char>() {return NDARRAY_TYPE_CHAR;}
+template<> inline int data_group::type<ndarray_longlong_t>() {return NDARRAY_TYPE_LONGLONG;}
+template<> inline int data_group::type<ndarray_ulonglong_t>() {return NDARRAY_TYPE_ULONGLONG;}
 
 }
 
@@ -1,9 +1,18 @@
 #ifndef _FTK_REGULAR_DATA_FEED_HH
 #define _FTK_REGULAR_DATA_FEED_HH
 
+#include <ftk/ftk_config.hh>
 #include <ftk/ndarray.hh>
+#include <ftk/ndarray/synthetic.hh>
 #include <ftk/io/data_group.hh>
 #include <ftk/external/json.hh>
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
 
 namespace ftk {
 
@@ -16,22 +25,69 @@ enum {
   SYNTHETIC_ABC_FLOW
 };
 
+// Staging of timesteps.  Reader threads decode the timesteps ahead of the
+// consumer into data groups, independently of the threads of the trackers.
+// At most queue_capacity timesteps are decoded or in flight ahead of the
+// consumer; readers block when the queue is full.  The consumer moves to
+// the next timestep with advance_timestep(), and the last `history'
+// timesteps remain accessible with get(key, offset).  An exception thrown
+// by the reader of a timestep is rethrown by advance_timestep() when the
+// consumer reaches that timestep.
+//
+// Inputs are either given by a json config, e.g.
+//   {"type": "file", "filenames": "cm1out_*.nc", "variables": [{"name": "dbz"}]}
+//   {"type": "file", "format": "float32", "filenames": "*.raw", "dimensions": [128, 128],
+//    "variables": [{"name": "scalar"}]}
+//   {"type": "synthetic", "name": "woven", "width": 64, "height": 64, "n_timesteps": 32}
+// or by a user-defined reader that fills the data group of a given timestep.
 struct data_stream {
+  data_stream() {}
   data_stream(const json& j_) : j(j_) {}
+  virtual ~data_stream() {stop();}
+
+  data_stream(const data_stream&) = delete;
+  data_stream& operator=(const data_stream&) = delete;
+
+  typedef std::function<void(int/*timestep*/, data_group&)> reader_t;
+  void set_reader(reader_t r) {reader = r;} // must be thread-safe; overrides the json config
+  void set_number_of_timesteps(int n) {n_timesteps = n;}
+  void set_number_of_threads(int n) {nthreads = n;} // number of reader threads
+  void set_queue_capacity(int n) {queue_capacity = n;} // max timesteps staged ahead of the consumer
+  void set_history(int n) {history = n;} // number of consumed timesteps kept accessible
+
+  virtual void initialize(); // starts the reader threads
+  virtual void finalize() {stop();}
+
+  // blocks until the next timestep is staged; false if all timesteps are
+  // consumed.  Rethrows the exception of a failed reader, after which the
+  // timestep counts as consumed.
+  virtual bool advance_timestep();
+
+  int get_current_timestep() const {return current_timestep - 1;}
+  int get_number_of_timesteps() const {return n_timesteps;}
+  int get_history() const {return history;}
+  const json& get_json() const {return j;}
+
+  // the current timestep (offset=0) or the earlier ones
+  template <typename T> const ndarray<T>& get(const std::string& key, int offset=0) const {
+    assert(offset >= 0 && size_t(offset) < staged_data.size());
+    const size_t i = staged_data.size() - offset - 1;
+    return staged_data[i]->get<T>(key);
+  }
 
-  virtual void initialize();
-  virtual void finalize() {};
-
-  virtual void advance_timestep() {};
-
-  template <typename T> const ndarray<T>& get(const std::string& key, int offset=0) {
+  // shared ownership, e.g. for tracker snapshots that outlive the history
+  template <typename T> std::shared_ptr<const ndarray<T>> get_ptr(const std::string& key, int offset=0) const {
+    assert(offset >= 0 && size_t(offset) < staged_data.size());
     const size_t i = staged_data.size() - offset - 1;
-    return staged_data[i]->get<T>();
+    return staged_data[i]->get_ptr<T>(key);
   }
 
   void push_timestep(data_group*);
   void pop_timestep();
 
+  // serializes libraries that are not thread-safe, e.g. NetCDF and serial HDF5
+  static std::mutex& library_mutex() {static std::mutex m; return m;}
+
 protected:
   static void fatal(const std::string& str) {
     std::cerr << "FATAL: " << str << std::endl;
@@ -48,46 +104,75 @@ protected:
     return std::equal(ending.rbegin(), ending.rend(), value.rbegin());
   }
 
+  void initialize_json();
+  void read_timestep(int k, data_group& g) const; // default reader of the json config
+  ndarray<double> read_variable(const std::string& filename, const json& var) const;
+  ndarray<double> read_array(const std::string& filename, const std::string& varname) const;
+
+  void worker();
+  void stop();
+
 protected:
   json j; // configs, metadata, and everything
 
-  int current_timestep = 0;
+  int current_timestep = 0; // number of consumed timesteps
+  int n_timesteps = 0;
+  int nthreads = 1, queue_capacity = 2, history = 2;
 
-protected: 
-  std::deque<data_group*> staged_data;
+protected:
+  std::deque<data_group*> staged_data; // consumed timesteps, the latest at the back
+
+private:
+  reader_t reader;
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable cond_staged, cond_space;
+  std::map<int, data_group*> ready; // decoded timesteps ahead of the consumer
+  std::map<int, std::exception_ptr> errors; // of failed readers, by timestep
+  int next_timestep = 0; // next timestep to be claimed by a reader
+  bool stopping = false;
 };
 
 //////////////////////////////
-void data_stream::initialize()
+inline void data_stream::initialize()
 {
-  std::cerr << j << std::endl;
+  if (!reader) {
+    initialize_json();
+    reader = [this](int k, data_group& g) {read_timestep(k, g);};
+  }
+
+  if (j.contains("nthreads")) nthreads = j["nthreads"];
+  if (j.contains("queue_capacity")) queue_capacity = j["queue_capacity"];
+  if (j.contains("history")) history = j["history"];
 
+  if (n_timesteps <= 0) fatal("number of timesteps not given.");
+  nthreads = std::max(1, std::min(nthreads, n_timesteps));
+  queue_capacity = std::max(1, queue_capacity);
+  history = std::max(1, history);
+
+  stopping = false;
+  for (int i = 0; i < nthreads; i ++)
+    workers.push_back(std::thread(&data_stream::worker, this));
+}
+
+inline void data_stream::initialize_json()
+{
   if (j.contains("type")) {
     if (j["type"] == "synthetic") {
       if (j.contains("name")) {
         if (j["name"] == "woven") {
           j["nd"] = 2;
-          if (!j.contains("scaling_factor")) j["scalaring_factor"] = 15.0;
+          if (!j.contains("scaling_factor")) j["scaling_factor"] = 15.0;
         } else if (j["name"] == "double_gyre") {
           j["nd"] = 2;
         } else if (j["name"] == "merger") {
           j["nd"] = 2;
         } else fatal("synthetic case not available.");
       } else fatal("synthetic case name not given.");
-     
-#if 0
-      // default dimensions
-      if (j.contains("width")) assert(j["width"] != 0);
-      else j["width"] = 32;
-      
-      if (j.contains("height")) assert(j["height"] != 0);
-      else j["height"] = 32;
-        
-      if (j["nd"] == 3) {
-        if (j.contains("depth")) assert(j["depth"] != 0);
-        else j["depth"] = 32;
-      }
-#endif
+
+      if (!j.contains("width")) j["width"] = 32;
+      if (!j.contains("height")) j["height"] = 32;
+      if (!j.contains("time_scale")) j["time_scale"] = 1.0 / 32;
 
       if (j.contains("n_timesteps")) assert(j["n_timesteps"] != 0);
       else j["n_timesteps"] = 32;
@@ -96,10 +181,11 @@ void data_stream::initialize()
         if (!j["filenames"].is_array()) {
           auto filenames = ftk::ndarray<double>::glob(j["filenames"]);
           if (filenames.empty()) fatal("unable to find matching filename(s).");
-          if (j.contains("n_timesteps")) filenames.resize(j["n_timesteps"]);
-          else j["n_timesteps"] = filenames.size();
+          if (j.contains("n_timesteps")) filenames.resize(std::min(filenames.size(), size_t(j["n_timesteps"])));
           j["filenames"] = filenames;
         }
+        if (j["filenames"].empty()) fatal("empty filename list.");
+        j["n_timesteps"] = j["filenames"].size();
         const std::string filename0 = j["filenames"][0];
 
         if (!j.contains("format")) { // probing file format
@@ -108,150 +194,193 @@ void data_stream::initialize()
           else if (ends_with(filename0, "h5")) j["format"] = "h5";
           else fatal("unabled to determine file format.");
         }
-        
+
         if (j.contains("variables")) { // sanity check of variables
           if (j["variables"].is_array()) {
             for (const auto &v : j["variables"]) {
               if (!v.contains("name")) fatal("missing variable name");
               if (!v["name"].is_string()) fatal("invalid variable name");
-              if (!v.contains("components")) fatal("missing variable component list");
-              if (!v["components"].is_array()) fatal("variable components must be in an array");
-              for (const auto &c : j["components"])
-                if (!c.is_string()) fatal("invalid variable component");
+              if (v.contains("components")) { // variables stored separately, e.g. u, v, w
+                if (!v["components"].is_array()) fatal("variable components must be in an array");
+                for (const auto &c : v["components"])
+                  if (!c.is_string()) fatal("invalid variable component");
+              }
             }
           } else fatal("variables must be an array");
         } else fatal("missing variable list");
 
         if (j["format"] == "float32" || j["format"] == "float64") {
-          if (j.contains("nd")) {
-            if (j["nd"] != 2 && j["nd"] != 3) fatal("unsupported spatial dimensionality");
-          } else fatal("unable to determine spatial dimensionality");
-
-          // if ((j["nd"] == 2 && ((!j.contains("width") || !j.contains("height")))) || 
-          //     (j["nd"] == 3 && ((!j.contains("width") || !j.contains("height") || !j.contains("depth")))))
-          //   fatal("width, height, and/or depth not specified.");
-        } else if (j["format"] == "vti") {
-
-        } else if (j["format"] == "nc") {
-
-        } else if (j["format"] == "h5") {
-
-        }
-
+          if (!j.contains("dimensions") || !j["dimensions"].is_array())
+            fatal("dimensions of raw data not given.");
+          const size_t nd = j["dimensions"].size();
+          if (nd != 2 && nd != 3) fatal("unsupported spatial dimensionality");
+          j["nd"] = nd;
+          if (j["variables"].size() != 1) fatal("raw data contain exactly one variable");
+        } else if (j["format"] == "vti" || j["format"] == "nc" || j["format"] == "h5") {
+        } else fatal("unsupported file format");
       } else fatal("missing filenames");
     } else fatal("invalid input type");
   } else fatal("missing `type'");
 
-#if 0
-  if (j.contains("synthetic")) {
-    if (j.contains("nd")) warn("overriding nd.");
+  if (n_timesteps <= 0) n_timesteps = j["n_timesteps"];
+  else n_timesteps = std::min(n_timesteps, int(j["n_timesteps"]));
+}
 
+inline void data_stream::read_timestep(int k, data_group& g) const
+{
+  if (j["type"] == "synthetic") {
+    const int DW = j["width"], DH = j["height"];
+    const double t = k * double(j["time_scale"]);
+    if (j["name"] == "woven")
+      g.set("scalar", synthetic_woven_2D<double>(DW, DH, t, j["scaling_factor"]));
+    else if (j["name"] == "double_gyre")
+      g.set("vector", synthetic_double_gyre<double>(DW, DH, t));
+    else if (j["name"] == "merger")
+      g.set("scalar", synthetic_merger_2D<double>(DW, DH, t));
   } else {
-    } else {
-      if (!j.contains("input_source")) fatal("input_source empty.");
-      
-    }
-      
-    const std::string filename0 = j["filenames"][0];
+    const std::string filename = j["filenames"][k];
+    for (const auto &var : j["variables"])
+      g.set(var["name"].get<std::string>(), read_variable(filename, var));
   }
-#endif
-  std::cerr << j << std::endl;
 }
 
-
-
-
-
-
-
-#if 0
-struct data_stream_synthetic : public data_stream {
-  void set_input_source(const std::string&) {} // nothing todo
-
-  void advance_timestep() {
-    data_group *g = data_group::create();
-    const ndarray<double>& array = synthesize_timestep(current_timestep);
-    g->set(default_variable_name(), array);
-    push_timestep(g);
+inline ndarray<double> data_stream::read_variable(const std::string& filename, const json& var) const
+{
+  if (!var.contains("components"))
+    return read_array(filename, var["name"]);
+
+  // interleave the components, e.g. u, v, and w, into a multicomponent array
+  const size_t nc = var["components"].size();
+  ndarray<double> array;
+  for (size_t c = 0; c < nc; c ++) {
+    const ndarray<double> comp = read_array(filename, var["components"][c]);
+    if (c == 0) {
+      std::vector<size_t> shape = comp.shape();
+      shape.insert(shape.begin(), nc);
+      array.reshape(shape);
+    }
+    for (size_t i = 0; i < comp.nelem(); i ++)
+      array[i*nc+c] = comp[i];
   }
+  return array;
+}
 
-  void set_input_parameters(const std::map<std::string, std::string>& param) {
-    data_stream::set_input_parameters(param);
-    if (param.find(str_dw) != param.end()) DW = std::stoi(param.at(str_dw));
-    if (param.find(str_dh) != param.end()) DH = std::stoi(param.at(str_dh));
-    if (param.find(str_dd) != param.end()) DD = std::stoi(param.at(str_dd));
-    if (param.find(str_dt) != param.end()) n_timesteps = std::stoi(param.at(str_dt));
-    if (param.find(str_time_scale) != param.end()) time_scale = stod(param.at(str_time_scale));
+inline ndarray<double> data_stream::read_array(const std::string& filename, const std::string& varname) const
+{
+  ndarray<double> array;
+  if (j["format"] == "float32" || j["format"] == "float64") {
+    const std::vector<size_t> shape = j["dimensions"];
+    if (j["format"] == "float32")
+      array = ndarray<double>( ndarray<float>::from_binary_file_mmap(filename, shape) );
+    else
+      array = ndarray<double>( ndarray<double>::from_binary_file_mmap(filename, shape) );
+  } else if (j["format"] == "vti") {
+    array.from_vtk_image_data_file(filename, varname);
+  } else if (j["format"] == "nc") {
+    std::lock_guard<std::mutex> guard(library_mutex());
+    array.from_netcdf(filename, varname);
+  } else if (j["format"] == "h5") {
+    std::lock_guard<std::mutex> guard(library_mutex());
+    array.from_h5(filename, varname);
   }
+  return array;
+}
 
-  virtual std::string default_variable_name() const {return std::string();};
-
-  virtual ndarray<double> synthesize_timestep(int t) = 0;
-
-protected:
-  size_t DW = 32, DH = 32, DD = 32;
-  double time_scale = 1.0;
-};
-
-struct data_stream_synthetic_woven : public data_stream_synthetic {
-  ndarray<double> synthesize_timestep(int t) {
-    return synthetic_woven_2D(DW, DH, t*time_scale);
-  };
-};
+inline void data_stream::worker()
+{
+  while (1) {
+    int k;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond_space.wait(lock, [this]() {
+        return stopping || next_timestep >= n_timesteps
+          || next_timestep < current_timestep + queue_capacity;
+      });
+      if (stopping || next_timestep >= n_timesteps) return;
+      k = next_timestep ++;
+    }
 
-struct data_stream_synthetic_double_gyre : public data_stream_synthetic {
-  ndarray<double> synthesize_timestep(int t) {
-    return synthetic_double_gyre(DW, DH, t * time_scale);
-  };
-};
+    data_group *g = data_group::create();
+    std::exception_ptr error;
+    try {
+      reader(k, *g);
+    } catch (...) { // handed to the consumer; the thread keeps reading
+      error = std::current_exception();
+      delete g;
+    }
 
-struct data_stream_files : public data_stream {
-  void set_input_source(const std::string& pattern) {
-    filenames = ndarray<float>::glob(pattern);
-    if (n_timesteps == 0) n_timesteps = filenames.size();
-    else filenames.resize(n_timesteps);
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      if (error) errors[k] = error;
+      else ready[k] = g;
+    }
+    cond_staged.notify_all();
   }
+}
 
-  void set_input_filenames(const std::vector<std::string>& f) {filenames = f;}
-
-  void load_timestep(int k);
-
-  void advance_timestep();
-
-protected:
-  std::vector<std::string> filenames;
-};
-
-struct data_stream_raw : public data_stream_files {
-  void initialize() {}
-};
-
-struct data_stream_vti : public data_stream_files {
-  void initialize() {
+inline bool data_stream::advance_timestep()
+{
+  if (current_timestep >= n_timesteps) return false;
 
+  data_group *g = NULL;
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond_staged.wait(lock, [this]() {
+      return ready.find(current_timestep) != ready.end() 
+        || errors.find(current_timestep) != errors.end();
+    });
+    auto it = ready.find(current_timestep);
+    if (it != ready.end()) {
+      g = it->second;
+      ready.erase(it);
+    } else {
+      auto ie = errors.find(current_timestep);
+      error = ie->second;
+      errors.erase(ie);
+    }
+    current_timestep ++;
   }
-};
+  cond_space.notify_all();
 
-struct data_stream_nc : public data_stream_files {
+  if (error) std::rethrow_exception(error);
 
-};
+  push_timestep(g);
+  while (staged_data.size() > size_t(history))
+    pop_timestep();
+  return true;
+}
 
-struct data_stream_pnc : public data_stream_files {
+inline void data_stream::push_timestep(data_group* g)
+{
+  staged_data.push_back(g);
+}
 
-};
+inline void data_stream::pop_timestep()
+{
+  if (staged_data.empty()) return;
+  delete staged_data.front();
+  staged_data.pop_front();
+}
 
-struct data_stream_factory {
-  static data_stream* new_data_stream(int type, const std::string& source);
-  static data_stream* new_data_stream(const std::string& source);
-  static data_stream* new_synthetic_data_stream(int c) {
-    switch (c) {
-    case SYNTHETIC_WOVEN: return new data_stream_synthetic_woven;
-    case SYNTHETIC_DOUBLE_GYRE: return new data_stream_synthetic_double_gyre;
-    default: return NULL;
-    }
+inline void data_stream::stop()
+{
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    stopping = true;
   }
-};
-#endif
+  cond_space.notify_all();
+  for (auto &w : workers)
+    w.join();
+  workers.clear();
+
+  for (auto kv : ready)
+    delete kv.second;
+  ready.clear();
+  errors.clear();
+  while (!staged_data.empty())
+    pop_timestep();
+}
 
 }
 
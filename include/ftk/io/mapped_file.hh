@@ -0,0 +1,116 @@
+#ifndef _FTK_MAPPED_FILE_HH
+#define _FTK_MAPPED_FILE_HH
+
+#include <ftk/ftk_config.hh>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ftk {
+
+// access patterns, translated to madvise/posix_fadvise hints
+enum {
+  FTK_ACCESS_NORMAL,
+  FTK_ACCESS_SEQUENTIAL, // whole timesteps consumed in order; aggressive readahead
+  FTK_ACCESS_RANDOM, // e.g. a subdomain of each timestep; no readahead
+  FTK_ACCESS_WILLNEED, // prefetch asynchronously
+  FTK_ACCESS_DONTNEED // release pages that are no longer needed
+};
+
+// read-only memory mapping of an entire file; pages are loaded on demand
+struct mapped_file {
+  mapped_file(const std::string& filename, int access = FTK_ACCESS_NORMAL);
+  ~mapped_file();
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  bool good() const {return ok;}
+  const char* data() const {return p;}
+  size_t size() const {return n;}
+
+  void advise(int access) const {advise(p, n, access);}
+  void advise(const void *addr, size_t length, int access) const; // the range is clamped to the mapping
+
+  static void prefetch(const std::string& filename); // asynchronous readahead into the page cache
+
+private:
+  char *p = NULL;
+  size_t n = 0;
+  bool ok = false;
+};
+
+///////
+inline mapped_file::mapped_file(const std::string& filename, int access)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "[FTK] error: cannot open %s.\n", filename.c_str());
+    return;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0) {
+    n = st.st_size;
+    if (n == 0) ok = true;
+    else {
+      void *q = mmap(NULL, n, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (q == MAP_FAILED) {
+        fprintf(stderr, "[FTK] error: cannot map %s.\n", filename.c_str());
+        n = 0;
+      } else {
+        p = static_cast<char*>(q);
+        ok = true;
+      }
+    }
+  }
+  close(fd); // the mapping stays valid
+
+  if (p) advise(access);
+}
+
+inline mapped_file::~mapped_file()
+{
+  if (p) munmap(p, n);
+}
+
+inline void mapped_file::advise(const void *addr, size_t length, int access) const
+{
+  if (!p || length == 0) return;
+
+  const uintptr_t lo = reinterpret_cast<uintptr_t>(p),
+                  hi = lo + n;
+  const uintptr_t page = sysconf(_SC_PAGESIZE);
+
+  uintptr_t first = std::max(reinterpret_cast<uintptr_t>(addr), lo),
+            last = std::min(reinterpret_cast<uintptr_t>(addr) + length, hi);
+  if (first >= last) return;
+  first = first / page * page; // madvise requires page-aligned addresses
+
+  int advice;
+  switch (access) {
+  case FTK_ACCESS_SEQUENTIAL: advice = MADV_SEQUENTIAL; break;
+  case FTK_ACCESS_RANDOM: advice = MADV_RANDOM; break;
+  case FTK_ACCESS_WILLNEED: advice = MADV_WILLNEED; break;
+  case FTK_ACCESS_DONTNEED: advice = MADV_DONTNEED; break; // private read-only mapping; pages are re-read from the file if touched again
+  default: advice = MADV_NORMAL;
+  }
+  madvise(reinterpret_cast<void*>(first), last - first, advice);
+}
+
+inline void mapped_file::prefetch(const std::string& filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+  close(fd);
+}
+
+}
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef _FTK_NETCDF_TIME_SERIES_HH
+#define _FTK_NETCDF_TIME_SERIES_HH
+
+#include <ftk/ftk_config.hh>
+#include <ftk/ndarray.hh>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#if FTK_HAVE_NETCDF
+
+namespace ftk {
+
+// Timesteps of NetCDF variables spread over a series of files.  If the
+// variables are time-varying, their first (usually unlimited) dimension is
+// time, and each file may hold any number of timesteps.  Timestep k is read
+// as a hyperslab of one time index.  The handle of the current file stays
+// open across timesteps, and the chunk cache of netCDF-4 files is sized to
+// hold all chunks intersecting a timestep, so that chunks spanning multiple
+// timesteps are decompressed only once.
+//
+// Not thread-safe; the NetCDF library is not either.  Concurrent readers
+// should be serialized, e.g. with data_stream::library_mutex().
+struct netcdf_time_series {
+  netcdf_time_series(const std::vector<std::string>& filenames,
+      const std::vector<std::string>& varnames, bool time_varying);
+  ~netcdf_time_series() {close();}
+
+  netcdf_time_series(const netcdf_time_series&) = delete;
+  netcdf_time_series& operator=(const netcdf_time_series&) = delete;
+
+  size_t n_timesteps() const {return index.size();}
+  size_t n_timesteps_in_file(int f) const;
+
+  // file and time index of timestep k; throws std::out_of_range
+  const std::pair<int, size_t>& locate(size_t k) const;
+
+  // the i-th variable at timestep k, without the time dimension; if sub
+  // is given, only the subdomain (in ndarray order) is read
+  template <typename T> void read(size_t k, int i, ndarray<T>& array, const lattice* sub = NULL);
+
+  void close();
+
+protected:
+  void open_file(int f);
+  void tune_chunk_cache(int varid) const;
+
+protected:
+  const std::vector<std::string> filenames, varnames;
+  const bool time_varying;
+
+  std::vector<std::pair<int, size_t>> index; // file and time index of each timestep
+
+  int current_file = -1, ncid = -1;
+  std::vector<int> varids;
+};
+
+///////
+inline netcdf_time_series::netcdf_time_series(
+    const std::vector<std::string>& filenames_,
+    const std::vector<std::string>& varnames_,
+    bool time_varying_) :
+  filenames(filenames_), varnames(varnames_), time_varying(time_varying_)
+{
+  for (int f = 0; f < filenames.size(); f ++) {
+    size_t nt = 1;
+    if (time_varying) {
+      open_file(f);
+      int dimids[NC_MAX_VAR_DIMS];
+      NC_SAFE_CALL( nc_inq_vardimid(ncid, varids[0], dimids) );
+      NC_SAFE_CALL( nc_inq_dimlen(ncid, dimids[0], &nt) );
+    }
+    for (size_t t = 0; t < nt; t ++)
+      index.push_back(std::make_pair(f, t));
+  }
+}
+
+inline size_t netcdf_time_series::n_timesteps_in_file(int f) const
+{
+  size_t n = 0;
+  for (const auto &i : index)
+    if (i.first == f) n ++;
+  return n;
+}
+
+inline void netcdf_time_series::close()
+{
+  if (ncid >= 0) NC_SAFE_CALL( nc_close(ncid) );
+  ncid = -1;
+  current_file = -1;
+}
+
+inline void netcdf_time_series::open_file(int f)
+{
+  if (f == current_file) return;
+  close();
+
+  NC_SAFE_CALL( nc_open(filenames[f].c_str(), NC_NOWRITE, &ncid) );
+  current_file = f;
+
+  varids.resize(varnames.size());
+  for (size_t i = 0; i < varnames.size(); i ++) {
+    NC_SAFE_CALL( nc_inq_varid(ncid, varnames[i].c_str(), &varids[i]) );
+    tune_chunk_cache(varids[i]);
+  }
+}
+
+inline void netcdf_time_series::tune_chunk_cache(int varid) const
+{
+  int format;
+  NC_SAFE_CALL( nc_inq_format(ncid, &format) );
+  if (format != NC_FORMAT_NETCDF4 && format != NC_FORMAT_NETCDF4_CLASSIC) return; // not chunked
+
+  int ndims, storage;
+  int dimids[NC_MAX_VAR_DIMS];
+  size_t chunksizes[NC_MAX_VAR_DIMS];
+  nc_type type;
+  size_t type_size;
+  NC_SAFE_CALL( nc_inq_varndims(ncid, varid, &ndims) );
+  NC_SAFE_CALL( nc_inq_vardimid(ncid, varid, dimids) );
+  NC_SAFE_CALL( nc_inq_var_chunking(ncid, varid, &storage, chunksizes) );
+  if (storage != NC_CHUNKED) return;
+  NC_SAFE_CALL( nc_inq_vartype(ncid, varid, &type) );
+  NC_SAFE_CALL( nc_inq_type(ncid, type, NULL, &type_size) );
+
+  // chunks intersecting one timestep
+  size_t nchunks = 1, chunk_bytes = type_size;
+  for (int i = 0; i < ndims; i ++) {
+    size_t len;
+    NC_SAFE_CALL( nc_inq_dimlen(ncid, dimids[i], &len) );
+    if (!(time_varying && i == 0))
+      nchunks *= (len + chunksizes[i] - 1) / chunksizes[i];
+    chunk_bytes *= chunksizes[i];
+  }
+
+  // chunks are read entirely once the last of their timesteps is read,
+  // hence fully read chunks are preempted first
+  const size_t bytes = std::max(nchunks * chunk_bytes, size_t(1) << 22);
+  const size_t nslots = nchunks * 16 + 1;
+  NC_SAFE_CALL( nc_set_var_chunk_cache(ncid, varid, bytes, nslots, 1.f) );
+}
+
+inline const std::pair<int, size_t>& netcdf_time_series::locate(size_t k) const
+{
+  if (k >= index.size())
+    throw std::out_of_range("[FTK] netcdf timestep " + std::to_string(k) + 
+        " out of range, " + std::to_string(index.size()) + " timesteps in total");
+  return index[k];
+}
+
+template <typename T>
+inline void netcdf_time_series::read(size_t k, int i, ndarray<T>& array, const lattice* sub)
+{
+  const auto &loc = locate(k);
+  open_file(loc.first);
+
+  int ndims;
+  int dimids[NC_MAX_VAR_DIMS];
+  size_t starts[NC_MAX_VAR_DIMS] = {0}, sizes[NC_MAX_VAR_DIMS] = {0};
+  NC_SAFE_CALL( nc_inq_varndims(ncid, varids[i], &ndims) );
+  NC_SAFE_CALL( nc_inq_vardimid(ncid, varids[i], dimids) );
+  for (int j = 0; j < ndims; j ++)
+    NC_SAFE_CALL( nc_inq_dimlen(ncid, dimids[j], &sizes[j]) );
+
+  if (time_varying) {
+    starts[0] = loc.second;
+    sizes[0] = 1;
+  }
+  if (sub) { // spatial dimensions are reversed in netcdf
+    const int offset = time_varying ? 1 : 0;
+    assert(sub->nd() == ndims - offset);
+    for (int j = offset; j < ndims; j ++) {
+      starts[j] = sub->start(ndims - 1 - j);
+      sizes[j] = sub->size(ndims - 1 - j);
+    }
+  }
+  array.from_netcdf(ncid, varids[i], starts, sizes);
+
+  if (time_varying) { // drop the trailing time dimension
+    std::vector<size_t> shape = array.shape();
+    shape.pop_back();
+    array.reshape(shape);
+  }
+}
+
+}
+
+#endif
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef _FTK_NPY_HH
+#define _FTK_NPY_HH
+
+#include <ftk/ftk_config.hh>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <type_traits>
+
+namespace ftk {
+
+// kind and size of a scalar type in numpy notation without the byte order, e.g. "f4"
+template <typename T>
+inline std::string npy_dtype()
+{
+  const char kind = std::is_floating_point<T>::value ? 'f' :
+    (std::is_same<T, bool>::value ? 'b' : (std::is_signed<T>::value ? 'i' : 'u'));
+  return std::string(1, kind) + std::to_string(sizeof(T));
+}
+
+// header of a .npy file (format versions 1.0, 2.0, and 3.0)
+struct npy_header {
+  std::string dtype; // e.g. "f4"
+  bool big_endian = false;
+  bool fortran_order = false;
+  std::vector<size_t> shape; // as stored in the file
+  size_t offset = 0; // offset of the payload
+
+  bool parse(const char *buf, size_t n);
+  std::vector<size_t> dims() const; // in ftk order, where the first dimension varies fastest
+
+  static std::string make(const std::string& dtype, const std::vector<size_t>& dims); // header of a C-ordered array with ftk dims
+};
+
+///////
+inline bool npy_header::parse(const char *buf, size_t n)
+{
+  if (n < 10 || memcmp(buf, "\x93NUMPY", 6) != 0) return false;
+
+  const unsigned char major = buf[6];
+  size_t len;
+  if (major == 1) {
+    len = (unsigned char)buf[8] | ((unsigned char)buf[9] << 8);
+    offset = 10 + len;
+  } else if (n >= 12) {
+    len = 0;
+    for (int i = 3; i >= 0; i --)
+      len = (len << 8) | (unsigned char)buf[8+i];
+    offset = 12 + len;
+  } else return false;
+  if (offset > n) return false;
+
+  const std::string dict(buf + offset - len, len);
+
+  auto value_of = [&dict](const std::string& key) {
+    size_t i = dict.find("'" + key + "'");
+    if (i == std::string::npos) return std::string();
+    i = dict.find(':', i);
+    if (i == std::string::npos) return std::string();
+    i = dict.find_first_not_of(" ", i+1);
+    if (i == std::string::npos) return std::string();
+    return dict.substr(i);
+  };
+
+  // 'descr': '<f4'
+  std::string descr = value_of("descr");
+  if (descr.size() < 4 || descr[0] != '\'') return false;
+  descr = descr.substr(1, descr.find('\'', 1) - 1);
+  if (descr.size() < 2) return false;
+  if (descr[0] == '<' || descr[0] == '>' || descr[0] == '|' || descr[0] == '=') {
+    big_endian = descr[0] == '>';
+    dtype = descr.substr(1);
+  } else
+    dtype = descr;
+
+  // 'fortran_order': False
+  fortran_order = value_of("fortran_order").compare(0, 4, "True") == 0;
+
+  // 'shape': (3, 4, )
+  const std::string s = value_of("shape");
+  if (s.empty() || s[0] != '(') return false;
+  shape.clear();
+  const char *q = s.c_str() + 1;
+  while (*q && *q != ')') {
+    char *end;
+    const unsigned long long v = strtoull(q, &end, 10);
+    if (end == q) q ++; // separators
+    else {
+      shape.push_back(v);
+      q = end;
+    }
+  }
+
+  return true;
+}
+
+inline std::vector<size_t> npy_header::dims() const
+{
+  std::vector<size_t> d(shape);
+  if (!fortran_order) std::reverse(d.begin(), d.end());
+  if (d.empty()) d.push_back(1); // 0-d array
+  return d;
+}
+
+inline std::string npy_header::make(const std::string& dtype, const std::vector<size_t>& dims)
+{
+  std::string dict = "{'descr': '";
+  dict += (dtype.size() > 1 && dtype[1] == '1' ? "|" : "<") + dtype;
+  dict += "', 'fortran_order': False, 'shape': (";
+  for (size_t i = dims.size(); i > 0; i --)
+    dict += std::to_string(dims[i-1]) + (i > 1 ? ", " : "");
+  if (dims.size() == 1) dict += ",";
+  dict += "), }";
+
+  // version 1.0; the payload is 64-byte aligned
+  const size_t len = (10 + dict.size() + 1 + 63) / 64 * 64 - 10;
+  dict.resize(len - 1, ' ');
+  dict += '\n';
+
+  std::string header("\x93NUMPY\x01\x00", 8);
+  header += char(len & 0xff);
+  header += char((len >> 8) & 0xff);
+  return header + dict;
+}
+
+}
+
+#endif
@@ -0,0 +1,377 @@
+#ifndef _FTK_VTI_HH
+#define _FTK_VTI_HH
+
+#include <ftk/ftk_config.hh>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cctype>
+#include <algorithm>
+
+#if FTK_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace ftk {
+
+// Header of a VTK XML ImageData (.vti) file, parsed without VTK.  Only
+// the XML before the appended data is parsed, so that the arrays can be
+// decoded from a memory-mapped file without touching other arrays.
+// Arrays may be appended (raw or base64), inline base64 ("binary"), or
+// ascii; binary data may be zlib-compressed (vtkZLibDataCompressor).
+struct vti_header {
+  struct data_array {
+    std::string name;
+    std::string dtype; // in numpy notation, e.g. "f4"
+    size_t ncomponents = 1;
+    std::string format; // appended, binary, or ascii
+    size_t offset = 0; // relative to the appended data, or the position of inline data in the file
+  };
+
+  int extent[6] = {0}; // whole extent
+  double origin[3] = {0}, spacing[3] = {1, 1, 1};
+  std::vector<data_array> point_arrays;
+
+  bool big_endian = false;
+  size_t header_bytes = 4; // UInt32 or UInt64 block headers
+  bool compressed = false;
+  bool appended_raw = true; // otherwise base64
+  size_t appended_offset = 0; // position right after the '_' marker
+
+  bool parse(const char *buf, size_t n);
+  const data_array* find(const std::string& name) const; // the first array if the name is empty
+
+  size_t nelem(const data_array& a) const;
+  std::vector<size_t> dims(const data_array& a) const; // {x, y[, z]}, or {components, x, y[, z]}
+
+  // Decodes an array.  Bytes point either into buf or, for uncompressed
+  // raw appended data, into the file itself.  Ascii data are decoded as
+  // float64, hence the dtype of the bytes is returned.
+  bool decode(const char *buf, size_t n, const data_array& a,
+      std::vector<char>& storage, const char* &bytes, std::string& dtype) const;
+
+  static std::string dtype_from_type(const std::string& type);
+
+protected:
+  size_t read_header_value(const char *p) const;
+  bool decode_binary(const char *buf, size_t n, size_t pos, bool raw,
+      size_t nbytes, std::vector<char>& storage, const char* &bytes) const;
+
+  // skips whitespace and child elements of an inline DataArray, e.g. the
+  // InformationKey elements VTK writes for multicomponent arrays
+  static size_t skip_child_elements(const char *buf, size_t n, size_t pos);
+
+  // decodes the first nbytes of the base64 stream at pos, skipping
+  // whitespace; returns the position after the last quartet consumed
+  static size_t base64_decode(const char *buf, size_t n, size_t pos, size_t nbytes, char *out);
+
+  static std::string attribute(const std::string& tag, const std::string& key);
+};
+
+///////
+inline std::string vti_header::dtype_from_type(const std::string& t)
+{
+  if (t == "Float32") return "f4";
+  else if (t == "Float64") return "f8";
+  else if (t == "Int8") return "i1";
+  else if (t == "UInt8") return "u1";
+  else if (t == "Int16") return "i2";
+  else if (t == "UInt16") return "u2";
+  else if (t == "Int32") return "i4";
+  else if (t == "UInt32") return "u4";
+  else if (t == "Int64") return "i8";
+  else if (t == "UInt64") return "u8";
+  else return std::string();
+}
+
+inline std::string vti_header::attribute(const std::string& tag, const std::string& key)
+{
+  size_t i = 0;
+  while ((i = tag.find(key + "=", i)) != std::string::npos) {
+    if (i > 0 && !isspace(tag[i-1])) { i ++; continue; } // e.g. "Extent" in "WholeExtent"
+    const size_t q0 = i + key.size() + 1;
+    if (q0 >= tag.size() || (tag[q0] != '"' && tag[q0] != '\'')) return std::string();
+    const size_t q1 = tag.find(tag[q0], q0 + 1);
+    if (q1 == std::string::npos) return std::string();
+    return tag.substr(q0 + 1, q1 - q0 - 1);
+  }
+  return std::string();
+}
+
+inline bool vti_header::parse(const char *buf, size_t n)
+{
+  point_arrays.clear();
+  bool in_point_data = false, has_image = false;
+
+  size_t pos = 0;
+  while (pos < n) {
+    const char *lt = static_cast<const char*>(memchr(buf + pos, '<', n - pos));
+    if (!lt) break;
+    const size_t start = lt - buf;
+    const char *gt = static_cast<const char*>(memchr(buf + start, '>', n - start));
+    if (!gt) return false;
+    pos = gt - buf + 1;
+
+    const std::string tag(buf + start + 1, gt - buf - start - 1);
+    const std::string name = tag.substr(0, tag.find_first_of(" \t\r\n/"));
+
+    if (name == "VTKFile") {
+      if (attribute(tag, "type") != "ImageData") return false;
+      big_endian = attribute(tag, "byte_order") == "BigEndian";
+      header_bytes = attribute(tag, "header_type") == "UInt64" ? 8 : 4;
+      const std::string compressor = attribute(tag, "compressor");
+      if (compressor.empty()) compressed = false;
+      else if (compressor == "vtkZLibDataCompressor") compressed = true;
+      else return false; // e.g. lz4 and lzma
+    } else if (name == "ImageData") {
+      has_image = true;
+      sscanf(attribute(tag, "WholeExtent").c_str(), "%d %d %d %d %d %d",
+          &extent[0], &extent[1], &extent[2], &extent[3], &extent[4], &extent[5]);
+      const std::string o = attribute(tag, "Origin"), s = attribute(tag, "Spacing");
+      if (o.size()) sscanf(o.c_str(), "%lf %lf %lf", &origin[0], &origin[1], &origin[2]);
+      if (s.size()) sscanf(s.c_str(), "%lf %lf %lf", &spacing[0], &spacing[1], &spacing[2]);
+    } else if (name == "PointData") {
+      in_point_data = tag.back() != '/';
+    } else if (name == "/PointData") {
+      in_point_data = false;
+    } else if (name == "AppendedData") { // the data follow the '_' marker
+      appended_raw = attribute(tag, "encoding") != "base64";
+      const char *marker = static_cast<const char*>(memchr(buf + pos, '_', n - pos));
+      if (!marker) return false;
+      appended_offset = marker - buf + 1;
+      break;
+    } else if (name == "DataArray" && in_point_data) {
+      data_array a;
+      a.name = attribute(tag, "Name");
+      a.dtype = dtype_from_type(attribute(tag, "type"));
+      const std::string nc = attribute(tag, "NumberOfComponents");
+      if (nc.size()) a.ncomponents = std::stoul(nc);
+      a.format = attribute(tag, "format");
+      if (a.dtype.empty()) return false;
+      if (a.format == "appended")
+        a.offset = std::stoul(attribute(tag, "offset"));
+      else if (a.format == "binary" || a.format == "ascii")
+        a.offset = pos;
+      else return false;
+      point_arrays.push_back(a);
+    }
+  }
+
+  const bool little_endian_host = [](){const uint16_t x = 1; return *reinterpret_cast<const uint8_t*>(&x) == 1;}();
+  return has_image && big_endian != little_endian_host;
+}
+
+inline const vti_header::data_array* vti_header::find(const std::string& name) const
+{
+  for (const auto &a : point_arrays)
+    if (name.empty() || a.name == name) return &a;
+  return NULL;
+}
+
+inline size_t vti_header::nelem(const data_array& a) const
+{
+  size_t n = a.ncomponents;
+  for (int i = 0; i < 3; i ++)
+    n *= extent[i*2+1] - extent[i*2] + 1;
+  return n;
+}
+
+inline std::vector<size_t> vti_header::dims(const data_array& a) const
+{
+  std::vector<size_t> d;
+  if (a.ncomponents > 1) d.push_back(a.ncomponents);
+  for (int i = 0; i < 3; i ++) {
+    const size_t s = extent[i*2+1] - extent[i*2] + 1;
+    if (i < 2 || s > 1) d.push_back(s);
+  }
+  return d;
+}
+
+inline size_t vti_header::read_header_value(const char *p) const
+{
+  if (header_bytes == 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+  } else {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+  }
+}
+
+inline size_t vti_header::base64_decode(const char *buf, size_t n, size_t pos, size_t nbytes, char *out)
+{
+  static const auto table = [](){
+    std::vector<int> t(256, -1);
+    const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    for (int i = 0; i < 64; i ++) t[alphabet[i]] = i;
+    return t;
+  }();
+
+  size_t m = 0;
+  while (m < nbytes) {
+    int q[4], k = 0;
+    while (k < 4 && pos < n) {
+      const unsigned char c = buf[pos ++];
+      if (isspace(c)) continue;
+      q[k ++] = c == '=' ? 0 : table[c];
+      if (q[k-1] < 0) return std::string::npos;
+    }
+    if (k < 4) return std::string::npos; // truncated
+
+    const char b[3] = {
+      char((q[0] << 2) | (q[1] >> 4)),
+      char(((q[1] & 0xf) << 4) | (q[2] >> 2)),
+      char(((q[2] & 0x3) << 6) | q[3])};
+    for (int j = 0; j < 3 && m < nbytes; j ++)
+      out[m ++] = b[j];
+  }
+  return pos;
+}
+
+inline bool vti_header::decode_binary(const char *buf, size_t n, size_t pos, bool raw,
+    size_t nbytes, std::vector<char>& storage, const char* &bytes) const
+{
+  const size_t hb = header_bytes;
+  std::vector<char> header(hb * 3);
+
+  if (!compressed) { // the header is the number of bytes; encoded along with the data
+    if (raw) {
+      if (pos + hb + nbytes > n || read_header_value(buf + pos) != nbytes) return false;
+      bytes = buf + pos + hb; // zero-copy
+    } else {
+      storage.resize(hb + nbytes);
+      if (base64_decode(buf, n, pos, hb + nbytes, storage.data()) == std::string::npos) return false;
+      if (read_header_value(storage.data()) != nbytes) return false;
+      bytes = storage.data() + hb;
+    }
+    return true;
+  }
+
+  // compressed: {nblocks, block size, last block size, compressed sizes of blocks},
+  // followed by the compressed blocks; base64 headers are encoded separately
+  size_t data_pos;
+  if (raw) {
+    if (pos + hb * 3 > n) return false;
+    memcpy(header.data(), buf + pos, hb * 3);
+  } else if (base64_decode(buf, n, pos, hb * 3, header.data()) == std::string::npos)
+    return false;
+
+  const size_t nblocks = read_header_value(header.data()),
+               block_size = read_header_value(header.data() + hb);
+  size_t last_block_size = read_header_value(header.data() + hb * 2);
+  if (last_block_size == 0) last_block_size = block_size;
+  if (nblocks == 0) return nbytes == 0;
+
+  header.resize(hb * (3 + nblocks));
+  if (raw) {
+    if (pos + header.size() > n) return false;
+    memcpy(header.data(), buf + pos, header.size());
+    data_pos = pos + header.size();
+  } else {
+    data_pos = base64_decode(buf, n, pos, header.size(), header.data());
+    if (data_pos == std::string::npos) return false;
+  }
+
+  size_t compressed_bytes = 0;
+  std::vector<size_t> block_offsets(nblocks + 1, 0);
+  for (size_t i = 0; i < nblocks; i ++) {
+    compressed_bytes += read_header_value(header.data() + hb * (3 + i));
+    block_offsets[i+1] = compressed_bytes;
+  }
+  if ((nblocks - 1) * block_size + last_block_size != nbytes) return false;
+
+  const char *cdata;
+  std::vector<char> cstorage;
+  if (raw) {
+    if (data_pos + compressed_bytes > n) return false;
+    cdata = buf + data_pos;
+  } else {
+    cstorage.resize(compressed_bytes);
+    if (base64_decode(buf, n, data_pos, compressed_bytes, cstorage.data()) == std::string::npos) return false;
+    cdata = cstorage.data();
+  }
+
+#if FTK_HAVE_ZLIB
+  storage.resize(nbytes);
+  bool succ = true;
+#pragma omp parallel for reduction(&&:succ)
+  for (long i = 0; i < long(nblocks); i ++) { // blocks are independent
+    uLongf len = i == long(nblocks) - 1 ? last_block_size : block_size;
+    const uLongf expected = len;
+    const int rtn = uncompress(reinterpret_cast<Bytef*>(&storage[i * block_size]), &len,
+        reinterpret_cast<const Bytef*>(cdata + block_offsets[i]), block_offsets[i+1] - block_offsets[i]);
+    succ = succ && rtn == Z_OK && len == expected;
+  }
+  bytes = storage.data();
+  return succ;
+#else
+  fprintf(stderr, "[FTK] error: FTK not compiled with zlib; cannot decompress vti data.\n");
+  return false;
+#endif
+}
+
+inline bool vti_header::decode(const char *buf, size_t n, const data_array& a,
+    std::vector<char>& storage, const char* &bytes, std::string& dtype) const
+{
+  const size_t ne = nelem(a);
+
+  if (a.format == "ascii") {
+    // the mapped file is not terminated, so the values up to the closing
+    // tag are copied before parsing
+    const size_t pos = skip_child_elements(buf, n, a.offset);
+    if (pos >= n) return false;
+    const char *end = static_cast<const char*>(memchr(buf + pos, '<', n - pos));
+    if (!end) return false; // truncated
+    const std::string text(buf + pos, end);
+
+    storage.resize(ne * sizeof(double));
+    double *values = reinterpret_cast<double*>(storage.data());
+    const char *p = text.c_str();
+    for (size_t i = 0; i < ne; i ++) {
+      char *q;
+      values[i] = strtod(p, &q);
+      if (q == p) return false;
+      p = q;
+    }
+    bytes = storage.data();
+    dtype = "f8";
+    return true;
+  }
+
+  dtype = a.dtype;
+  const size_t nbytes = ne * std::atoi(a.dtype.c_str() + 1);
+  if (a.format == "appended")
+    return appended_offset > 0 &&
+      decode_binary(buf, n, appended_offset + a.offset, appended_raw, nbytes, storage, bytes);
+  else // inline base64
+    return decode_binary(buf, n, skip_child_elements(buf, n, a.offset), false, nbytes, storage, bytes);
+}
+
+inline size_t vti_header::skip_child_elements(const char *buf, size_t n, size_t pos)
+{
+  while (true) {
+    while (pos < n && isspace(buf[pos])) pos ++;
+    if (pos + 1 >= n || buf[pos] != '<' || buf[pos+1] == '/') return pos; // data or the closing tag
+
+    const char *gt = static_cast<const char*>(memchr(buf + pos, '>', n - pos));
+    if (!gt) return n;
+    const std::string tag(buf + pos + 1, gt);
+    pos = gt - buf + 1;
+    if (tag.back() == '/') continue; // empty element
+
+    // elements with content, which may nest, end with the closing tag of the same name
+    const std::string close = "</" + tag.substr(0, tag.find_first_of(" \t\r\n")) + ">";
+    const char *c = std::search(buf + pos, buf + n, close.begin(), close.end());
+    if (c == buf + n) return n;
+    pos = c - buf + close.size();
+  }
+}
+
+}
+
+#endif
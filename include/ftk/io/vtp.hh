@@ -0,0 +1,224 @@
+#ifndef _FTK_VTP_HH
+#define _FTK_VTP_HH
+
+#include <ftk/ftk_config.hh>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+
+#if FTK_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace ftk {
+
+// Polygonal data written as VTK XML PolyData (.vtp) without VTK.  Arrays
+// are preallocated by the caller and written in the binary appended
+// format, optionally zlib-compressed (vtkZLibDataCompressor).  Pieces
+// written by multiple processes are indexed by a .pvtp file.
+struct vtp_polydata {
+  struct data_array {
+    std::string name;
+    std::string type; // VTK type name, e.g. "Float64"
+    int ncomponents = 1;
+    std::vector<char> data;
+  };
+
+  std::vector<double> points; // x, y, z of each point
+  std::vector<int64_t> verts_connectivity, verts_offsets; // offsets are the ends of the cells
+  std::vector<int64_t> lines_connectivity, lines_offsets;
+  std::vector<data_array> point_data;
+
+  size_t npoints() const {return points.size() / 3;}
+
+  // adds a point data array of npoints() tuples and returns its storage
+  template <typename T> T* add_point_data(const std::string& name, int ncomponents = 1);
+
+  bool write(const std::string& filename, bool compressed = false) const;
+
+  // index of pieces (relative to the index file) sharing the arrays of this piece
+  bool write_pvtp(const std::string& filename, const std::vector<std::string>& pieces) const;
+
+  template <typename T> static std::string vtk_type();
+
+protected:
+  static void compress(const char *p, size_t nbytes, std::vector<char>& out); // in blocks
+};
+
+///////
+template <> inline std::string vtp_polydata::vtk_type<float>() {return "Float32";}
+template <> inline std::string vtp_polydata::vtk_type<double>() {return "Float64";}
+template <> inline std::string vtp_polydata::vtk_type<int32_t>() {return "Int32";}
+template <> inline std::string vtp_polydata::vtk_type<uint32_t>() {return "UInt32";}
+template <> inline std::string vtp_polydata::vtk_type<int64_t>() {return "Int64";}
+template <> inline std::string vtp_polydata::vtk_type<uint64_t>() {return "UInt64";}
+
+template <typename T>
+inline T* vtp_polydata::add_point_data(const std::string& name, int ncomponents)
+{
+  data_array a;
+  a.name = name;
+  a.type = vtk_type<T>();
+  a.ncomponents = ncomponents;
+  a.data.resize(npoints() * ncomponents * sizeof(T));
+  point_data.push_back(std::move(a));
+  return reinterpret_cast<T*>(point_data.back().data.data());
+}
+
+inline void vtp_polydata::compress(const char *p, size_t nbytes, std::vector<char>& out)
+{
+#if FTK_HAVE_ZLIB
+  // {nblocks, block size, last block size, compressed sizes of blocks},
+  // followed by the compressed blocks
+  const size_t block_size = 32768; // as vtkDataCompressor
+  const size_t nblocks = (nbytes + block_size - 1) / block_size;
+  std::vector<std::vector<char>> blocks(nblocks);
+
+#pragma omp parallel for
+  for (size_t i = 0; i < nblocks; i ++) {
+    const size_t len = std::min(block_size, nbytes - i * block_size);
+    uLongf clen = compressBound(len);
+    blocks[i].resize(clen);
+    compress2(reinterpret_cast<Bytef*>(blocks[i].data()), &clen,
+        reinterpret_cast<const Bytef*>(p + i * block_size), len, Z_DEFAULT_COMPRESSION);
+    blocks[i].resize(clen);
+  }
+
+  std::vector<uint64_t> header(3 + nblocks);
+  header[0] = nblocks;
+  header[1] = block_size;
+  header[2] = nblocks == 0 ? 0 : nbytes - (nblocks - 1) * block_size;
+  size_t total = header.size() * sizeof(uint64_t);
+  for (size_t i = 0; i < nblocks; i ++) {
+    header[3 + i] = blocks[i].size();
+    total += blocks[i].size();
+  }
+
+  out.resize(total);
+  memcpy(out.data(), header.data(), header.size() * sizeof(uint64_t));
+  size_t pos = header.size() * sizeof(uint64_t);
+  for (const auto &b : blocks) {
+    memcpy(out.data() + pos, b.data(), b.size());
+    pos += b.size();
+  }
+#endif
+}
+
+inline bool vtp_polydata::write(const std::string& filename, bool compressed) const
+{
+#if !FTK_HAVE_ZLIB
+  if (compressed) {
+    fprintf(stderr, "[FTK] warning: FTK not compiled with zlib; writing uncompressed vtp.\n");
+    compressed = false;
+  }
+#endif
+
+  FILE *fp = fopen(filename.c_str(), "wb");
+  if (!fp) {
+    fprintf(stderr, "[FTK] error: cannot open file %s for writing.\n", filename.c_str());
+    return false;
+  }
+
+  struct block {const char *name, *type; int ncomponents; const char *p; size_t nbytes;};
+  std::vector<block> blocks;
+  for (const auto &a : point_data)
+    blocks.push_back({a.name.c_str(), a.type.c_str(), a.ncomponents, a.data.data(), a.data.size()});
+  const size_t first_geometry_block = blocks.size();
+  blocks.push_back({"Points", "Float64", 3, reinterpret_cast<const char*>(points.data()), points.size() * sizeof(double)});
+  blocks.push_back({"connectivity", "Int64", 1, reinterpret_cast<const char*>(verts_connectivity.data()), verts_connectivity.size() * sizeof(int64_t)});
+  blocks.push_back({"offsets", "Int64", 1, reinterpret_cast<const char*>(verts_offsets.data()), verts_offsets.size() * sizeof(int64_t)});
+  blocks.push_back({"connectivity", "Int64", 1, reinterpret_cast<const char*>(lines_connectivity.data()), lines_connectivity.size() * sizeof(int64_t)});
+  blocks.push_back({"offsets", "Int64", 1, reinterpret_cast<const char*>(lines_offsets.data()), lines_offsets.size() * sizeof(int64_t)});
+
+  // uncompressed arrays are written directly after their sizes
+  std::vector<std::vector<char>> encoded(blocks.size());
+  std::vector<size_t> offsets(blocks.size() + 1, 0);
+  for (size_t i = 0; i < blocks.size(); i ++) {
+    if (compressed) compress(blocks[i].p, blocks[i].nbytes, encoded[i]);
+    offsets[i+1] = offsets[i] + (compressed ? encoded[i].size() : sizeof(uint64_t) + blocks[i].nbytes);
+  }
+
+  auto data_array_tag = [&](size_t i) {
+    fprintf(fp, "        <DataArray type=\"%s\" Name=\"%s\"", blocks[i].type, blocks[i].name);
+    if (blocks[i].ncomponents > 1) fprintf(fp, " NumberOfComponents=\"%d\"", blocks[i].ncomponents);
+    fprintf(fp, " format=\"appended\" offset=\"%zu\"/>\n", offsets[i]);
+  };
+
+  fprintf(fp, "<?xml version=\"1.0\"?>\n");
+  fprintf(fp, "<VTKFile type=\"PolyData\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\"%s>\n",
+      compressed ? " compressor=\"vtkZLibDataCompressor\"" : "");
+  fprintf(fp, "  <PolyData>\n");
+  fprintf(fp, "    <Piece NumberOfPoints=\"%zu\" NumberOfVerts=\"%zu\" NumberOfLines=\"%zu\" NumberOfStrips=\"0\" NumberOfPolys=\"0\">\n",
+      npoints(), verts_offsets.size(), lines_offsets.size());
+  fprintf(fp, "      <PointData>\n");
+  for (size_t i = 0; i < first_geometry_block; i ++)
+    data_array_tag(i);
+  fprintf(fp, "      </PointData>\n");
+  fprintf(fp, "      <CellData>\n      </CellData>\n");
+  fprintf(fp, "      <Points>\n");
+  data_array_tag(first_geometry_block);
+  fprintf(fp, "      </Points>\n");
+  fprintf(fp, "      <Verts>\n");
+  data_array_tag(first_geometry_block + 1);
+  data_array_tag(first_geometry_block + 2);
+  fprintf(fp, "      </Verts>\n");
+  fprintf(fp, "      <Lines>\n");
+  data_array_tag(first_geometry_block + 3);
+  data_array_tag(first_geometry_block + 4);
+  fprintf(fp, "      </Lines>\n");
+  fprintf(fp, "    </Piece>\n");
+  fprintf(fp, "  </PolyData>\n");
+  fprintf(fp, "  <AppendedData encoding=\"raw\">\n   _");
+  bool succ = true;
+  for (size_t i = 0; i < blocks.size(); i ++) {
+    if (compressed)
+      succ = succ && fwrite(encoded[i].data(), 1, encoded[i].size(), fp) == encoded[i].size();
+    else {
+      const uint64_t n = blocks[i].nbytes;
+      succ = succ && fwrite(&n, sizeof(n), 1, fp) == 1
+        && fwrite(blocks[i].p, 1, n, fp) == n;
+    }
+  }
+  fprintf(fp, "\n  </AppendedData>\n");
+  fprintf(fp, "</VTKFile>\n");
+  succ = fclose(fp) == 0 && succ;
+
+  if (!succ) fprintf(stderr, "[FTK] error: cannot write file %s.\n", filename.c_str());
+  return succ;
+}
+
+inline bool vtp_polydata::write_pvtp(const std::string& filename, const std::vector<std::string>& pieces) const
+{
+  FILE *fp = fopen(filename.c_str(), "w");
+  if (!fp) {
+    fprintf(stderr, "[FTK] error: cannot open file %s for writing.\n", filename.c_str());
+    return false;
+  }
+
+  fprintf(fp, "<?xml version=\"1.0\"?>\n");
+  fprintf(fp, "<VTKFile type=\"PPolyData\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n");
+  fprintf(fp, "  <PPolyData GhostLevel=\"0\">\n");
+  fprintf(fp, "    <PPointData>\n");
+  for (const auto &a : point_data) {
+    fprintf(fp, "      <PDataArray type=\"%s\" Name=\"%s\"", a.type.c_str(), a.name.c_str());
+    if (a.ncomponents > 1) fprintf(fp, " NumberOfComponents=\"%d\"", a.ncomponents);
+    fprintf(fp, "/>\n");
+  }
+  fprintf(fp, "    </PPointData>\n");
+  fprintf(fp, "    <PPoints>\n");
+  fprintf(fp, "      <PDataArray type=\"Float64\" Name=\"Points\" NumberOfComponents=\"3\"/>\n");
+  fprintf(fp, "    </PPoints>\n");
+  for (const auto &p : pieces)
+    fprintf(fp, "    <Piece Source=\"%s\"/>\n", p.c_str());
+  fprintf(fp, "  </PPolyData>\n");
+  fprintf(fp, "</VTKFile>\n");
+
+  return fclose(fp) == 0;
+}
+
+}
+
+#endif
@@ -3,6 +3,11 @@
 
 #include <ftk/ftk_config.hh>
 #include <ftk/hypermesh/lattice.hh>
+#include <ftk/io/mapped_file.hh>
+#include <ftk/io/npy.hh>
+#include <ftk/io/bov.hh>
+#include <ftk/io/vti.hh>
+#include <ftk/ndarray/allocator.hh>
 #include <vector>
 #include <array>
 #include <numeric>
@@ -10,7 +15,12 @@
 #include <algorithm>
 #include <cstring>
 #include <cassert>
+#include <cstdio>
+#include <type_traits>
+#include <memory>
 #include <glob.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #if FTK_HAVE_CUDA
 #include <cuda.h>
@@ -59,19 +69,103 @@
 
 namespace ftk {
 
+// Non-owning, strided view of an n-dimensional array.  The view refers to 
+// the buffer of an ndarray or to externally owned memory; slicing a view 
+// only adjusts the pointer, shape, and strides, so no element is copied. 
+// The viewed memory must outlive the view, except for views of mapped 
+// files, which keep the mapping alive.
+template <typename T>
+struct ndarray_view {
+  typedef typename std::remove_const<T>::type value_type;
+
+  ndarray_view() {}
+  ndarray_view(T *p, const std::vector<size_t> &dims); // contiguous, the first dimension varies fastest
+  ndarray_view(T *p, const std::vector<size_t> &dims, const std::vector<size_t> &strides, 
+      std::shared_ptr<const mapped_file> file = std::shared_ptr<const mapped_file>());
+  template <typename T1> ndarray_view(const ndarray_view<T1>& v) // e.g. ndarray_view<T> to ndarray_view<const T>
+    : ndarray_view(v.data(), v.shape(), v.strides(), v.mapped()) {}
+
+  size_t nd() const {return dims.size();}
+  size_t dim(size_t i) const {return dims[i];}
+  size_t shape(size_t i) const {return dim(i);}
+  size_t stride(size_t i) const {return s[i];}
+  size_t nelem() const {return std::accumulate(dims.begin(), dims.end(), size_t(1), std::multiplies<size_t>());}
+  bool empty() const {return dims.empty() || nelem() == 0;}
+  bool is_contiguous() const {return contiguous;}
+  const std::vector<size_t> &shape() const {return dims;}
+  const std::vector<size_t> &strides() const {return s;}
+
+  lattice get_lattice() const;
+
+  T* data() const {return p;}
+
+  const std::shared_ptr<const mapped_file>& mapped() const {return file;} // non-null if backed by a mapped file
+  void advise(int access) const; // readahead hints for the pages covered by the view; no-op unless mapped
+
+  size_t index(const std::vector<size_t>& idx) const;
+  size_t index(const std::vector<int>& idx) const;
+
+  T& at(const std::vector<size_t>& idx) const {return p[index(idx)];}
+  T& at(const std::vector<int>& idx) const {return p[index(idx)];}
+
+  T& operator()(const std::vector<size_t>& idx) const {return at(idx);}
+  T& operator()(const std::vector<int>& idx) const {return at(idx);}
+  T& operator()(size_t i0) const {return p[i0*s[0]];}
+  T& operator()(size_t i0, size_t i1) const {return p[i0*s[0]+i1*s[1]];}
+  T& operator()(size_t i0, size_t i1, size_t i2) const {return p[i0*s[0]+i1*s[1]+i2*s[2]];}
+  T& operator()(size_t i0, size_t i1, size_t i2, size_t i3) const {return p[i0*s[0]+i1*s[1]+i2*s[2]+i3*s[3]];}
+  T& operator()(size_t i0, size_t i1, size_t i2, size_t i3, size_t i4) const {return p[i0*s[0]+i1*s[1]+i2*s[2]+i3*s[3]+i4*s[4]];}
+  T& operator()(size_t i0, size_t i1, size_t i2, size_t i3, size_t i4, size_t i5) const {return p[i0*s[0]+i1*s[1]+i2*s[2]+i3*s[3]+i4*s[4]+i5*s[5]];}
+  T& operator()(size_t i0, size_t i1, size_t i2, size_t i3, size_t i4, size_t i5, size_t i6) const {return p[i0*s[0]+i1*s[1]+i2*s[2]+i3*s[3]+i4*s[4]+i5*s[5]+i6*s[6]];}
+
+  T& operator[](size_t i) const {return contiguous ? p[i] : p[offset(i)];} // i-th element in logical order
+
+  ndarray_view<T> slice(const lattice&) const;
+  ndarray_view<T> slice(const std::vector<size_t>& starts, const std::vector<size_t> &sizes) const;
+
+  ndarray_view<T> slice_time(size_t t) const; // assuming the last dimension is time, return an (n-1)-dimensional view
+  std::vector<ndarray_view<T>> slice_time() const; // slice_time for all timesteps
+
+  template <typename T1>
+  void copy_to(T1 *out) const; // copy elements in logical order to a dense buffer
+
+  void to_binary_file(const std::string& filename) const;
+  void to_binary_file(FILE *fp) const;
+
+  void to_numpy(const std::string& filename) const;
+  void to_bov(const std::string& filename) const; // the raw data goes to a .raw file next to the header
+
+  void to_vtk_image_data_file(const std::string& filename, bool multicomponent=false) const;
+#if FTK_HAVE_VTK
+  vtkSmartPointer<vtkImageData> to_vtk_image_data(bool multicomponent=false) const;
+  vtkSmartPointer<vtkDataArray> to_vtk_data_array(bool multicomponent=false) const;
+#endif
+
+private:
+  size_t offset(size_t i) const; // memory offset of the i-th element in logical order
+  template <typename F> void for_each_row(F f) const; // f(i, offset) for the first element of each row along dim 0
+
+private:
+  std::vector<size_t> dims, s;
+  T *p = NULL;
+  bool contiguous = true;
+  std::shared_ptr<const mapped_file> file;
+};
+
 template <typename T>
 struct ndarray {
   ndarray() {}
   ndarray(const std::vector<size_t> &dims) {reshape(dims);}
   ndarray(const lattice& l) {reshape(l.sizes());}
   ndarray(const T *a, const std::vector<size_t> &shape);
+  template <typename T1> explicit ndarray(const ndarray_view<T1>& v) {from_view(v);} // deep copy
 
   std::ostream& print(std::ostream& os) const;
 
   size_t nd() const {return dims.size();}
   size_t dim(size_t i) const {return dims[i];}
   size_t shape(size_t i) const {return dim(i);}
-  size_t nelem() const {return std::accumulate(dims.begin(), dims.end(), 1, std::multiplies<size_t>());}
+  size_t nelem() const {return std::accumulate(dims.begin(), dims.end(), size_t(1), std::multiplies<size_t>());}
   bool empty() const  {return p.empty();}
   const std::vector<size_t> &shape() const {return dims;}
 
@@ -80,7 +174,8 @@ struct ndarray {
   void fill(const std::vector<T>& values); //! fill values with std::vector
   void fill(const std::vector<std::vector<T>>& values); //! fill values
 
-  const std::vector<T>& std_vector() const {return p;}
+  typedef std::vector<T, ndarray_allocator<T>> storage_type;
+  const storage_type& std_vector() const {return p;} // w/o copy; see to_vector() for a std::vector<T>
 
   const T* data() const {return p.data();}
   T* data() {return p.data();}
@@ -106,11 +201,23 @@ struct ndarray {
   ndarray<T> slice_time(size_t t) const; // assuming the last dimension is time, return an (n-1)-dimensional slice
   std::vector<ndarray<T>> slice_time() const; // slice_time for all timesteps
 
+  // zero-copy counterparts of slice and slice_time
+  ndarray_view<T> view() {return ndarray_view<T>(p.data(), dims, s);}
+  ndarray_view<const T> view() const {return ndarray_view<const T>(p.data(), dims, s);}
+
+  ndarray_view<T> slice_view(const lattice& l) {return view().slice(l);}
+  ndarray_view<const T> slice_view(const lattice& l) const {return view().slice(l);}
+  ndarray_view<const T> slice_view(const std::vector<size_t>& starts, const std::vector<size_t> &sizes) const {return view().slice(starts, sizes);}
+
+  ndarray_view<T> slice_time_view(size_t t) {return view().slice_time(t);}
+  ndarray_view<const T> slice_time_view(size_t t) const {return view().slice_time(t);}
+  std::vector<ndarray_view<const T>> slice_time_view() const {return view().slice_time();}
+
   size_t index(const std::vector<size_t>& idx) const;
   size_t index(const std::vector<int>& idx) const;
 
   template <typename uint=size_t>
-  std::vector<uint> from_index(uint i) const {return lattice().from_integer(i);}
+  std::vector<int> from_index(uint i) const {return get_lattice().from_integer(i);}
 
   T& at(const std::vector<size_t>& idx) {return p[index(idx)];}
   const T& at(const std::vector<size_t>& idx) const {return p[index(idx)];}
@@ -175,6 +282,9 @@ struct ndarray {
   template <typename T1>
   void from_array(const ndarray<T1>& array1);
 
+  template <typename T1>
+  void from_view(const ndarray_view<T1>& v);
+
   void from_vector(const std::vector<T> &array);
   void copy_vector(const std::vector<T> &array);
 
@@ -184,16 +294,40 @@ struct ndarray {
   void from_binary_file(const std::string& filename);
   void from_binary_file(FILE *fp);
   void from_binary_file_sequence(const std::string& pattern);
+
+  // Reads a subdomain (e.g. the ghost-extended extent of a rank) of the 
+  // array of the given shape in a raw file, with one pread per contiguous 
+  // run.  Multicomponent arrays have the components as the first dimension.
+  void from_binary_file(const std::string& filename, 
+      const std::vector<size_t>& shape, const lattice& sub, size_t offset=0);
   void to_vector(std::vector<T> &out_vector) const;
-  void to_binary_file(const std::string& filename);
-  void to_binary_file(FILE *fp);
+  void to_binary_file(const std::string& filename) const;
+  void to_binary_file(FILE *fp) const;
 
-  void from_numpy(const std::string& filename);
+  void from_numpy(const std::string& filename); // converts from the element type of the file
   void to_numpy(const std::string& filename) const;
 
-  void from_bov(const std::string& filename);
+  void from_bov(const std::string& filename); // converts from the element type of the file
   void to_bov(const std::string& filename) const;
 
+  // Read-only arrays backed by memory-mapped files.  Pages are loaded on 
+  // demand and the mapping lives as long as any view of it.  The element 
+  // type must match the file.  The access pattern sets the readahead; use 
+  // FTK_ACCESS_RANDOM if only a subdomain of each timestep is accessed, and 
+  // ndarray_view::advise() to prefetch or release the pages of a subview.
+  static ndarray_view<const T> from_binary_file_mmap(const std::string& filename, 
+      const std::vector<size_t>& shape, size_t offset=0, int access=FTK_ACCESS_SEQUENTIAL);
+  static ndarray_view<const T> from_numpy_mmap(const std::string& filename, int access=FTK_ACCESS_SEQUENTIAL);
+  static ndarray_view<const T> from_bov_mmap(const std::string& filename, int access=FTK_ACCESS_SEQUENTIAL);
+  static ndarray_view<const T> from_mapped_file(const std::shared_ptr<const mapped_file>& file, 
+      size_t offset, const std::vector<size_t>& shape);
+
+  // Native vti reader that needs no VTK.  Only the requested point data 
+  // array is decoded from the memory-mapped file, converting from the 
+  // element type of the file.  The first array is read if no name is given.
+  void from_vti(const std::string& filename, const std::string& array_name=std::string());
+
+  // uses the native reader if the file is supported, and VTK otherwise
   void from_vtk_image_data_file(const std::string& filename, const std::string array_name=std::string());
   void from_vtk_image_data_file_sequence(const std::string& pattern);
   void to_vtk_image_data_file(const std::string& filename, bool multicomponent=false) const;
@@ -205,9 +339,11 @@ struct ndarray {
 #endif
 
   void from_h5(const std::string& filename, const std::string& name); 
+  void from_h5(const std::string& filename, const std::string& name, const lattice& sub); // hyperslab; sub is in the reversed (fastest first) hdf5 dimension order
 #if FTK_HAVE_HDF5
   void from_h5(hid_t fid, const std::string& name);
   void from_h5(hid_t did);
+  void from_h5(hid_t did, const lattice& sub);
 
   static hid_t h5_mem_type_id();
 #endif
@@ -238,9 +374,17 @@ struct ndarray {
   // statistics
   std::tuple<T, T> min_max() const;
 
+private:
+  bool read_vti(const mapped_file& file, const std::string& array_name);
+  template <typename U> void copy_from_bytes(const char *bytes); // unaligned
+  void copy_from_bytes(const char *bytes, const std::string& dtype);
+
+  void copy_from_mapped_file(const std::shared_ptr<const mapped_file>& file, 
+      size_t offset, const std::vector<size_t>& shape, const std::string& dtype); // converting copy
+
 private:
   std::vector<size_t> dims, s;
-  std::vector<T> p;
+  storage_type p; // 64-byte aligned; large buffers are pooled
 
 #if FTK_HAVE_CUDA
   // arrays on GPU
@@ -258,12 +402,12 @@ lattice ndarray<T>::get_lattice() const {
 template <typename T>
 void ndarray<T>::fill(const std::vector<T>& values)
 {
-  p = values;
+  p.assign(values.begin(), values.end());
 }
 
 template <typename T>
 void ndarray<T>::to_vector(std::vector<T> &out_vector) const{
-  out_vector = p; 
+  out_vector.assign(p.begin(), p.end());
 }
 
 template <typename T>
@@ -271,13 +415,21 @@ template <typename T1>
 void ndarray<T>::from_array(const ndarray<T1>& array1)
 {
   reshape(array1.shape());
-  for (auto i = 0; i < p.size(); i ++)
+  for (size_t i = 0; i < p.size(); i ++)
     p[i] = static_cast<T>(array1[i]);
 }
 
+template <typename T>
+template <typename T1>
+void ndarray<T>::from_view(const ndarray_view<T1>& v)
+{
+  reshape(v.shape());
+  v.copy_to(p.data());
+}
+
 template <typename T>
 void ndarray<T>::from_vector(const std::vector<T> &in_vector){
-  for (int i=0;i<nelem();++i)
+  for (size_t i=0;i<nelem();++i)
     if (i<in_vector.size())
       p[i] = in_vector[i];
     else break;
@@ -286,7 +438,7 @@ void ndarray<T>::from_vector(const std::vector<T> &in_vector){
 template <typename T>
 void ndarray<T>::copy_vector(const std::vector<T> &array)
 {
-  p = array;
+  p.assign(array.begin(), array.end());
   reshape({p.size()});
 }
 
@@ -322,17 +474,248 @@ void ndarray<T>::from_binary_file(FILE *fp)
 }
 
 template <typename T>
-void ndarray<T>::to_binary_file(const std::string& f)
+void ndarray<T>::from_binary_file(const std::string& filename, 
+    const std::vector<size_t>& shape, const lattice& sub, size_t offset)
 {
-  FILE *fp = fopen(f.c_str(), "wb");
-  to_binary_file(fp);
-  fclose(fp);
+  const size_t n = shape.size();
+  assert(sub.nd() == n);
+  reshape(sub.sizes());
+
+  // runs span the leading dimensions that are read entirely, and the
+  // subrange of the next dimension
+  size_t d = 0, run = 1;
+  while (d < n && sub.start(d) == 0 && sub.size(d) == shape[d]) 
+    run *= shape[d ++];
+  if (d < n) 
+    run *= sub.size(d ++);
+
+  std::vector<size_t> stride(n, 1);
+  for (size_t i = 1; i < n; i ++)
+    stride[i] = stride[i-1] * shape[i-1];
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "[FTK] fatal error: cannot open %s.\n", filename.c_str());
+    assert(false);
+    return;
+  }
+
+  std::vector<size_t> idx(n, 0); // index of the run in the dimensions beyond d
+  for (size_t r = 0; r < nelem() / run; r ++) {
+    size_t pos = 0;
+    for (size_t i = 0; i < n; i ++)
+      pos += (sub.start(i) + idx[i]) * stride[i];
+
+    char *buf = reinterpret_cast<char*>(&p[r * run]);
+    size_t bytes = run * sizeof(T), done = 0;
+    while (done < bytes) {
+      const ssize_t m = pread(fd, buf + done, bytes - done, offset + pos * sizeof(T) + done);
+      if (m <= 0) {
+        fprintf(stderr, "[FTK] fatal error: cannot read %s.\n", filename.c_str());
+        assert(false);
+        break;
+      }
+      done += m;
+    }
+
+    for (size_t i = d; i < n; i ++) { // next run
+      if (++ idx[i] < sub.size(i)) break;
+      idx[i] = 0;
+    }
+  }
+
+  close(fd);
+}
+
+template <typename T>
+void ndarray<T>::to_binary_file(const std::string& f) const
+{
+  view().to_binary_file(f);
+}
+
+template <typename T>
+void ndarray<T>::to_binary_file(FILE *fp) const
+{
+  view().to_binary_file(fp);
+}
+
+template <typename T>
+ndarray_view<const T> ndarray<T>::from_mapped_file(
+    const std::shared_ptr<const mapped_file>& file, size_t offset, const std::vector<size_t>& shape)
+{
+  const size_t n = std::accumulate(shape.begin(), shape.end(), size_t(1), std::multiplies<size_t>());
+  if (!file->good() || offset + n * sizeof(T) > file->size()) {
+    fprintf(stderr, "[FTK] fatal error: mapped file too small for the requested array.\n");
+    assert(false);
+    return ndarray_view<const T>();
+  } else if (offset % alignof(T) != 0) {
+    fprintf(stderr, "[FTK] fatal error: misaligned data offset %zu in mapped file.\n", offset);
+    assert(false);
+    return ndarray_view<const T>();
+  }
+
+  ndarray_view<const T> v(reinterpret_cast<const T*>(file->data() + offset), shape);
+  return ndarray_view<const T>(v.data(), v.shape(), v.strides(), file);
+}
+
+template <typename T>
+ndarray_view<const T> ndarray<T>::from_binary_file_mmap(
+    const std::string& filename, const std::vector<size_t>& shape, size_t offset, int access)
+{
+  auto file = std::make_shared<const mapped_file>(filename, access);
+  return from_mapped_file(file, offset, shape);
+}
+
+template <typename T>
+ndarray_view<const T> ndarray<T>::from_numpy_mmap(const std::string& filename, int access)
+{
+  auto file = std::make_shared<const mapped_file>(filename, access);
+  npy_header h;
+  if (!file->good() || !h.parse(file->data(), file->size())) {
+    fprintf(stderr, "[FTK] fatal error: cannot read numpy file %s.\n", filename.c_str());
+    assert(false);
+    return ndarray_view<const T>();
+  } else if (h.dtype != npy_dtype<T>() || h.big_endian) {
+    fprintf(stderr, "[FTK] fatal error: numpy dtype %s mismatches the array type.\n", h.dtype.c_str());
+    assert(false);
+    return ndarray_view<const T>();
+  }
+  return from_mapped_file(file, h.offset, h.dims());
+}
+
+template <typename T>
+ndarray_view<const T> ndarray<T>::from_bov_mmap(const std::string& filename, int access)
+{
+  bov_header h;
+  if (!h.parse(filename)) {
+    fprintf(stderr, "[FTK] fatal error: cannot read bov file %s.\n", filename.c_str());
+    assert(false);
+    return ndarray_view<const T>();
+  } else if (h.dtype != npy_dtype<T>() || h.big_endian) {
+    fprintf(stderr, "[FTK] fatal error: bov data format mismatches the array type.\n");
+    assert(false);
+    return ndarray_view<const T>();
+  }
+  auto file = std::make_shared<const mapped_file>(h.data_file, access);
+  return from_mapped_file(file, h.byte_offset, h.dims());
+}
+
+template <typename T>
+void ndarray<T>::copy_from_mapped_file(const std::shared_ptr<const mapped_file>& f, 
+    size_t offset, const std::vector<size_t>& shape, const std::string& dtype)
+{
+  if (dtype == "f4") from_view(ndarray<float>::from_mapped_file(f, offset, shape));
+  else if (dtype == "f8") from_view(ndarray<double>::from_mapped_file(f, offset, shape));
+  else if (dtype == "i1") from_view(ndarray<int8_t>::from_mapped_file(f, offset, shape));
+  else if (dtype == "u1") from_view(ndarray<uint8_t>::from_mapped_file(f, offset, shape));
+  else if (dtype == "i2") from_view(ndarray<int16_t>::from_mapped_file(f, offset, shape));
+  else if (dtype == "u2") from_view(ndarray<uint16_t>::from_mapped_file(f, offset, shape));
+  else if (dtype == "i4") from_view(ndarray<int32_t>::from_mapped_file(f, offset, shape));
+  else if (dtype == "u4") from_view(ndarray<uint32_t>::from_mapped_file(f, offset, shape));
+  else if (dtype == "i8") from_view(ndarray<int64_t>::from_mapped_file(f, offset, shape));
+  else if (dtype == "u8") from_view(ndarray<uint64_t>::from_mapped_file(f, offset, shape));
+  else {
+    fprintf(stderr, "[FTK] fatal error: unsupported data type %s.\n", dtype.c_str());
+    assert(false);
+  }
+}
+
+template <typename T>
+template <typename U>
+void ndarray<T>::copy_from_bytes(const char *bytes)
+{
+  for (size_t i = 0; i < nelem(); i ++) {
+    U v;
+    memcpy(&v, bytes + i * sizeof(U), sizeof(U));
+    p[i] = v;
+  }
+}
+
+template <typename T>
+void ndarray<T>::copy_from_bytes(const char *bytes, const std::string& dtype)
+{
+  if (dtype == "f4") copy_from_bytes<float>(bytes);
+  else if (dtype == "f8") copy_from_bytes<double>(bytes);
+  else if (dtype == "i1") copy_from_bytes<int8_t>(bytes);
+  else if (dtype == "u1") copy_from_bytes<uint8_t>(bytes);
+  else if (dtype == "i2") copy_from_bytes<int16_t>(bytes);
+  else if (dtype == "u2") copy_from_bytes<uint16_t>(bytes);
+  else if (dtype == "i4") copy_from_bytes<int32_t>(bytes);
+  else if (dtype == "u4") copy_from_bytes<uint32_t>(bytes);
+  else if (dtype == "i8") copy_from_bytes<int64_t>(bytes);
+  else if (dtype == "u8") copy_from_bytes<uint64_t>(bytes);
+  else {
+    fprintf(stderr, "[FTK] fatal error: unsupported data type %s.\n", dtype.c_str());
+    assert(false);
+  }
+}
+
+template <typename T>
+bool ndarray<T>::read_vti(const mapped_file& file, const std::string& array_name)
+{
+  vti_header h;
+  if (!file.good() || !h.parse(file.data(), file.size())) return false;
+
+  const auto *a = h.find(array_name);
+  if (!a) return false;
+
+  std::vector<char> storage;
+  const char *bytes = NULL;
+  std::string dtype;
+  if (!h.decode(file.data(), file.size(), *a, storage, bytes, dtype)) return false;
+
+  reshape(h.dims(*a));
+  copy_from_bytes(bytes, dtype);
+  return true;
+}
+
+template <typename T>
+void ndarray<T>::from_vti(const std::string& filename, const std::string& array_name)
+{
+  mapped_file file(filename, FTK_ACCESS_RANDOM); // only pages of the requested array are loaded
+  if (!read_vti(file, array_name)) {
+    fprintf(stderr, "[FTK] fatal error: cannot read array '%s' in vti file %s.\n", 
+        array_name.c_str(), filename.c_str());
+    assert(false);
+  }
+}
+
+template <typename T>
+void ndarray<T>::from_numpy(const std::string& filename)
+{
+  auto file = std::make_shared<const mapped_file>(filename, FTK_ACCESS_SEQUENTIAL);
+  npy_header h;
+  if (!file->good() || !h.parse(file->data(), file->size()) || h.big_endian) {
+    fprintf(stderr, "[FTK] fatal error: cannot read numpy file %s.\n", filename.c_str());
+    assert(false);
+    return;
+  }
+  copy_from_mapped_file(file, h.offset, h.dims(), h.dtype);
+}
+
+template <typename T>
+void ndarray<T>::from_bov(const std::string& filename)
+{
+  bov_header h;
+  if (!h.parse(filename) || h.big_endian) {
+    fprintf(stderr, "[FTK] fatal error: cannot read bov file %s.\n", filename.c_str());
+    assert(false);
+    return;
+  }
+  auto file = std::make_shared<const mapped_file>(h.data_file, FTK_ACCESS_SEQUENTIAL);
+  copy_from_mapped_file(file, h.byte_offset, h.dims(), h.dtype);
+}
+
+template <typename T>
+void ndarray<T>::to_numpy(const std::string& filename) const
+{
+  view().to_numpy(filename);
 }
 
 template <typename T>
-void ndarray<T>::to_binary_file(FILE *fp)
+void ndarray<T>::to_bov(const std::string& filename) const
 {
-  fwrite(&p[0], sizeof(T), nelem(), fp);
+  view().to_bov(filename);
 }
 
 template <typename T>
@@ -357,8 +740,8 @@ void ndarray<T>::from_binary_file_sequence(const std::string& pattern)
   mydims[nd() - 1] = filenames.size();
   reshape(mydims);
  
-  size_t npt = std::accumulate(dims.begin(), dims.end()-1, 1, std::multiplies<size_t>());
-  for (int i = 0; i < filenames.size(); i ++) {
+  size_t npt = std::accumulate(dims.begin(), dims.end()-1, size_t(1), std::multiplies<size_t>());
+  for (size_t i = 0; i < filenames.size(); i ++) {
     // fprintf(stderr, "loading %s\n", filenames[i].c_str());
     FILE *fp = fopen(filenames[i].c_str(), "rb");
     fread(&p[npt*i], sizeof(T), npt, fp);
@@ -380,6 +763,24 @@ template<> inline int ndarray<double>::vtk_data_type() {return VTK_DOUBLE;}
 
 template<typename T>
 inline void ndarray<T>::to_vtk_image_data_file(const std::string& filename, bool multicomponent) const 
+{
+  view().to_vtk_image_data_file(filename, multicomponent);
+}
+
+template<typename T>
+inline vtkSmartPointer<vtkDataArray> ndarray<T>::to_vtk_data_array(bool multicomponent) const
+{
+  return view().to_vtk_data_array(multicomponent);
+}
+
+template<typename T>
+inline vtkSmartPointer<vtkImageData> ndarray<T>::to_vtk_image_data(bool multicomponent) const
+{
+  return view().to_vtk_image_data(multicomponent);
+}
+
+template<typename T>
+inline void ndarray_view<T>::to_vtk_image_data_file(const std::string& filename, bool multicomponent) const 
 {
   vtkSmartPointer<vtkXMLImageDataWriter> writer = vtkXMLImageDataWriter::New();
   writer->SetFileName(filename.c_str());
@@ -388,25 +789,25 @@ inline void ndarray<T>::to_vtk_image_data_file(const std::string& filename, bool
 }
 
 template<typename T>
-inline vtkSmartPointer<vtkDataArray> ndarray<T>::to_vtk_data_array(bool multicomponent) const
+inline vtkSmartPointer<vtkDataArray> ndarray_view<T>::to_vtk_data_array(bool multicomponent) const
 {
-  vtkSmartPointer<vtkDataArray> d = vtkDataArray::CreateDataArray(vtk_data_type());
+  vtkSmartPointer<vtkDataArray> d = vtkDataArray::CreateDataArray(ndarray<value_type>::vtk_data_type());
   if (multicomponent) d->SetName("vector");
   else d->SetName("scalar");
   if (multicomponent) {
     d->SetNumberOfComponents(shape(0));
-    d->SetNumberOfTuples( std::accumulate(dims.begin()+1, dims.end(), 1, std::multiplies<size_t>()) );
+    d->SetNumberOfTuples( std::accumulate(dims.begin()+1, dims.end(), size_t(1), std::multiplies<size_t>()) );
   }
   else {
     d->SetNumberOfComponents(1);
     d->SetNumberOfTuples(nelem());
   }
-  memcpy(d->GetVoidPointer(0), p.data(), sizeof(T) * p.size()); // nelem());
+  copy_to(static_cast<value_type*>(d->GetVoidPointer(0)));
   return d;
 }
 
 template<typename T>
-inline vtkSmartPointer<vtkImageData> ndarray<T>::to_vtk_image_data(bool multicomponent) const
+inline vtkSmartPointer<vtkImageData> ndarray_view<T>::to_vtk_image_data(bool multicomponent) const
 {
   vtkSmartPointer<vtkImageData> d = vtkImageData::New();
   if (multicomponent) {
@@ -416,7 +817,6 @@ inline vtkSmartPointer<vtkImageData> ndarray<T>::to_vtk_image_data(bool multicom
     if (nd() == 2) d->SetDimensions(shape(0), shape(1), 1);
     else d->SetDimensions(shape(0), shape(1), shape(2));
   }
-  // d->GetPointData()->AddArray(to_vtk_data_array(multicomponent));
   d->GetPointData()->SetScalars(to_vtk_data_array(multicomponent));
 
   return d;
@@ -444,7 +844,7 @@ inline void ndarray<T>::from_vtk_image_data(
     assert(false);
   }
 
-  for (auto i = 0; i < da->GetNumberOfTuples(); i ++) {
+  for (vtkIdType i = 0; i < da->GetNumberOfTuples(); i ++) {
     double *tuple = da->GetTuple(i);
     for (auto j = 0; j < nc; j ++)
       p[i*nc+j] = tuple[j];
@@ -454,6 +854,9 @@ inline void ndarray<T>::from_vtk_image_data(
 template<typename T>
 inline void ndarray<T>::from_vtk_image_data_file(const std::string& filename, const std::string array_name)
 {
+  mapped_file file(filename, FTK_ACCESS_RANDOM);
+  if (read_vti(file, array_name)) return;
+
   vtkNew<vtkXMLImageDataReader> reader;
   reader->SetFileName(filename.c_str());
   reader->Update();
@@ -481,8 +884,7 @@ inline void ndarray<T>::from_vtk_image_data_file_sequence(const std::string& pat
 template<typename T>
 inline void ndarray<T>::from_vtk_image_data_file(const std::string& filename, const std::string array_name)
 {
-  fprintf(stderr, "[FTK] fatal error: FTK is not compiled with VTK.\n");
-  assert(false);
+  from_vti(filename, array_name);
 }
 
 template<typename T>
@@ -498,6 +900,13 @@ inline void ndarray<T>::to_vtk_image_data_file(const std::string& filename, bool
   fprintf(stderr, "[FTK] fatal error: FTK is not compiled with VTK.\n");
   assert(false);
 }
+
+template<typename T>
+inline void ndarray_view<T>::to_vtk_image_data_file(const std::string& filename, bool) const 
+{
+  fprintf(stderr, "[FTK] fatal error: FTK is not compiled with VTK.\n");
+  assert(false);
+}
 #endif
 
 #ifdef FTK_HAVE_NETCDF
@@ -632,7 +1041,7 @@ ndarray<T>::ndarray(const T *a, const std::vector<size_t> &dims_)
     if (i == 0) s[i] = 1;
     else s[i] = s[i-1]*dims[i-1];
 
-  p.assign(a, a + s[nd()-1]);
+  p.assign(a, a + s[nd()-1]*dims[nd()-1]);
 }
 
 template <typename T>
@@ -747,6 +1156,39 @@ inline void ndarray<T>::from_h5(hid_t did)
   reshape(dims);
   
   H5Dread(did, h5_mem_type_id(), H5S_ALL, H5S_ALL, H5P_DEFAULT, p.data());
+  H5Sclose(sid);
+}
+
+template <typename T>
+inline void ndarray<T>::from_h5(const std::string& filename, const std::string& name, const lattice& sub)
+{
+  auto fid = H5Fopen(filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  auto did = H5Dopen2(fid, name.c_str(), H5P_DEFAULT);
+  from_h5(did, sub);
+  H5Dclose(did);
+  H5Fclose(fid);
+}
+
+template <typename T>
+inline void ndarray<T>::from_h5(hid_t did, const lattice& sub)
+{
+  auto sid = H5Dget_space(did);
+  const int h5ndims = H5Sget_simple_extent_ndims(sid);
+  assert(h5ndims == sub.nd());
+
+  std::vector<hsize_t> starts(h5ndims), sizes(h5ndims);
+  for (auto i = 0; i < h5ndims; i ++) {
+    starts[i] = sub.start(h5ndims - i - 1);
+    sizes[i] = sub.size(h5ndims - i - 1);
+  }
+  H5Sselect_hyperslab(sid, H5S_SELECT_SET, starts.data(), NULL, sizes.data(), NULL);
+  auto mid = H5Screate_simple(h5ndims, sizes.data(), NULL);
+
+  reshape(sub.sizes());
+  H5Dread(did, h5_mem_type_id(), mid, sid, H5P_DEFAULT, p.data());
+
+  H5Sclose(mid);
+  H5Sclose(sid);
 }
 
 template <> inline hid_t ndarray<double>::h5_mem_type_id() { return H5T_NATIVE_DOUBLE; }
@@ -759,17 +1201,19 @@ inline void ndarray<T>::from_h5(const std::string& filename, const std::string&
   fprintf(stderr, "[FTK] fatal: FTK not compiled with HDF5.\n");
   assert(false);
 }
+
+template <typename T>
+inline void ndarray<T>::from_h5(const std::string& filename, const std::string& name, const lattice&)
+{
+  fprintf(stderr, "[FTK] fatal: FTK not compiled with HDF5.\n");
+  assert(false);
+}
 #endif
 
 template <typename T>
 inline ndarray<T> ndarray<T>::slice(const lattice& l) const
 {
-  ndarray<T> array(l);
-  for (auto i = 0; i < l.n(); i ++) {
-    auto idx = l.from_integer(i);
-    array[i] = at(idx);
-  }
-  return array;
+  return ndarray<T>(slice_view(l));
 }
 
 template <typename T>
@@ -781,14 +1225,7 @@ inline ndarray<T> ndarray<T>::slice(const std::vector<size_t>& st, const std::ve
 template <typename T>
 inline ndarray<T> ndarray<T>::slice_time(size_t t) const 
 {
-  ndarray<T> array;
-  std::vector<size_t> mydims(dims);
-  mydims.resize(nd()-1);
-
-  array.reshape(mydims);
-  memcpy(&array[0], &p[t * s[nd()-1]], s[nd()-1] * sizeof(T));
-
-  return array;
+  return ndarray<T>(slice_time_view(t));
 }
 
 template <typename T>
@@ -801,6 +1238,200 @@ inline std::vector<ndarray<T>> ndarray<T>::slice_time() const
   return arrays;
 }
 
+///////
+template <typename T>
+ndarray_view<T>::ndarray_view(T *p_, const std::vector<size_t> &dims_)
+  : dims(dims_), s(dims_.size()), p(p_)
+{
+  for (size_t i = 0; i < nd(); i ++)
+    if (i == 0) s[i] = 1;
+    else s[i] = s[i-1]*dims[i-1];
+}
+
+template <typename T>
+ndarray_view<T>::ndarray_view(T *p_, const std::vector<size_t> &dims_, const std::vector<size_t> &strides_, 
+    std::shared_ptr<const mapped_file> file_)
+  : dims(dims_), s(strides_), p(p_), file(file_)
+{
+  size_t expected = 1;
+  for (size_t i = 0; i < nd(); i ++) {
+    if (dims[i] > 1 && s[i] != expected) contiguous = false;
+    expected *= dims[i];
+  }
+}
+
+template <typename T>
+lattice ndarray_view<T>::get_lattice() const {
+  std::vector<size_t> st(nd(), 0), sz(dims);
+  return lattice(st, sz);
+}
+
+template <typename T>
+size_t ndarray_view<T>::index(const std::vector<size_t>& idx) const {
+  size_t i(0);
+  for (size_t j = 0; j < nd(); j ++)
+    i += idx[j] * s[j];
+  return i;
+}
+
+template <typename T>
+size_t ndarray_view<T>::index(const std::vector<int>& idx) const {
+  std::vector<size_t> myidx(idx.begin(), idx.end());
+  return index(myidx);
+}
+
+template <typename T>
+size_t ndarray_view<T>::offset(size_t i) const {
+  size_t o = 0;
+  for (size_t j = 0; j < nd(); j ++) {
+    o += (i % dims[j]) * s[j];
+    i /= dims[j];
+  }
+  return o;
+}
+
+template <typename T>
+inline ndarray_view<T> ndarray_view<T>::slice(const lattice& l) const
+{
+  size_t o = 0;
+  for (size_t j = 0; j < nd(); j ++)
+    o += l.start(j) * s[j];
+  return ndarray_view<T>(p + o, l.sizes(), s, file);
+}
+
+template <typename T>
+inline ndarray_view<T> ndarray_view<T>::slice(const std::vector<size_t>& st, const std::vector<size_t>& sz) const
+{
+  return slice(lattice(st, sz));
+}
+
+template <typename T>
+inline ndarray_view<T> ndarray_view<T>::slice_time(size_t t) const
+{
+  std::vector<size_t> mydims(dims.begin(), dims.end()-1), 
+                      mys(s.begin(), s.end()-1);
+  return ndarray_view<T>(p + t * s[nd()-1], mydims, mys, file);
+}
+
+template <typename T>
+inline std::vector<ndarray_view<T>> ndarray_view<T>::slice_time() const
+{
+  std::vector<ndarray_view<T>> views;
+  const size_t nt = shape(nd()-1);
+  for (size_t i = 0; i < nt; i ++) 
+    views.push_back(slice_time(i));
+  return views;
+}
+
+template <typename T>
+template <typename F>
+inline void ndarray_view<T>::for_each_row(F f) const
+{
+  const size_t n = nelem();
+  for (size_t i = 0; i < n; i += dims[0])
+    f(i, offset(i));
+}
+
+template <typename T>
+template <typename T1>
+inline void ndarray_view<T>::copy_to(T1 *out) const
+{
+  if (empty()) return;
+  else if (contiguous) 
+    std::copy(p, p + nelem(), out);
+  else {
+    for_each_row([&](size_t i, size_t o) {
+      for (size_t k = 0; k < dims[0]; k ++)
+        out[i+k] = static_cast<T1>(p[o + k*s[0]]);
+    });
+  }
+}
+
+template <typename T>
+inline void ndarray_view<T>::advise(int access) const
+{
+  if (!file || empty()) return;
+  else if (contiguous) 
+    file->advise(p, nelem() * sizeof(T), access);
+  else { // coalesce the byte ranges of rows 
+    const char *lo = NULL, *hi = NULL;
+    for_each_row([&](size_t, size_t o) {
+      const char *first = reinterpret_cast<const char*>(p + o), 
+                 *last = reinterpret_cast<const char*>(p + o + (dims[0]-1)*s[0] + 1);
+      if (lo && first <= hi + 4096) hi = std::max(hi, last);
+      else {
+        if (lo) file->advise(lo, hi - lo, access);
+        lo = first; hi = last;
+      }
+    });
+    if (lo) file->advise(lo, hi - lo, access);
+  }
+}
+
+template <typename T>
+inline void ndarray_view<T>::to_numpy(const std::string& filename) const
+{
+  const std::string header = npy_header::make(npy_dtype<value_type>(), dims);
+
+  FILE *fp = fopen(filename.c_str(), "wb");
+  fwrite(header.data(), 1, header.size(), fp);
+  to_binary_file(fp);
+  fclose(fp);
+}
+
+template <typename T>
+inline void ndarray_view<T>::to_bov(const std::string& filename) const
+{
+  bov_header h;
+  h.dtype = npy_dtype<value_type>();
+  if (bov_header::format_from_dtype(h.dtype).empty()) {
+    fprintf(stderr, "[FTK] fatal error: data type %s not supported by bov.\n", h.dtype.c_str());
+    assert(false);
+    return;
+  }
+  
+  if (nd() == 4) { // multicomponent
+    h.components = dims[0];
+    h.data_size.assign(dims.begin()+1, dims.end());
+  } else 
+    h.data_size = dims;
+
+  const size_t dot = filename.find_last_of('.');
+  if (dot != std::string::npos && filename.substr(dot) == ".bov")
+    h.data_file = filename.substr(0, dot) + ".raw";
+  else 
+    h.data_file = filename + ".raw";
+
+  h.write(filename);
+  to_binary_file(h.data_file);
+}
+
+template <typename T>
+inline void ndarray_view<T>::to_binary_file(const std::string& f) const
+{
+  FILE *fp = fopen(f.c_str(), "wb");
+  to_binary_file(fp);
+  fclose(fp);
+}
+
+template <typename T>
+inline void ndarray_view<T>::to_binary_file(FILE *fp) const
+{
+  if (empty()) return;
+  else if (contiguous) 
+    fwrite(p, sizeof(T), nelem(), fp);
+  else if (s[0] == 1) // rows are contiguous
+    for_each_row([&](size_t, size_t o) {fwrite(p + o, sizeof(T), dims[0], fp);});
+  else {
+    std::vector<value_type> row(dims[0]);
+    for_each_row([&](size_t, size_t o) {
+      for (size_t k = 0; k < dims[0]; k ++)
+        row[k] = p[o + k*s[0]];
+      fwrite(row.data(), sizeof(T), dims[0], fp);
+    });
+  }
+}
+
 template <typename T>
 std::ostream& ndarray<T>::print(std::ostream& os) const
 {
@@ -835,8 +1466,8 @@ ndarray<T> ndarray<T>::transpose() const
 {
   ndarray<T> a;
   a.reshape(dim(1), dim(0));
-  for (auto i = 0; i < dim(0); i ++) 
-    for (auto j = 0; j < dim(1); j ++)
+  for (size_t i = 0; i < dim(0); i ++) 
+    for (size_t j = 0; j < dim(1); j ++)
       a(j, i) = at(i, j);
   return a;
 }
@@ -0,0 +1,186 @@
+#ifndef _FTK_NDARRAY_ALLOCATOR_HH
+#define _FTK_NDARRAY_ALLOCATOR_HH
+
+#include <ftk/ftk_config.hh>
+#include <map>
+#include <vector>
+#include <mutex>
+#include <new>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace ftk {
+
+// Storage of ndarray buffers.  All buffers are 64-byte aligned.  Large
+// buffers are mapped directly from the OS (optionally advised to use
+// transparent huge pages) and recycled through size-class free lists, so
+// that the arrays of each new timestep reuse the already-faulted pages of
+// the snapshots just popped, instead of going back to malloc/free.
+struct ndarray_pool {
+  static ndarray_pool& instance();
+
+  static constexpr size_t alignment = 64;
+  static constexpr size_t large_threshold = size_t(1) << 18; // buffers of at least 256 KiB are pooled
+
+  void set_enabled(bool b) {std::lock_guard<std::mutex> guard(mutex); enabled = b; if (!b) release_all();}
+  void set_huge_pages(bool b) {std::lock_guard<std::mutex> guard(mutex); huge_pages = b;}
+  void set_capacity(size_t bytes) {std::lock_guard<std::mutex> guard(mutex); capacity = bytes; trim();} // max bytes of cached buffers
+
+  void* allocate(size_t bytes);
+  void deallocate(void *p, size_t bytes);
+  void clear() {std::lock_guard<std::mutex> guard(mutex); release_all();} // return all cached buffers to the OS
+
+  struct stats_t {
+    size_t fresh = 0, // large buffers mapped from the OS
+           reused = 0, // large buffers served from the pool
+           cached_bytes = 0;
+  };
+  stats_t stats() const {std::lock_guard<std::mutex> guard(mutex); return st;}
+
+  static size_t size_class(size_t bytes);
+
+private:
+  ndarray_pool() {}
+  void release_all();
+  void trim();
+  static void prefault(void *p, size_t bytes); // faults in the pages of a fresh mapping
+
+private:
+  mutable std::mutex mutex;
+  std::map<size_t, std::vector<void*>> free_lists; // size class -> cached buffers
+  bool enabled = true, huge_pages = false;
+  size_t capacity = size_t(1) << 30;
+  stats_t st;
+};
+
+// allocator for the std::vector behind ndarray
+template <typename T>
+struct ndarray_allocator {
+  typedef T value_type;
+
+  ndarray_allocator() noexcept {}
+  template <typename U> ndarray_allocator(const ndarray_allocator<U>&) noexcept {}
+
+  T* allocate(size_t n) {return static_cast<T*>(ndarray_pool::instance().allocate(n * sizeof(T)));}
+  void deallocate(T *p, size_t n) noexcept {ndarray_pool::instance().deallocate(p, n * sizeof(T));}
+};
+
+template <typename T, typename U>
+bool operator==(const ndarray_allocator<T>&, const ndarray_allocator<U>&) {return true;}
+
+template <typename T, typename U>
+bool operator!=(const ndarray_allocator<T>&, const ndarray_allocator<U>&) {return false;}
+
+///////
+inline ndarray_pool& ndarray_pool::instance()
+{
+  static ndarray_pool *pool = new ndarray_pool; // never destroyed, as arrays may outlive static destruction
+  return *pool;
+}
+
+inline size_t ndarray_pool::size_class(size_t bytes)
+{
+  if (bytes < large_threshold)
+    return (bytes + alignment - 1) / alignment * alignment;
+
+  // four classes per power of two, i.e. at most 25% internal fragmentation
+  size_t b = large_threshold;
+  while ((b << 1) <= bytes) b <<= 1;
+  const size_t step = b / 4;
+  return (bytes + step - 1) / step * step;
+}
+
+inline void* ndarray_pool::allocate(size_t bytes)
+{
+  if (bytes == 0) return NULL;
+
+  const size_t n = size_class(bytes);
+  if (n < large_threshold) {
+    void *p = NULL;
+    if (posix_memalign(&p, alignment, n) != 0) throw std::bad_alloc();
+    return p;
+  }
+
+  bool huge;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    huge = huge_pages;
+    auto it = free_lists.find(n);
+    if (it != free_lists.end() && !it->second.empty()) {
+      void *p = it->second.back();
+      it->second.pop_back();
+      st.cached_bytes -= n;
+      st.reused ++;
+      return p;
+    }
+    st.fresh ++;
+  }
+
+  // huge pages are advised before any page is faulted in; fresh pages are
+  // then populated up front, since the array is initialized right away
+  void *p = mmap(NULL, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+  if (huge) madvise(p, n, MADV_HUGEPAGE);
+#endif
+  prefault(p, n);
+  return p;
+}
+
+inline void ndarray_pool::prefault(void *p, size_t bytes)
+{
+#ifdef MADV_POPULATE_WRITE
+  if (madvise(p, bytes, MADV_POPULATE_WRITE) == 0) return;
+#endif
+  // kernels before 5.14; one write per page
+  const size_t page = sysconf(_SC_PAGESIZE);
+  volatile char *q = static_cast<char*>(p);
+  for (size_t i = 0; i < bytes; i += page)
+    q[i] = 0;
+}
+
+inline void ndarray_pool::deallocate(void *p, size_t bytes)
+{
+  if (p == NULL) return;
+
+  const size_t n = size_class(bytes);
+  if (n < large_threshold) {
+    free(p);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (enabled && st.cached_bytes + n <= capacity) {
+      free_lists[n].push_back(p);
+      st.cached_bytes += n;
+      return;
+    }
+  }
+  munmap(p, n);
+}
+
+inline void ndarray_pool::release_all()
+{
+  for (auto &kv : free_lists)
+    for (auto p : kv.second)
+      munmap(p, kv.first);
+  free_lists.clear();
+  st.cached_bytes = 0;
+}
+
+inline void ndarray_pool::trim()
+{
+  for (auto it = free_lists.begin(); it != free_lists.end() && st.cached_bytes > capacity; it ++) {
+    while (!it->second.empty() && st.cached_bytes > capacity) {
+      munmap(it->second.back(), it->first);
+      it->second.pop_back();
+      st.cached_bytes -= it->first;
+    }
+  }
+}
+
+}
+
+#endif
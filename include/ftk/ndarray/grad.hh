@@ -3,28 +3,61 @@
 
 #include <ftk/ndarray.hh>
 #include <ftk/hypermesh/regular_simplex_mesh.hh>
+#include <algorithm>
 
 namespace ftk {
 
-// derive 2D gradients for 2D scalar field
+// gradients of row j of a 2D scalar field; g points to a 2xWxH array.
+// Cells without a complete stencil are set to zero.
 template <typename T>
-ndarray<T> gradient2D(const ndarray<T>& scalar)
+inline void gradient2D_row(const ndarray_view<const T>& scalar, T *g, size_t j)
 {
-  const int DW = scalar.dim(0), DH = scalar.dim(1);
-  ndarray<T> grad;
-  grad.reshape(2, DW, DH); 
+  const size_t DW = scalar.dim(0), DH = scalar.dim(1);
+  const size_t sx = scalar.stride(0), sy = scalar.stride(1);
+  const double fx = DW-1, fy = DH-1;
 
-#pragma omp parallel for collapse(2)
-  for (int j = 1; j < DH-1; j ++) {
-    for (int i = 1; i < DW-1; i ++) {
-      auto dfdx = grad(0, i, j) = 0.5 * (scalar(i+1, j) - scalar(i-1, j)) * (DW-1);
-      auto dfdy = grad(1, i, j) = 0.5 * (scalar(i, j+1) - scalar(i, j-1)) * (DH-1);
-      // fprintf(stderr, "s=%f, grad=%f, %f\n", scalar(i, j), dfdx, dfdy);
-    }
+  T *gj = g + 2*DW*j;
+  if (j == 0 || j >= DH-1 || DW < 3) {
+    std::fill(gj, gj + 2*DW, T(0));
+    return;
   }
+  gj[0] = gj[1] = gj[2*DW-2] = gj[2*DW-1] = T(0);
+
+  const T *s = scalar.data() + j*sy, *sn = s + sy, *ss = s - sy;
+#pragma omp simd
+  for (size_t i = 1; i < DW-1; i ++) {
+    gj[2*i]   = 0.5 * (s[(i+1)*sx] - s[(i-1)*sx]) * fx;
+    gj[2*i+1] = 0.5 * (sn[i*sx] - ss[i*sx]) * fy;
+  }
+}
+
+// derive 2D gradients for 2D scalar field into grad, which is reshaped to 2xWxH
+template <typename T>
+void gradient2D(const ndarray_view<const T>& scalar, ndarray<T>& grad)
+{
+  const size_t DW = scalar.dim(0), DH = scalar.dim(1);
+  grad.reshape(2, DW, DH);
+
+#pragma omp parallel for
+  for (size_t j = 0; j < DH; j ++)
+    gradient2D_row(scalar, grad.data(), j);
+}
+
+// derive 2D gradients for 2D scalar field
+template <typename T>
+ndarray<T> gradient2D(const ndarray_view<const T>& scalar)
+{
+  ndarray<T> grad;
+  gradient2D(scalar, grad);
   return grad;
 }
 
+template <typename T>
+ndarray<T> gradient2D(const ndarray<T>& scalar)
+{
+  return gradient2D(scalar.view());
+}
+
 // derive 2D gradients for 2D time varying scalar field
 template <typename T>
 ndarray<T> gradient2Dt(const ndarray<T>& scalar)
@@ -45,28 +78,58 @@ ndarray<T> gradient2Dt(const ndarray<T>& scalar)
   return grad;
 }
 
-// derive gradients for 2D vector field
+// Jacobians of row j of a 2D vector field; J points to a 2x2xWxH array.
+// Cells without a complete stencil are set to zero.
 template <typename T>
-ndarray<T> jacobian2D(const ndarray<T>& vec)
+inline void jacobian2D_row(const ndarray_view<const T>& vec, T *J, size_t j)
 {
-  const int DW = vec.dim(1), DH = vec.dim(2);
-  ndarray<T> grad;
-  grad.reshape(2, 2, DW, DH);
+  const size_t DW = vec.dim(1), DH = vec.dim(2);
+  const size_t sc = vec.stride(0), sx = vec.stride(1), sy = vec.stride(2);
+  const double fx = DW-1, fy = DH-1;
 
-#pragma omp parallel for collapse(2)
-  for (int j = 2; j < DH-2; j ++) {
-    for (int i = 2; i < DW-2; i ++) {
-      const T H00 = grad(0, 0, i, j) = // du/dx 
-        0.5 * (vec(0, i+1, j) - vec(0, i-1, j)) * (DW-1); 
-      const T H01 = grad(0, 1, i, j) = // du/dy
-        0.5 * (vec(0, i, j+1) - vec(0, i, j-1)) * (DH-1);
-      const T H10 = grad(1, 0, i, j) = // dv/dx
-        0.5 * (vec(1, i+1, j) - vec(1, i-1, j)) * (DW-1);
-      const T H11 = grad(1, 1, i, j) = // dv.dy
-        0.5 * (vec(1, i, j+1) - vec(1, i, j-1)) * (DH-1);
-    }
+  T *Jj = J + 4*DW*j;
+  if (j < 2 || j+2 >= DH || DW < 4) {
+    std::fill(Jj, Jj + 4*DW, T(0));
+    return;
+  }
+  std::fill(Jj, Jj + 8, T(0));
+  std::fill(Jj + 4*(DW-2), Jj + 4*DW, T(0));
+
+  const T *u = vec.data() + j*sy, *v = u + sc;
+#pragma omp simd
+  for (size_t i = 2; i < DW-2; i ++) {
+    Jj[4*i]   = 0.5 * (u[(i+1)*sx] - u[(i-1)*sx]) * fx; // du/dx
+    Jj[4*i+2] = 0.5 * (u[i*sx+sy] - u[i*sx-sy]) * fy; // du/dy
+    Jj[4*i+1] = 0.5 * (v[(i+1)*sx] - v[(i-1)*sx]) * fx; // dv/dx
+    Jj[4*i+3] = 0.5 * (v[i*sx+sy] - v[i*sx-sy]) * fy; // dv/dy
   }
-  return grad;
+}
+
+// derive gradients for 2D vector field into J, which is reshaped to 2x2xWxH
+template <typename T>
+void jacobian2D(const ndarray_view<const T>& vec, ndarray<T>& J)
+{
+  const size_t DW = vec.dim(1), DH = vec.dim(2);
+  J.reshape(2, 2, DW, DH);
+
+#pragma omp parallel for
+  for (size_t j = 0; j < DH; j ++)
+    jacobian2D_row(vec, J.data(), j);
+}
+
+// derive gradients for 2D vector field
+template <typename T>
+ndarray<T> jacobian2D(const ndarray_view<const T>& vec)
+{
+  ndarray<T> J;
+  jacobian2D(vec, J);
+  return J;
+}
+
+template <typename T>
+ndarray<T> jacobian2D(const ndarray<T>& vec)
+{
+  return jacobian2D(vec.view());
 }
 
 // Derive Jacobians for piecewise linear vector field on regular grid.
@@ -110,28 +173,59 @@ ndarray<T> jacobian2Dt(const ndarray<T>& vec)
   return grad;
 }
 
-// derive gradients for 3D scalar field
+// gradients of row (j, k) of a 3D scalar field; g points to a 3xWxHxD array.
+// Cells without a complete stencil are set to zero.
 template <typename T>
-ndarray<T> gradient3D(const ndarray<T>& scalar)
+inline void gradient3D_row(const ndarray_view<const T>& scalar, T *g, size_t j, size_t k)
 {
-  const int DW = scalar.dim(0), DH = scalar.dim(1), DD = scalar.dim(2);
-  ndarray<T> grad;
-  grad.reshape(3, DW, DH, DD);
+  const size_t DW = scalar.dim(0), DH = scalar.dim(1), DD = scalar.dim(2);
+  const size_t sx = scalar.stride(0), sy = scalar.stride(1), sz = scalar.stride(2);
 
-#pragma omp parallel for collapse(3)
-  for (int k = 1; k < DD-1; k ++) {
-    for (int j = 1; j < DH-1; j ++) {
-      for (int i = 1; i < DW-1; i ++) {
-        grad(0, i, j, k) = 0.5 * (scalar(i+1, j, k) - scalar(i-1, j, k));
-        grad(1, i, j, k) = 0.5 * (scalar(i, j+1, k) - scalar(i, j-1, k));
-        grad(2, i, j, k) = 0.5 * (scalar(i, j, k+1) - scalar(i, j, k-1));
-      }
-    }
+  T *gj = g + 3*DW*(j + DH*k);
+  if (j == 0 || j >= DH-1 || k == 0 || k >= DD-1 || DW < 3) {
+    std::fill(gj, gj + 3*DW, T(0));
+    return;
   }
+  std::fill(gj, gj + 3, T(0));
+  std::fill(gj + 3*(DW-1), gj + 3*DW, T(0));
 
+  const T *s = scalar.data() + j*sy + k*sz;
+#pragma omp simd
+  for (size_t i = 1; i < DW-1; i ++) {
+    gj[3*i]   = 0.5 * (s[(i+1)*sx] - s[(i-1)*sx]);
+    gj[3*i+1] = 0.5 * (s[i*sx+sy] - s[i*sx-sy]);
+    gj[3*i+2] = 0.5 * (s[i*sx+sz] - s[i*sx-sz]);
+  }
+}
+
+// derive gradients for 3D scalar field into grad, which is reshaped to 3xWxHxD
+template <typename T>
+void gradient3D(const ndarray_view<const T>& scalar, ndarray<T>& grad)
+{
+  const size_t DW = scalar.dim(0), DH = scalar.dim(1), DD = scalar.dim(2);
+  grad.reshape(3, DW, DH, DD);
+
+#pragma omp parallel for collapse(2)
+  for (size_t k = 0; k < DD; k ++)
+    for (size_t j = 0; j < DH; j ++)
+      gradient3D_row(scalar, grad.data(), j, k);
+}
+
+// derive gradients for 3D scalar field
+template <typename T>
+ndarray<T> gradient3D(const ndarray_view<const T>& scalar)
+{
+  ndarray<T> grad;
+  gradient3D(scalar, grad);
   return grad;
 }
 
+template <typename T>
+ndarray<T> gradient3D(const ndarray<T>& scalar)
+{
+  return gradient3D(scalar.view());
+}
+
 template <typename T>
 ndarray<T> gradient3Dt(const ndarray<T>& scalar)
 {
@@ -155,45 +249,63 @@ ndarray<T> gradient3Dt(const ndarray<T>& scalar)
   return grad;
 }
 
-// derivate gradients (jacobians) for 3D vector field
+// Jacobians of row (j, k) of a 3D vector field; J points to a 3x3xWxHxD array.
+// Cells without a complete stencil are set to zero.
 template <typename T>
-ndarray<T> jacobian3D(const ndarray<T>& V)
+inline void jacobian3D_row(const ndarray_view<const T>& V, T *J, size_t j, size_t k)
 {
-  const int DW = V.dim(1), DH = V.dim(2), DD = V.dim(3);
-  ndarray<T> J;
-  J.reshape(3, 3, DW, DH, DD);
+  const size_t DW = V.dim(1), DH = V.dim(2), DD = V.dim(3);
+  const size_t sc = V.stride(0), sx = V.stride(1), sy = V.stride(2), sz = V.stride(3);
 
-#pragma omp parallel for collapse(3)
-  for (int k = 2; k < DD-2; k ++) {
-    for (int j = 2; j < DH-2; j ++) {
-      for (int i = 2; i < DW-2; i ++) {
-        const float H00 = J(0, 0, i, j, k) = // ddf/dx2
-          0.5 * (V(0, i+1, j, k) - V(0, i-1, j, k));
-        const float H01 = J(0, 1, i, j, k) = // ddf/dxdy
-          0.5 * (V(0, i, j+1, k) - V(0, i, j-1, k));
-        const float H02 = J(0, 2, i, j, k) = // ddf/dxdz
-          0.5 * (V(0, i, j, k+1) - V(0, i, j, k-1));
-
-        const float H10 = J(1, 0, i, j, k) = // ddf/dydx
-          0.5 * (V(1, i+1, j, k) - V(1, i-1, j, k));
-        const float H11 = J(1, 1, i, j, k) = // ddf/dy2
-          0.5 * (V(1, i, j+1, k) - V(1, i, j-1, k));
-        const float H12 = J(1, 2, i, j, k) = // ddf/dydz
-          0.5 * (V(1, i, j, k+1) - V(1, i, j, k-1));
-
-        const float H20 = J(2, 0, i, j, k) = // ddf/dydx
-          0.5 * (V(2, i+1, j, k) - V(2, i-1, j, k));
-        const float H21 = J(2, 1, i, j, k) = // ddf/dy2
-          0.5 * (V(2, i, j+1, k) - V(2, i, j-1, k));
-        const float H22 = J(2, 2, i, j, k) = // ddf/dydz
-          0.5 * (V(2, i, j, k+1) - V(2, i, j, k-1));
-      }
+  T *Jj = J + 9*DW*(j + DH*k);
+  if (j < 2 || j+2 >= DH || k < 2 || k+2 >= DD || DW < 4) {
+    std::fill(Jj, Jj + 9*DW, T(0));
+    return;
+  }
+  std::fill(Jj, Jj + 18, T(0));
+  std::fill(Jj + 9*(DW-2), Jj + 9*DW, T(0));
+
+  const T *v = V.data() + j*sy + k*sz;
+  for (size_t c = 0; c < 3; c ++) { // J(c, 0..2) = d(V_c)/d(x, y, z)
+    const T *vc = v + c*sc;
+    T *Jc = Jj + c;
+#pragma omp simd
+    for (size_t i = 2; i < DW-2; i ++) {
+      Jc[9*i]   = 0.5 * (vc[(i+1)*sx] - vc[(i-1)*sx]);
+      Jc[9*i+3] = 0.5 * (vc[i*sx+sy] - vc[i*sx-sy]);
+      Jc[9*i+6] = 0.5 * (vc[i*sx+sz] - vc[i*sx-sz]);
     }
   }
+}
+
+// derivate gradients (jacobians) for 3D vector field into J, which is reshaped to 3x3xWxHxD
+template <typename T>
+void jacobian3D(const ndarray_view<const T>& V, ndarray<T>& J)
+{
+  const size_t DW = V.dim(1), DH = V.dim(2), DD = V.dim(3);
+  J.reshape(3, 3, DW, DH, DD);
+
+#pragma omp parallel for collapse(2)
+  for (size_t k = 0; k < DD; k ++)
+    for (size_t j = 0; j < DH; j ++)
+      jacobian3D_row(V, J.data(), j, k);
+}
 
+// derivate gradients (jacobians) for 3D vector field
+template <typename T>
+ndarray<T> jacobian3D(const ndarray_view<const T>& V)
+{
+  ndarray<T> J;
+  jacobian3D(V, J);
   return J;
 }
 
+template <typename T>
+ndarray<T> jacobian3D(const ndarray<T>& V)
+{
+  return jacobian3D(V.view());
+}
+
 // derive gradients (jacobians) for 3D time varying vector field
 template <typename T>
 ndarray<T> jacobian3Dt(const ndarray<T>& V)
@@ -235,6 +347,78 @@ ndarray<T> jacobian3Dt(const ndarray<T>& V)
   return J;
 }
 
+// Fused derivation of gradients and Jacobians of a 2D scalar field, with
+// the same results as gradient2D followed by jacobian2D.  Rows are swept
+// in blocks; the Jacobians of a block are derived right after its
+// gradients, while the neighboring gradient rows are still in cache.
+// grad and J are reshaped to 2xWxH and 2x2xWxH; buffers of the right size
+// are reused.
+template <typename T>
+void gradient_jacobian2D(const ndarray_view<const T>& scalar, ndarray<T>& grad, ndarray<T>& J, size_t block = 32)
+{
+  const size_t DH = scalar.dim(1);
+  grad.reshape(2, scalar.dim(0), DH);
+  J.reshape(2, 2, scalar.dim(0), DH);
+  block = std::max(block, size_t(1));
+
+  const ndarray_view<const T> vec = grad.view();
+  T *g = grad.data(), *h = J.data();
+
+#pragma omp parallel
+  for (size_t j0 = 0; j0 < DH; j0 += block) {
+    const size_t j1 = std::min(j0 + block, DH);
+#pragma omp for schedule(static)
+    for (size_t j = j0; j < j1; j ++)
+      gradient2D_row(scalar, g, j);
+
+    // rows whose gradient stencils are complete by now
+    const size_t l0 = j0 == 0 ? 0 : j0-1, l1 = j1 == DH ? DH : j1-1;
+#pragma omp for schedule(static)
+    for (size_t j = l0; j < l1; j ++)
+      jacobian2D_row(vec, h, j);
+  }
+}
+
+template <typename T>
+void gradient_jacobian2D(const ndarray<T>& scalar, ndarray<T>& grad, ndarray<T>& J)
+{
+  gradient_jacobian2D(scalar.view(), grad, J);
+}
+
+// 3D counterpart of gradient_jacobian2D, swept in blocks of z-slices
+template <typename T>
+void gradient_jacobian3D(const ndarray_view<const T>& scalar, ndarray<T>& grad, ndarray<T>& J, size_t block = 4)
+{
+  const size_t DW = scalar.dim(0), DH = scalar.dim(1), DD = scalar.dim(2);
+  grad.reshape(3, DW, DH, DD);
+  J.reshape(3, 3, DW, DH, DD);
+  block = std::max(block, size_t(1));
+
+  const ndarray_view<const T> vec = grad.view();
+  T *g = grad.data(), *h = J.data();
+
+#pragma omp parallel
+  for (size_t k0 = 0; k0 < DD; k0 += block) {
+    const size_t k1 = std::min(k0 + block, DD);
+#pragma omp for collapse(2) schedule(static)
+    for (size_t k = k0; k < k1; k ++)
+      for (size_t j = 0; j < DH; j ++)
+        gradient3D_row(scalar, g, j, k);
+
+    const size_t l0 = k0 == 0 ? 0 : k0-1, l1 = k1 == DD ? DD : k1-1;
+#pragma omp for collapse(2) schedule(static)
+    for (size_t k = l0; k < l1; k ++)
+      for (size_t j = 0; j < DH; j ++)
+        jacobian3D_row(vec, h, j, k);
+  }
+}
+
+template <typename T>
+void gradient_jacobian3D(const ndarray<T>& scalar, ndarray<T>& grad, ndarray<T>& J)
+{
+  gradient_jacobian3D(scalar.view(), grad, J);
+}
+
 }
 
 #endif
@@ -190,6 +190,25 @@ ndarray<T> synthetic_merger_2D(int DW, int DH, T t)
   return scalar;
 }
 
+// generate 2D merger data in a core
+template <typename T>
+ndarray<T> synthetic_merger_2D_part(const lattice& ext, const lattice& core, T t)
+{
+  ndarray<T> scalar;
+  scalar.reshape(core.sizes());
+
+  const int DW = ext.size(0), DH = ext.size(1);
+  for (int j = 0; j < core.size(1); j ++) {
+    for (int i = 0; i < core.size(0); i ++) {
+      const T x = ((T(i + core.start(0)) / (DW-1)) - 0.5) * 4,
+              y = ((T(j + core.start(1)) / (DH-1)) - 0.5) * 4;
+      scalar(i, j) = merger_function_2Dt(x, y, t);
+    }
+  }
+
+  return scalar;
+}
+
 /// modified from https://web.cse.ohio-state.edu/~crawfis.3/Data/Tornado/tornadoSrc.c
 // void gen_tornado( int xs, int ys, int zs, int time, float *tornado )
 /*
@@ -2,14 +2,33 @@
 #define _FTK_STORAGE
 
 #include <iostream>
+#include <string>
+#include <vector>
+#include <utility>
 #include "ftk/external/json.hh"
+#include "ftk/external/diy-ext/serialization.hh"
 
 namespace ftk {
 
 class storage {
-public: 
+public:
   virtual ~storage() {}
 
+  // records written together, e.g. those of one timestep; backends
+  // with write batches (leveldb and rocksdb) apply them atomically
+  struct batch {
+    void put(const std::string& key, const std::string& val) {records.emplace_back(key, val);}
+    void put(const std::string& key, std::string&& val) {records.emplace_back(key, std::move(val));}
+    template <typename T> void put_bin(const std::string& key, const T& val); // diy-serialized
+    template <typename T> void put_obj(const std::string& key, const T& val); // json
+
+    size_t size() const {return records.size();}
+    bool empty() const {return records.empty();}
+    void clear() {records.clear();}
+
+    std::vector<std::pair<std::string, std::string>> records;
+  };
+
   virtual bool open(void*) {return false;}
   virtual bool open(const std::string&) = 0;
   virtual void close() = 0;
@@ -20,11 +39,60 @@ public:
     nlohmann::json j;
     nlohmann::adl_serializer<T>::to_json(j, val);
     put(key, j.dump());
-  } 
+  }
+  template <typename T> void put_bin(const std::string& key, const T& val) { // diy-serialized
+    std::string buf;
+    diy::serializeToString(val, buf);
+    put(key, buf);
+  }
+
+  virtual void write(const batch& b) { // sequential puts, unless overridden
+    for (const auto &r : b.records)
+      put(r.first, r.second);
+  }
 
   virtual std::string get(const std::string& key) = 0;
+  virtual std::vector<std::string> multi_get(const std::vector<std::string>& keys) { // empty values for missing keys
+    std::vector<std::string> vals;
+    vals.reserve(keys.size());
+    for (const auto &k : keys)
+      vals.push_back(get(k));
+    return vals;
+  }
+  template <typename T> bool get_bin(const std::string& key, T& val) { // false if missing
+    const std::string buf = get(key);
+    if (buf.empty()) return false;
+    diy::unserializeFromString(buf, val);
+    return true;
+  }
+
+  virtual void flush() {} // makes buffered writes durable
+
+  // whether each write waits until the data reach the disk; off by
+  // default, so that writes return once handed to the operating system
+  void set_sync(bool b) {sync = b;}
+
+protected:
+  bool sync = false;
 };
 
+/////
+template <typename T>
+inline void storage::batch::put_bin(const std::string& key, const T& val)
+{
+  std::string buf;
+  diy::serializeToString(val, buf);
+  put(key, std::move(buf));
+}
+
+template <typename T>
+inline void storage::batch::put_obj(const std::string& key, const T& val)
+{
+  nlohmann::json j;
+  nlohmann::adl_serializer<T>::to_json(j, val);
+  put(key, j.dump());
+}
+
 }
 
 #endif
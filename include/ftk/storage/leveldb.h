@@ -3,6 +3,7 @@
 
 #include "ftk/storage/base.h"
 #include <leveldb/db.h>
+#include <leveldb/write_batch.h>
 
 namespace ftk {
 
@@ -28,7 +29,14 @@ public:
   }
 
   void put(const std::string& key, const std::string& val) {
-    _db->Put(leveldb::WriteOptions(), key, val);
+    _db->Put(write_options(), key, val);
+  }
+
+  void write(const batch& b) { // one atomic write
+    leveldb::WriteBatch wb;
+    for (const auto &r : b.records)
+      wb.Put(r.first, r.second);
+    _db->Write(write_options(), &wb);
   }
 
   std::string get(const std::string& key) {
@@ -37,6 +45,24 @@ public:
     return val;
   }
 
+  std::vector<std::string> multi_get(const std::vector<std::string>& keys) {
+    leveldb::ReadOptions options;
+    options.snapshot = _db->GetSnapshot(); // a consistent view of all keys
+    std::vector<std::string> vals(keys.size());
+    for (size_t i = 0; i < keys.size(); i ++)
+      if (!_db->Get(options, keys[i], &vals[i]).ok()) 
+        vals[i].clear();
+    _db->ReleaseSnapshot(options.snapshot);
+    return vals;
+  }
+
+private:
+  leveldb::WriteOptions write_options() const {
+    leveldb::WriteOptions options;
+    options.sync = sync;
+    return options;
+  }
+
 private:
   leveldb::DB *_db;
   bool _external_db = false;
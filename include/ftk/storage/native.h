@@ -2,30 +2,356 @@
 #define _FTK_DIR_STORAGE
 
 #include "ftk/storage/base.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <errno.h>
 
 namespace ftk {
 
+// Log-structured key-value store in a directory, without third-party
+// dependencies.  Records are appended to a single log file, and the
+// latest record of a key wins.  Keys are located with an in-memory
+// index, which is checkpointed on close and otherwise rebuilt by scanning
+// the log from the last checkpoint.  Writes are buffered and committed
+// in groups with a single write (and optionally fsync); values are
+// read with pread, or from the buffers of uncommitted writes.  A record
+// torn by a crash is detected by its checksum and truncated on open.
 class storage_native: public storage {
-public: 
-  bool open(const std::string& dbname) {
+public:
+  ~storage_native() {close();}
+
+  bool open(const std::string& dbname);
+  void close();
+
+  void put(const std::string& key, const std::string& val) {put(key, val.data(), val.size());}
+  void put(const std::string& key, const void *val, size_t size); // binary blob
+  void write(const batch& b); // committed together
+  std::string get(const std::string& key);
+  bool has(const std::string& key);
+
+  void flush(); // commits buffered writes
+  void set_group_commit_bytes(size_t n) {group_commit_bytes = n;} // buffered bytes triggering a commit; fsync'ed if sync is set
+
+  size_t size(); // number of keys
+
+private:
+  struct record_header {
+    uint32_t checksum;
+    uint32_t key_size;
+    uint64_t val_size;
+  };
+  struct location {
+    uint64_t offset, size; // of the value in the log
+  };
+  struct buffer { // records not yet in the file
+    uint64_t base = 0; // offset in the log
+    std::string data;
+  };
+
+  static uint32_t checksum(const record_header& h, const char *key, const char *val);
+
+  bool scan(uint64_t from); // indexes records in the log from an offset
+  bool load_index();
+  void save_index();
+  void append(const std::string& key, const char *val, size_t size); // with the mutex held
+  void commit(bool force);
+
+private:
+  std::string dir;
+  int fd = -1;
+
+  std::mutex mutex; // guards the following
+  std::unordered_map<std::string, location> index;
+  uint64_t committed_size = 0; // bytes in the file
+  std::shared_ptr<buffer> pending, inflight;
+
+  std::mutex commit_mutex; // serializes commits
+
+  size_t group_commit_bytes = size_t(1) << 20;
+
+  static const uint64_t index_magic = 0x46544b494458ULL; // "FTKIDX"
+};
+
+/////
+inline uint32_t storage_native::checksum(const record_header& h, const char *key, const char *val)
+{
+  uint32_t c = 2166136261u; // fnv-1a
+  auto update = [&c](const char *p, size_t n) {
+    for (size_t i = 0; i < n; i ++) {
+      c ^= uint8_t(p[i]);
+      c *= 16777619u;
+    }
+  };
+  update(reinterpret_cast<const char*>(&h.key_size), sizeof(h.key_size));
+  update(reinterpret_cast<const char*>(&h.val_size), sizeof(h.val_size));
+  update(key, h.key_size);
+  update(val, h.val_size);
+  return c;
+}
+
+inline bool storage_native::open(const std::string& dbname)
+{
+  close();
+  dir = dbname;
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    fprintf(stderr, "[FTK] error: cannot create storage directory %s.\n", dir.c_str());
     return false;
   }
 
-  void close() {
+  fd = ::open((dir + "/log").c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "[FTK] error: cannot open storage log in %s.\n", dir.c_str());
+    return false;
   }
 
-  void put(const std::string& key, const std::string& val) {
+  auto fail = [this](const char *what) { // leaves the storage closed
+    fprintf(stderr, "[FTK] error: cannot %s storage log in %s.\n", what, dir.c_str());
+    ::close(fd);
+    fd = -1;
+    index.clear();
+    pending.reset();
+    inflight.reset();
+    return false;
+  };
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) return fail("stat");
+  committed_size = st.st_size;
+  pending = std::make_shared<buffer>();
+  pending->base = committed_size;
+
+  // the checkpointed index covers a prefix of the log
+  if (!load_index()) {
+    index.clear();
+    if (!scan(0)) return fail("recover");
   }
+  return true;
+}
 
-  std::string get(const std::string& key) {
-    std::string val;
-    return val;
+inline void storage_native::close()
+{
+  if (fd < 0) return;
+  flush();
+  save_index();
+  ::close(fd);
+  fd = -1;
+  index.clear();
+  pending.reset();
+  inflight.reset();
+}
+
+inline bool storage_native::scan(uint64_t offset)
+{
+  const uint64_t end = committed_size;
+  std::vector<char> kv;
+  while (offset + sizeof(record_header) <= end) {
+    record_header h;
+    if (pread(fd, &h, sizeof(h), offset) != sizeof(h)) break;
+    const uint64_t n = uint64_t(h.key_size) + h.val_size;
+    if (offset + sizeof(h) + n > end) break; // torn record
+
+    kv.resize(n);
+    if (pread(fd, kv.data(), n, offset + sizeof(h)) != ssize_t(n)) break;
+    if (checksum(h, kv.data(), kv.data() + h.key_size) != h.checksum) break;
+
+    location l = {offset + sizeof(h) + h.key_size, h.val_size};
+    index[std::string(kv.data(), h.key_size)] = l;
+    offset += sizeof(h) + n;
   }
 
-private:
-};
+  if (offset < end) { // drop the damaged tail
+    fprintf(stderr, "[FTK] warning: truncating %llu damaged bytes of storage log in %s.\n",
+        (unsigned long long)(end - offset), dir.c_str());
+    if (ftruncate(fd, offset) != 0) return false;
+    committed_size = offset;
+    pending->base = offset;
+  }
+  return true;
+}
+
+inline bool storage_native::load_index()
+{
+  FILE *fp = fopen((dir + "/index").c_str(), "rb");
+  if (!fp) return false;
+
+  bool succ = true;
+  uint64_t magic = 0, log_size = 0, n = 0;
+  succ = fread(&magic, sizeof(magic), 1, fp) == 1 && magic == index_magic
+    && fread(&log_size, sizeof(log_size), 1, fp) == 1 && log_size <= committed_size
+    && fread(&n, sizeof(n), 1, fp) == 1;
+
+  std::string key;
+  for (uint64_t i = 0; succ && i < n; i ++) {
+    uint32_t key_size;
+    location l;
+    succ = fread(&key_size, sizeof(key_size), 1, fp) == 1;
+    if (succ) {
+      key.resize(key_size);
+      succ = (key_size == 0 || fread(&key[0], 1, key_size, fp) == key_size)
+        && fread(&l, sizeof(l), 1, fp) == 1 && l.offset + l.size <= log_size;
+    }
+    if (succ) index[key] = l;
+  }
+  fclose(fp);
+
+  return succ && scan(log_size); // records appended after the checkpoint
+}
+
+inline void storage_native::save_index()
+{
+  const std::string filename = dir + "/index", tmp = filename + ".tmp";
+  FILE *fp = fopen(tmp.c_str(), "wb");
+  if (!fp) return;
+
+  const uint64_t magic = index_magic, n = index.size();
+  bool succ = fwrite(&magic, sizeof(magic), 1, fp) == 1
+    && fwrite(&committed_size, sizeof(committed_size), 1, fp) == 1
+    && fwrite(&n, sizeof(n), 1, fp) == 1;
+  for (const auto &kv : index) {
+    const uint32_t key_size = kv.first.size();
+    succ = succ && fwrite(&key_size, sizeof(key_size), 1, fp) == 1
+      && fwrite(kv.first.data(), 1, key_size, fp) == key_size
+      && fwrite(&kv.second, sizeof(location), 1, fp) == 1;
+  }
+  succ = fclose(fp) == 0 && succ;
+
+  if (succ) rename(tmp.c_str(), filename.c_str()); // atomic replacement
+  else remove(tmp.c_str());
+}
+
+inline void storage_native::append(const std::string& key, const char *val, size_t size)
+{
+  record_header h;
+  h.key_size = key.size();
+  h.val_size = size;
+  h.checksum = checksum(h, key.data(), val);
+
+  std::string &d = pending->data;
+  const uint64_t offset = pending->base + d.size();
+  d.append(reinterpret_cast<const char*>(&h), sizeof(h));
+  d.append(key);
+  d.append(val, size);
+
+  location l = {offset + sizeof(h) + key.size(), size};
+  index[key] = l;
+}
+
+inline void storage_native::put(const std::string& key, const void *val, size_t size)
+{
+  bool full;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    append(key, static_cast<const char*>(val), size);
+    full = pending->data.size() >= group_commit_bytes;
+  }
+
+  if (full) commit(false);
+}
+
+inline void storage_native::write(const batch& b)
+{
+  bool full;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    for (const auto &r : b.records)
+      append(r.first, r.second.data(), r.second.size());
+    full = pending->data.size() >= group_commit_bytes;
+  }
+
+  if (full) commit(false);
+}
+
+inline void storage_native::flush()
+{
+  if (fd >= 0) commit(true);
+}
+
+inline void storage_native::commit(bool force)
+{
+  // the first writer to arrive commits the records of all writers
+  // buffered so far; others append to a new buffer in the meantime
+  std::lock_guard<std::mutex> commit_guard(commit_mutex);
+
+  std::shared_ptr<buffer> b;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    if (pending->data.empty() || (!force && pending->data.size() < group_commit_bytes))
+      return; // committed by another writer
+    b = pending;
+    inflight = b;
+    pending = std::make_shared<buffer>();
+    pending->base = b->base + b->data.size();
+  }
+
+  size_t done = 0;
+  while (done < b->data.size()) {
+    const ssize_t m = pwrite(fd, b->data.data() + done, b->data.size() - done, b->base + done);
+    if (m < 0 && errno == EINTR) continue;
+    if (m <= 0) {
+      fprintf(stderr, "[FTK] fatal error: cannot write storage log in %s.\n", dir.c_str());
+      assert(false);
+      break;
+    }
+    done += m;
+  }
+  if (sync) fsync(fd);
+
+  std::lock_guard<std::mutex> guard(mutex);
+  committed_size = b->base + b->data.size();
+  inflight.reset();
+}
+
+inline std::string storage_native::get(const std::string& key)
+{
+  std::string val;
+  location l;
+  {
+    std::lock_guard<std::mutex> guard(mutex);
+    const auto it = index.find(key);
+    if (it == index.end()) return val;
+    l = it->second;
+
+    if (l.offset >= committed_size) { // not yet in the file
+      const std::shared_ptr<buffer> &b = (inflight && l.offset < inflight->base + inflight->data.size()) ? inflight : pending;
+      return b->data.substr(l.offset - b->base, l.size);
+    }
+  }
+
+  val.resize(l.size);
+  size_t done = 0;
+  while (done < l.size) {
+    const ssize_t m = pread(fd, &val[done], l.size - done, l.offset + done);
+    if (m < 0 && errno == EINTR) continue;
+    if (m <= 0) {
+      fprintf(stderr, "[FTK] error: cannot read storage log in %s.\n", dir.c_str());
+      return std::string();
+    }
+    done += m;
+  }
+  return val;
+}
+
+inline bool storage_native::has(const std::string& key)
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  return index.find(key) != index.end();
+}
+
+inline size_t storage_native::size()
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  return index.size();
+}
 
 }
 
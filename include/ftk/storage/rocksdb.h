@@ -3,6 +3,7 @@
 
 #include "ftk/storage/base.h"
 #include <rocksdb/db.h>
+#include <rocksdb/write_batch.h>
 
 namespace ftk {
 
@@ -28,7 +29,14 @@ public:
   }
 
   void put(const std::string& key, const std::string& val) {
-    _db->Put(rocksdb::WriteOptions(), key, val);
+    _db->Put(write_options(), key, val);
+  }
+
+  void write(const batch& b) { // one atomic write
+    rocksdb::WriteBatch wb;
+    for (const auto &r : b.records)
+      wb.Put(r.first, r.second);
+    _db->Write(write_options(), &wb);
   }
 
   std::string get(const std::string& key) {
@@ -37,6 +45,22 @@ public:
     return val;
   }
 
+  std::vector<std::string> multi_get(const std::vector<std::string>& keys) {
+    const std::vector<rocksdb::Slice> slices(keys.begin(), keys.end());
+    std::vector<std::string> vals;
+    const auto status = _db->MultiGet(rocksdb::ReadOptions(), slices, &vals);
+    for (size_t i = 0; i < keys.size(); i ++)
+      if (!status[i].ok()) vals[i].clear();
+    return vals;
+  }
+
+private:
+  rocksdb::WriteOptions write_options() const {
+    rocksdb::WriteOptions options;
+    options.sync = sync;
+    return options;
+  }
+
 private:
   rocksdb::DB *_db;
   bool _external_db = false;
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <set>
+#include <map>
 #include <ftk/external/json.hh>
 
 namespace ftk {
@@ -17,10 +18,25 @@ enum {
   FTK_EVENT_COMPOUND = 6
 };
 
-template <class IdType, class LabelType>
+template <class IdType, class LabelType, class WeightType=int>
 struct Event {
   std::pair<IdType, IdType> interval;
   std::set<LabelType> lhs, rhs; // local ids on left and right hand sides
+  std::map<std::pair<LabelType, LabelType>, WeightType> weights; // of edges from lhs to rhs, e.g. overlap sizes
+
+  WeightType lhs_weight(LabelType l) const { // total weight of the edges of a lhs label
+    WeightType w(0);
+    for (const auto &kv : weights)
+      if (kv.first.first == l) w += kv.second;
+    return w;
+  }
+
+  WeightType rhs_weight(LabelType l) const { // ... of a rhs label
+    WeightType w(0);
+    for (const auto &kv : weights)
+      if (kv.first.second == l) w += kv.second;
+    return w;
+  }
 
   int type() const {
     if (lhs.size() == 1 && rhs.size() == 1) { // no event
@@ -51,16 +67,18 @@ struct Event {
 
 // json
 namespace nlohmann {
-  template <class IdType, class LabelType>
-  struct adl_serializer<ftk::Event<IdType, LabelType> > {
-    static void to_json(json& j, const ftk::Event<IdType, LabelType> &e) {
+  template <class IdType, class LabelType, class WeightType>
+  struct adl_serializer<ftk::Event<IdType, LabelType, WeightType> > {
+    static void to_json(json& j, const ftk::Event<IdType, LabelType, WeightType> &e) {
       j["interval"] = e.interval;
-      j["type"] = ftk::Event<IdType, LabelType>::eventTypeToString(e.type());
+      j["type"] = ftk::Event<IdType, LabelType, WeightType>::eventTypeToString(e.type());
       j["lhs"] = e.lhs;
       j["rhs"] = e.rhs;
+      for (const auto &kv : e.weights)
+        j["weights"].push_back({kv.first.first, kv.first.second, kv.second});
     }
 
-    static void from_json(const json& j, ftk::Event<IdType, LabelType> &e) {
+    static void from_json(const json& j, ftk::Event<IdType, LabelType, WeightType> &e) {
       // TODO
     }
   };
@@ -9,6 +9,7 @@
 #include <functional>
 #include <fstream>
 #include <ftk/algorithms/cca.hh>
+#include <ftk/algorithms/component_attributes.hh>
 #include <ftk/tracking_graph/event.hh>
 
 namespace ftk {
@@ -27,9 +28,16 @@ public:
   bool has_edge(TimeIndexType t0, LabelIdType l0, TimeIndexType t1, LabelIdType l1) const;
   
   void add_node(TimeIndexType t, LabelIdType l);
-  void add_edge(TimeIndexType t0, LabelIdType l0, TimeIndexType t1, LabelIdType l1);
+  void add_edge(TimeIndexType t0, LabelIdType l0, TimeIndexType t1, LabelIdType l1, WeightType w = WeightType(1)); // weights of an edge added multiple times accumulate
 
-  const std::map<TimeIndexType, std::vector<Event<TimeIndexType, LabelIdType> > > &get_events() const {return events;}
+  WeightType get_edge_weight(TimeIndexType t0, LabelIdType l0, TimeIndexType t1, LabelIdType l1) const; // 0 if no edge
+
+  // feature attributes of nodes, e.g. computed by labeling
+  void set_node_attributes(TimeIndexType t, LabelIdType l, const component_attributes& a);
+  bool has_node_attributes(TimeIndexType t, LabelIdType l) const;
+  component_attributes get_node_attributes(TimeIndexType t, LabelIdType l) const; // empty if none
+
+  const std::map<TimeIndexType, std::vector<Event<TimeIndexType, LabelIdType, WeightType> > > &get_events() const {return events;}
 
   void detect_events();
   void detect_events(TimeIndexType t0, TimeIndexType t1);
@@ -43,11 +51,13 @@ private:
   
   std::map<TimeIndexType, std::set<Node> > nodes;
   std::map<Node, std::set<Node> > left_links, right_links;
+  std::map<std::pair<Node, Node>, WeightType> weights; // of edges from left to right
+  std::map<Node, component_attributes> attributes;
 
   std::map<Node, GlobalLabelIdType> nodeToGlobalLabelMap;
   std::map<GlobalLabelIdType, std::set<Node> > globalLabelToNodeMap;
 
-  std::map<TimeIndexType, std::vector<Event<TimeIndexType, LabelIdType> > > events;
+  std::map<TimeIndexType, std::vector<Event<TimeIndexType, LabelIdType, WeightType> > > events;
 
 private: // counters for global label
   std::function<void()> resetGlobalLabelCallback;
@@ -105,7 +115,7 @@ bool tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::
   auto it = right_links.find(std::make_pair(t0, l0)); 
   if (it == right_links.end()) 
     return false;
-  else if (it->find(std::make_pair(t1, l1)) == it->end())
+  else if (it->second.find(std::make_pair(t1, l1)) == it->second.end())
     return false;
   else return true;
 }
@@ -118,7 +128,7 @@ void tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::
 }
   
 template <class TimeIndexType, class LabelIdType, class GlobalLabelIdType, class WeightType>
-void tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::add_edge(TimeIndexType t0, LabelIdType l0, TimeIndexType t1, LabelIdType l1) 
+void tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::add_edge(TimeIndexType t0, LabelIdType l0, TimeIndexType t1, LabelIdType l1, WeightType w) 
 {
   std::unique_lock<std::mutex> lock(mutex);
 
@@ -130,8 +140,42 @@ void tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::
 
   left_links[n1].insert(n0);
   right_links[n0].insert(n1);
+  weights[std::make_pair(n0, n1)] += w;
+}
+
+template <class TimeIndexType, class LabelIdType, class GlobalLabelIdType, class WeightType>
+WeightType tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::get_edge_weight(TimeIndexType t0, LabelIdType l0, TimeIndexType t1, LabelIdType l1) const 
+{
+  std::unique_lock<std::mutex> lock(mutex);
+
+  auto it = weights.find(std::make_pair(std::make_pair(t0, l0), std::make_pair(t1, l1)));
+  if (it == weights.end()) return WeightType(0);
+  else return it->second;
 }
   
+template <class TimeIndexType, class LabelIdType, class GlobalLabelIdType, class WeightType>
+void tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::set_node_attributes(TimeIndexType t, LabelIdType l, const component_attributes& a) 
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  attributes[std::make_pair(t, l)] = a;
+}
+
+template <class TimeIndexType, class LabelIdType, class GlobalLabelIdType, class WeightType>
+bool tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::has_node_attributes(TimeIndexType t, LabelIdType l) const 
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  return attributes.find(std::make_pair(t, l)) != attributes.end();
+}
+
+template <class TimeIndexType, class LabelIdType, class GlobalLabelIdType, class WeightType>
+component_attributes tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::get_node_attributes(TimeIndexType t, LabelIdType l) const 
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  auto it = attributes.find(std::make_pair(t, l));
+  if (it == attributes.end()) return component_attributes();
+  else return it->second;
+}
+
 template <class TimeIndexType, class LabelIdType, class GlobalLabelIdType, class WeightType>
 void tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::relabel()
 {
@@ -191,10 +235,14 @@ void tracking_graph<TimeIndexType, LabelIdType, GlobalLabelIdType, WeightType>::
   // fprintf(stderr, "====%zu\n", components.size());
   for (auto component : components) {
     if (component.size() != 2) {
-      Event<TimeIndexType, LabelIdType> e;
+      Event<TimeIndexType, LabelIdType, WeightType> e;
       e.interval = std::make_pair(t0, t1);
       for (auto n : component) {
-        if (n.first == t0) e.lhs.insert(n.second);
+        if (n.first == t0) {
+          e.lhs.insert(n.second);
+          for (const auto &r : right_links[n])
+            e.weights[std::make_pair(n.second, r.second)] = weights[std::make_pair(n, r)];
+        }
         else e.rhs.insert(n.second);
       }
       events[t0].push_back(e);
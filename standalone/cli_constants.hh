@@ -21,6 +21,7 @@ static const std::string
 static const std::string
         str_ext_vti(".vti"), // vtkImageData
         str_ext_vtp(".vtp"), // vtkPolyData
+        str_ext_pvtp(".pvtp"), // pieces of vtkPolyData written in parallel
         str_ext_netcdf(".nc"),
         str_ext_hdf5(".h5");
 
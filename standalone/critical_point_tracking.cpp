@@ -1,6 +1,7 @@
 #include <fstream>
 #include <mutex>
 #include <set>
+#include <stdexcept>
 #include <cassert>
 #include "ftk/external/cxxopts.hpp"
 #include "ftk/ndarray/synthetic.hh"
@@ -8,6 +9,8 @@
 #include "ftk/filters/critical_point_tracker_3d_regular.hh"
 #include "ftk/ndarray.hh"
 #include "ftk/ndarray/conv.hh"
+#include "ftk/io/data_stream.hh"
+#include "ftk/io/netcdf_time_series.hh"
 #include "cli_constants.hh"
 
 #if FTK_HAVE_VTK
@@ -36,7 +39,9 @@ std::string accelerator;
 std::string type_filter_str;
 size_t DW = 0, DH = 0, DD = 0, DT = 0;
 int nthreads = std::thread::hardware_concurrency();
+int nreaders = 2; // threads decoding timesteps ahead of the tracker
 bool verbose = false, demo = false, show_vtk = false, help = false;
+bool compress_output = false;
 bool use_type_filter = false;
 unsigned int type_filter = 0;
 double smoothing_kernel = 0.0;
@@ -58,47 +63,95 @@ size_t dimlens[4] = {0}; // Only for netcdf
 // tracker
 ftk::critical_point_tracker_regular* tracker = NULL;
 
+#if FTK_HAVE_NETCDF
+ftk::netcdf_time_series* nc_series = NULL; // timesteps of all netcdf files
+#endif
+
 // constants
 static const std::set<std::string> set_valid_output_format({str_auto, str_text, str_vtp});
 
 
 ///////////////////////////////
-ftk::ndarray<double> request_timestep(int k) // requesting k-th timestep
+// with components as the first dimension if nv > 1
+static std::vector<size_t> with_components(const std::vector<size_t>& dims)
 {
   std::vector<size_t> shape;
-  if (nd == 2) {
-    if (nv == 1) shape = std::vector<size_t>({DW, DH});
-    else shape = std::vector<size_t>({size_t(nv), DW, DH});
-  } else {
-    if (nv == 1) shape = std::vector<size_t>({DW, DH, DD});
-    else shape = std::vector<size_t>({size_t(nv), DW, DH, DD});
+  if (nv > 1) shape.push_back(nv);
+  shape.insert(shape.end(), dims.begin(), dims.end());
+  return shape;
+}
+
+static ftk::lattice with_components(const ftk::lattice& l)
+{
+  if (nv == 1) return l;
+  std::vector<size_t> starts(1, 0), sizes(1, nv);
+  starts.insert(starts.end(), l.starts().begin(), l.starts().end());
+  sizes.insert(sizes.end(), l.sizes().begin(), l.sizes().end());
+  return ftk::lattice(starts, sizes);
+}
+
+// interleaves separately stored components
+static ftk::ndarray<double> interleave(const ftk::ndarray<double>& u, const ftk::ndarray<double>& v, const ftk::ndarray<double>& w)
+{
+  ftk::ndarray<double> array;
+  array.reshape(with_components(u.shape()));
+  for (auto i = 0; i < u.nelem(); i ++) {
+    array[i*nv] = u[i];
+    array[i*nv+1] = v[i];
+    if (nv > 2) array[i*nv+2] = w[i];
   }
+  return array;
+}
+
+// the file of timestep k and the time index within it; throws
+// std::out_of_range for timesteps beyond the inputs
+static std::pair<std::string, size_t> locate_timestep(int k)
+{
+#if FTK_HAVE_NETCDF
+  if (input_format == str_netcdf) { // netcdf files may contain multiple timesteps
+    const auto &loc = nc_series->locate(k);
+    return std::make_pair(input_filenames[loc.first], loc.second);
+  }
+#endif
+  // other formats hold one timestep per file
+  if (k < 0 || size_t(k) >= input_filenames.size())
+    throw std::out_of_range("[FTK] timestep " + std::to_string(k) + 
+        " out of range, " + std::to_string(input_filenames.size()) + " input files in total");
+  return std::make_pair(input_filenames[k], size_t(0));
+}
+
+// requesting the local array domain (the ghost-extended extent of this 
+// rank) of the k-th timestep; called by reader threads
+ftk::ndarray<double> request_timestep(int k) 
+{
+  const ftk::lattice &ext = tracker->get_local_array_domain();
+  std::vector<size_t> dims({DW, DH});
+  if (nd == 3) dims.push_back(DD);
+  const std::vector<size_t> shape = with_components(dims);
 
   if (demo) {
     if (nd == 2) {
       const double t = DT == 1 ? 0.0 : double(k)/(DT-1);
-      return ftk::synthetic_woven_2D<double>(DW, DH, t);
+      return ftk::synthetic_woven_2D_part<double>(ftk::lattice({DW, DH}), ext, t);
     } else { // nd == 3
       fprintf(stderr, "3D demo case not available.\n");
       assert(false); // TODO: create a 3D demo case
       return ftk::ndarray<double>();
     } 
   } else {
-    const std::string filename = input_filenames[k];
+    const std::string filename = locate_timestep(k).first;
 
-    if (input_format == str_float32) {
-      ftk::ndarray<float> array32(shape);
-      array32.from_binary_file(filename);
-      
-      ftk::ndarray<double> array(shape);
-      array.from_array(array32);
-
-      return array;
-    } else if (input_format == str_float64) {
-      ftk::ndarray<double> array(shape);
-      array.from_binary_file(filename);
-      return array;
-    } else if (input_format == str_vti) {
+    if (input_format == str_float32 || input_format == str_float64) { // one pread per contiguous run
+      if (input_format == str_float32) {
+        ftk::ndarray<float> array;
+        array.from_binary_file(filename, shape, with_components(ext));
+        return ftk::ndarray<double>(array.view());
+      } else {
+        ftk::ndarray<double> array;
+        array.from_binary_file(filename, shape, with_components(ext));
+        return array;
+      }
+    } else if (input_format == str_vti) { // vti files are read entirely
       ftk::ndarray<double> array;
 
       if (input_variable_name.size() > 0) { // all data in one single variable; channels are automatically handled in ndarray
@@ -109,42 +162,53 @@ ftk::ndarray<double> request_timestep(int k) // requesting k-th timestep
         v.from_vtk_image_data_file(filename, input_variable_name_v);
         if (nv > 2)
           w.from_vtk_image_data_file(filename, input_variable_name_w);
-
-        array.reshape(shape);
-        for (auto i = 0; i < u.nelem(); i ++) {
-          array[i*nv] = u[i];
-          array[i*nv+1] = v[i];
-          if (nv > 2) array[i*nv+2] = w[i];
-        }
+        array = interleave(u, v, w);
       }
 
-      return array;
+      array.reshape(shape);
+      if (ext.sizes() == dims) return array;
+      else return array.slice(with_components(ext));
     } else if (input_format == str_netcdf) {
+#if FTK_HAVE_NETCDF
+      std::lock_guard<std::mutex> guard(ftk::data_stream::library_mutex()); // netcdf is not thread-safe
       ftk::ndarray<double> array;
 
-      if (input_variable_name.size() > 0) { // all data in one single variable; channels are automatically handled in ndarray
-        array.from_netcdf(filename, input_variable_name);
+      if (input_variable_name.size() > 0) { // all data in one single variable
+        nc_series->read(k, 0, array, &ext);
       } else { // u, v, w in separate variables
         ftk::ndarray<double> u, v, w;
-        u.from_netcdf(filename, input_variable_name_u);
-        v.from_netcdf(filename, input_variable_name_v);
+        nc_series->read(k, 0, u, &ext);
+        nc_series->read(k, 1, v, &ext);
         if (nv > 2)
-          w.from_netcdf(filename, input_variable_name_w);
-
-        array.reshape(shape);
-        for (auto i = 0; i < u.nelem(); i ++) {
-          array[i*nv] = u[i];
-          array[i*nv+1] = v[i];
-          if (nv > 2) array[i*nv+2] = w[i];
-        }
+          nc_series->read(k, 2, w, &ext);
+        array = interleave(u, v, w);
       }
 
-      array.reshape(shape); // ncdims may not be equal to nd
+      array.reshape(with_components(ext.sizes()));
       return array;
+#else
+      assert(false);
+      return ftk::ndarray<double>();
+#endif
     } else if (input_format == str_hdf5) {
-      // TODO
+#if FTK_HAVE_HDF5
+      std::lock_guard<std::mutex> guard(ftk::data_stream::library_mutex()); // hdf5 is not thread-safe
+      ftk::ndarray<double> array;
+      if (input_variable_name.size() > 0) { // hyperslab of a single variable
+        array.from_h5(filename, input_variable_name, with_components(ext));
+      } else {
+        ftk::ndarray<double> u, v, w;
+        u.from_h5(filename, input_variable_name_u, ext);
+        v.from_h5(filename, input_variable_name_v, ext);
+        if (nv > 2)
+          w.from_h5(filename, input_variable_name_w, ext);
+        array = interleave(u, v, w);
+      }
+      return array;
+#else
       assert(false);
       return ftk::ndarray<double>();
+#endif
     } else {
       assert(false);
       return ftk::ndarray<double>();
@@ -181,10 +245,14 @@ int parse_arguments(int argc, char **argv)
      cxxopts::value<std::string>(output_filename))
     ("type-filter", "Type filter: ane single or a combination of critical point types, e.g. `min', `max', `saddle', `min|max'",
      cxxopts::value<std::string>(type_filter_str))
-    ("r,output-format", "Output format (auto|text|vtp)", 
+    ("r,output-format", "Output format (auto|text|vtp); vtp outputs ending with .pvtp are written in pieces by each process", 
      cxxopts::value<std::string>(output_format)->default_value(str_auto))
+    ("compress", "Compress vtp outputs with zlib",
+     cxxopts::value<bool>(compress_output))
     ("nthreads", "Number of threads", 
      cxxopts::value<int>(nthreads))
+    ("nreaders", "Number of threads reading timesteps ahead of tracking", 
+     cxxopts::value<int>(nreaders))
     ("a,accelerator", "Accelerator (none|cuda)",
      cxxopts::value<std::string>(accelerator)->default_value(str_none))
     ("smoothing-kernel", "Smoothing kernel size",
@@ -258,13 +326,8 @@ int parse_arguments(int argc, char **argv)
   }
 
   if (output_format == str_auto) {
-    if (ends_with(output_filename, str_ext_vtp)) {
-#if FTK_HAVE_VTK
-      output_format = str_vtp;
-#else
-      fatal("FTK not compiled with VTK.");
-#endif
-    }
+    if (ends_with(output_filename, str_ext_vtp) || ends_with(output_filename, str_ext_pvtp))
+      output_format = str_vtp; // written without vtk
     else 
       output_format = str_text;
   }
@@ -335,21 +398,21 @@ int parse_arguments(int argc, char **argv)
       // determine nv
       if (nv == 0) // auto
         fatal("Unable to determine the number of variables"); // TOOD: determine nv by file size
-    } else if (input_format == str_vti) {
-#if FTK_HAVE_VTK
-      vtkSmartPointer<vtkXMLImageDataReader> reader = vtkSmartPointer<vtkXMLImageDataReader>::New();
-      reader->SetFileName(input_filenames[0].c_str());
-      reader->Update();
 
-      vtkSmartPointer<vtkImageData> image = reader->GetOutput();
+      // determine DT
+      if (DT == 0) DT = input_filenames.size();
+      else DT = std::min(DT, input_filenames.size());
+    } else if (input_format == str_vti) { // parsed natively; vtk is not needed
+      ftk::mapped_file file(input_filenames[0], ftk::FTK_ACCESS_RANDOM);
+      ftk::vti_header h;
+      if (!file.good() || !h.parse(file.data(), file.size()))
+        fatal("Unable to read VTI file.");
 
       // determine dimensionality
-      int imageNd = image->GetDataDimension();
-      if (input_dimension == str_auto) {
+      const int imageNd = h.extent[5] > h.extent[4] ? 3 : 2;
+      if (input_dimension == str_auto) 
         nd = imageNd;
-        if (!(nd == 2 || nd == 3))
-          fatal("Unsupported VTI data dimensionality.");
-      } else {
+      else {
         if (nd != imageNd)
           fatal("Data dimensionality and given dimensionality mismatch.");
       }
@@ -358,36 +421,37 @@ int parse_arguments(int argc, char **argv)
       if (DW || DH || DD)
         warn("Given data dimensions are ignored.");
 
-      DW = image->GetDimensions()[0];
-      DH = image->GetDimensions()[1];
+      DW = h.extent[1] - h.extent[0] + 1;
+      DH = h.extent[3] - h.extent[2] + 1;
       if (nd == 3)
-        DD = image->GetDimensions()[2];
+        DD = h.extent[5] - h.extent[4] + 1;
 
       // determine variable names and array indices
+      auto find_array = [&](const std::string& name, int &id) {
+        const auto *a = h.find(name);
+        if (!a) fatal("Cannot find variable " + name + " in VTI.");
+        id = a - h.point_arrays.data();
+        return a;
+      };
       if (input_variable_name.size() == 0) {
         if (input_variable_name_u.size() == 0) { // data from single unamed variable
+          if (h.point_arrays.empty()) fatal("No arrays in VTI.");
           varid = 0;
-          input_variable_name = image->GetPointData()->GetArrayName(varid);
-          // fprintf(stderr, "Using input variable: %s\n", input_variable_name.c_str());
+          input_variable_name = h.point_arrays[varid].name;
         } else { // data from multiple named variables
-          // nv = nd;
-          image->GetPointData()->GetArray(input_variable_name_u.c_str(), varid_u);
-          if (varid_u < 0) fatal("Cannot find variable name for u.");
-          image->GetPointData()->GetArray(input_variable_name_v.c_str(), varid_v);
-          if (varid_v < 0) fatal("Cannot find variable name for v.");
-          if (nd == 3) {
-            image->GetPointData()->GetArray(input_variable_name_w.c_str(), varid_w);
-            if (varid_w < 0) fatal("Cannot find variable name for w.");
-          }
+          find_array(input_variable_name_u, varid_u);
+          find_array(input_variable_name_v, varid_v);
+          if (nd == 3)
+            find_array(input_variable_name_w, varid_w);
         }
       } else { // data from single named variable
-        image->GetPointData()->GetArray(input_variable_name.c_str(), varid);
+        find_array(input_variable_name, varid);
       }
 
       // determine nv
       if (nv == 0) {
         if (varid >= 0) 
-          nv = image->GetPointData()->GetArray(varid)->GetNumberOfComponents();
+          nv = h.point_arrays[varid].ncomponents;
         else 
           nv = nd; // TODO: make sure each of u,v,w has single component.
         // TODO: sanity check
@@ -397,9 +461,6 @@ int parse_arguments(int argc, char **argv)
       // determine DT
       if (DT == 0) DT = input_filenames.size();
       else DT = std::min(DT, input_filenames.size());
-#else
-      fatal("FTK not compiled with VTK.");
-#endif
     } else if (input_format == str_netcdf) {
 #if FTK_HAVE_NETCDF
       if (input_variable_name.size() +
@@ -439,9 +500,9 @@ int parse_arguments(int argc, char **argv)
           fatal("Unsupported NetCDF data dimensionality.");
       } else if (nd == ncdims) { // netcdf dimensions are spatial only
       } else if (nd == ncdims - 1) { // netcdf file has time dimension
-        // NOTE: we assume the time dimension is NC_UNLIMITED, and each
-        //       NetCDF contains only one time step.  Will remove this 
-        //       limitation in future versions.
+        // NOTE: we assume the time dimension is the first (usually 
+        //       NC_UNLIMITED) dimension; each file may contain any
+        //       number of timesteps.
       } else {
         fprintf(stderr, "nd=%d, ncdims=%d\n", nd, ncdims);
         fatal("Unsupported NetCDF variable dimensionality.");
@@ -473,13 +534,69 @@ int parse_arguments(int argc, char **argv)
         DH = dimlens[0];
       } else fatal("Unsupported NetCDF variable dimensionality");
       
+      NC_SAFE_CALL( nc_close(ncid) );
+
+      std::vector<std::string> varnames;
+      if (input_variable_name.size() > 0) varnames.push_back(input_variable_name);
+      else {
+        varnames.push_back(input_variable_name_u);
+        varnames.push_back(input_variable_name_v);
+        if (nv > 2) varnames.push_back(input_variable_name_w);
+      }
+      nc_series = new ftk::netcdf_time_series(input_filenames, varnames, nd == ncdims - 1);
+
+      // determine DT
+      if (DT == 0) DT = nc_series->n_timesteps();
+      else DT = std::min(DT, nc_series->n_timesteps());
+#else
+      fatal("FTK not compiled with NetCDF.");
+#endif
+    } else if (input_format == str_hdf5) {
+#if FTK_HAVE_HDF5
+      if (input_variable_name.size() + input_variable_name_u.size() == 0)
+        fatal("Variable name missing for HDF5 files.");
+      const std::string my_varname = input_variable_name.size() ? input_variable_name : input_variable_name_u;
+
+      auto fid = H5Fopen(input_filenames[0].c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+      if (fid < 0) fatal("Cannot open HDF5 file.");
+      auto did = H5Dopen2(fid, my_varname.c_str(), H5P_DEFAULT);
+      if (did < 0) fatal("Cannot find HDF5 dataset.");
+      auto sid = H5Dget_space(did);
+      const int h5ndims = H5Sget_simple_extent_ndims(sid);
+      hsize_t h5dims[4] = {0};
+      if (h5ndims < 2 || h5ndims > 4) fatal("Unsupported HDF5 data dimensionality.");
+      H5Sget_simple_extent_dims(sid, h5dims, NULL);
+      H5Sclose(sid);
+      H5Dclose(did);
+      H5Fclose(fid);
+
+      // the last hdf5 dimension varies fastest
+      std::vector<size_t> dims;
+      for (int i = h5ndims - 1; i >= 0; i --)
+        dims.push_back(h5dims[i]);
+
+      if (input_variable_name.size() > 0) { // single variable, components (if any) vary fastest
+        if (nd == 0) nd = h5ndims;
+        if (h5ndims == nd) nv = 1;
+        else if (h5ndims == nd + 1) {
+          nv = dims[0];
+          dims.erase(dims.begin());
+        } else fatal("Unsupported HDF5 variable dimensionality.");
+      } else {
+        nd = h5ndims;
+        nv = input_variable_name_w.size() ? 3 : 2;
+      }
+      if (nd != 2 && nd != 3) fatal("Unsupported HDF5 data dimensionality.");
+
+      DW = dims[0];
+      DH = dims[1];
+      DD = nd == 3 ? dims[2] : 0;
+
       // determine DT
       if (DT == 0) DT = input_filenames.size();
       else DT = std::min(DT, input_filenames.size());
-
-      NC_SAFE_CALL( nc_close(ncid) );
 #else
-      fatal("FTK not compiled with NetCDF.");
+      fatal("FTK not compiled with HDF5.");
 #endif
     }
   } 
@@ -506,6 +623,7 @@ int parse_arguments(int argc, char **argv)
   fprintf(stderr, "DT=%zu\n", DT);
   fprintf(stderr, "type_filter=%s\n", type_filter_str.c_str());
   fprintf(stderr, "nthreads=%d\n", nthreads);
+  fprintf(stderr, "nreaders=%d\n", nreaders);
   fprintf(stderr, "=============\n");
 
   assert(nd == 2 || nd == 3);
@@ -527,7 +645,9 @@ void track_critical_points()
   
   tracker->set_number_of_threads(nthreads);
       
-  tracker->set_input_array_partial(false); // input data are not distributed
+  // each rank reads only its local array domain, unless the input is 
+  // smoothed, which needs the neighborhood of the whole array
+  tracker->set_input_array_partial(smoothing_kernel == 0);
 
   if (use_type_filter)
     tracker->set_type_filter(type_filter);
@@ -553,39 +673,39 @@ void track_critical_points()
   }
   tracker->initialize();
 
-  int current_timestep = 0;
-  while (1) {
-    ftk::ndarray<double> field_data = request_timestep(current_timestep);
-    if (nv == 1) { // scalar field
-      if (smoothing_kernel) {
-        ftk::ndarray<double> scalar = 
-          ftk::conv2D_gaussian(field_data, smoothing_kernel, 5, 5, 2);
-        tracker->push_scalar_field_snapshot(scalar);
-      } else 
-        tracker->push_scalar_field_snapshot(field_data);
-    }
-    else // vector field
-      tracker->push_vector_field_snapshot(field_data);
-     
-    if (current_timestep == DT - 1) {
-      tracker->update_timestep();
-      break;
-    }
-    else if (current_timestep != 0) // need to push two timestep before one can advance timestep
-      tracker->advance_timestep();
-    current_timestep ++;
+  // timesteps are decoded and smoothed by the reader threads ahead of tracking
+  ftk::data_stream stream;
+  stream.set_number_of_timesteps(DT);
+  stream.set_number_of_threads(nreaders);
+  stream.set_reader([](int k, ftk::data_group& g) {
+    ftk::ndarray<double> field_data = request_timestep(k);
+    if (nv == 1 && smoothing_kernel)
+      field_data = ftk::conv2D_gaussian(field_data, smoothing_kernel, 5, 5, 2);
+    g.set("field", std::move(field_data));
+  });
+  stream.initialize();
+
+  try {
+    tracker->consume(stream, "field");
+  } catch (const std::exception& e) { // rethrown from the reader threads
+    fprintf(stderr, "%s\n", e.what());
+    exit(1);
   }
+  stream.finalize();
+#if FTK_HAVE_NETCDF
+  delete nc_series;
+#endif
 
   tracker->finalize();
   // delete tracker;
 }
 
-void write_outputs()
+void write_outputs() // collective
 {
   if (output_filename.empty()) return;
 
   if (output_format == str_vtp) 
-    tracker->write_traced_critical_points_vtk(output_filename);
+    tracker->write_traced_critical_points_vtp(output_filename, compress_output);
   else if (output_format == str_text) 
     tracker->write_traced_critical_points_text(output_filename);
 }
@@ -634,12 +754,15 @@ void start_vtk_window()
 
 int main(int argc, char **argv)
 {
+  diy::mpi::environment env(argc, argv);
+  diy::mpi::communicator world;
+
   parse_arguments(argc, argv);
   track_critical_points();
-    
+   
   write_outputs();
-  
-  if (show_vtk) 
+
+  if (world.rank() == 0 && show_vtk) // results are gathered to the root
     start_vtk_window();
 
   delete tracker;
@@ -1,6 +1,7 @@
 #include <fstream>
 #include <mutex>
 #include <set>
+#include <stdexcept>
 #include <cassert>
 #include <iostream>
 #include <ftk/external/cxxopts.hpp>
@@ -9,6 +10,7 @@
 #include <ftk/filters/connected_component_tracker.hh>
 #include <ftk/ndarray.hh>
 #include <ftk/io/data_stream.hh>
+#include <ftk/io/netcdf_time_series.hh>
 #include <ftk/algorithms/hoshen_kopelman.hh>
 #include <ftk/tracking_graph/tracking_graph.hh>
 #include "cli_constants.hh"
@@ -24,6 +26,7 @@ std::vector<std::string> input_filenames; // assuming each file contains only on
 std::string accelerator;
 size_t DW = 0, DH = 0, DD = 0, DT = 0;
 int nthreads = std::thread::hardware_concurrency();
+int nreaders = 2; // threads decoding timesteps ahead of the tracker
 bool verbose = false, demo = false, show_vtk = false, help = false;
 
 // determined later
@@ -40,48 +43,83 @@ double threshold = 0.0;
 // constants
 static const std::set<std::string> set_valid_output_format({str_auto, str_text, str_vti});
 
-// tracker
-ftk::levelset_tracker<> tracker;
+#if FTK_HAVE_NETCDF
+ftk::netcdf_time_series* nc_series = NULL; // timesteps of all netcdf files
+#endif
+
+ftk::levelset_tracker<>* tracker = NULL;
 
-ftk::ndarray<double> request_timestep(int k) // requesting k-th timestep
+// the file of timestep k and the time index within it; throws
+// std::out_of_range for timesteps beyond the inputs
+static std::pair<std::string, size_t> locate_timestep(int k)
+{
+#if FTK_HAVE_NETCDF
+  if (input_format == str_netcdf) { // netcdf files may contain multiple timesteps
+    const auto &loc = nc_series->locate(k);
+    return std::make_pair(input_filenames[loc.first], loc.second);
+  }
+#endif
+  // other formats hold one timestep per file
+  if (k < 0 || size_t(k) >= input_filenames.size())
+    throw std::out_of_range("[FTK] timestep " + std::to_string(k) + 
+        " out of range, " + std::to_string(input_filenames.size()) + " input files in total");
+  return std::make_pair(input_filenames[k], size_t(0));
+}
+
+// requesting the local array domain (the core and one ghost layer of this
+// rank) of the k-th timestep; called by reader threads
+ftk::ndarray<double> request_timestep(int k)
 {
   std::vector<size_t> shape;
   if (nd == 2) shape = std::vector<size_t>({DW, DH});
   else shape = std::vector<size_t>({DW, DH, DD});
+  const ftk::lattice &ext = tracker->get_local_array_domain();
 
   if (demo) {
     if (nd == 2) {
       const double t = DT == 1 ? 0.0 : double(k)/(DT-1) * 10;
-      return ftk::synthetic_merger_2D<double>(DW, DH, t);
+      return ftk::synthetic_merger_2D_part<double>(ftk::lattice(shape), ext, t);
     } else { // nd == 3
       fprintf(stderr, "3D demo case not available.\n");
       assert(false); // TODO: create a 3D demo case
       return ftk::ndarray<double>();
     } 
   } else {
-    const std::string filename = input_filenames[k];
-
-    if (input_format == str_float32) {
-      ftk::ndarray<float> array32(shape);
-      array32.from_binary_file(filename);
-      
-      ftk::ndarray<double> array(shape);
-      array.from_array(array32);
+    const std::string filename = locate_timestep(k).first;
 
-      return array;
-    } else if (input_format == str_float64) {
-      ftk::ndarray<double> array(shape);
-      array.from_binary_file(filename);
-      return array;
-    } else if (input_format == str_vti) {
+    if (input_format == str_float32 || input_format == str_float64) {
+      if (ext.sizes() == shape) { // the whole array is mapped
+        if (input_format == str_float32) 
+          return ftk::ndarray<double>( ftk::ndarray<float>::from_binary_file_mmap(filename, shape) );
+        else
+          return ftk::ndarray<double>( ftk::ndarray<double>::from_binary_file_mmap(filename, shape) );
+      } else { // one pread per contiguous run
+        if (input_format == str_float32) {
+          ftk::ndarray<float> array;
+          array.from_binary_file(filename, shape, ext);
+          return ftk::ndarray<double>(array.view());
+        } else {
+          ftk::ndarray<double> array;
+          array.from_binary_file(filename, shape, ext);
+          return array;
+        }
+      }
+    } else if (input_format == str_vti) { // vti files are read entirely
       ftk::ndarray<double> array;
       array.from_vtk_image_data_file(filename, input_variable_name);
-      return array;
+      if (ext.sizes() == shape) return array;
+      else return array.slice(ext);
     } else if (input_format == str_netcdf) {
+#if FTK_HAVE_NETCDF
+      std::lock_guard<std::mutex> guard(ftk::data_stream::library_mutex()); // netcdf is not thread-safe
       ftk::ndarray<double> array;
-      array.from_netcdf(filename, input_variable_name);
-      array.reshape(shape); // ncdims may not be equal to nd
+      nc_series->read(k, 0, array, &ext);
+      array.reshape(ext.sizes()); // ncdims may not be equal to nd
       return array;
+#else
+      assert(false);
+      return ftk::ndarray<double>();
+#endif
     } else if (input_format == str_hdf5) {
       // TODO
       assert(false);
@@ -120,6 +158,8 @@ int parse_arguments(int argc, char **argv)
      cxxopts::value<std::string>(output_filename_dot))
     ("nthreads", "Number of threads", 
      cxxopts::value<int>(nthreads))
+    ("nreaders", "Number of threads reading timesteps ahead of tracking", 
+     cxxopts::value<int>(nreaders))
     ("a,accelerator", "Accelerator (none|cuda)",
      cxxopts::value<std::string>(accelerator)->default_value(str_none))
     ("vtk", "Show visualization with vtk", 
@@ -236,21 +276,17 @@ int parse_arguments(int argc, char **argv)
       // ignore var names
       if (input_variable_name.size())
         warn("Ignoring variable names.");
-    } else if (input_format == str_vti) {
-#if FTK_HAVE_VTK
-      vtkSmartPointer<vtkXMLImageDataReader> reader = vtkSmartPointer<vtkXMLImageDataReader>::New();
-      reader->SetFileName(input_filenames[0].c_str());
-      reader->Update();
-
-      vtkSmartPointer<vtkImageData> image = reader->GetOutput();
+    } else if (input_format == str_vti) { // parsed natively; vtk is not needed
+      ftk::mapped_file file(input_filenames[0], ftk::FTK_ACCESS_RANDOM);
+      ftk::vti_header h;
+      if (!file.good() || !h.parse(file.data(), file.size()))
+        fatal("Unable to read VTI file.");
 
       // determine dimensionality
-      int imageNd = image->GetDataDimension();
-      if (input_dimension == str_auto) {
+      const int imageNd = h.extent[5] > h.extent[4] ? 3 : 2;
+      if (input_dimension == str_auto) 
         nd = imageNd;
-        if (!(nd == 2 || nd == 3))
-          fatal("Unsupported VTI data dimensionality.");
-      } else {
+      else {
         if (nd != imageNd)
           fatal("Data dimensionality and given dimensionality mismatch.");
       }
@@ -259,23 +295,22 @@ int parse_arguments(int argc, char **argv)
       if (DW || DH || DD)
         warn("Given data dimensions are ignored.");
 
-      DW = image->GetDimensions()[0];
-      DH = image->GetDimensions()[1];
+      DW = h.extent[1] - h.extent[0] + 1;
+      DH = h.extent[3] - h.extent[2] + 1;
       if (nd == 3)
-        DD = image->GetDimensions()[2];
+        DD = h.extent[5] - h.extent[4] + 1;
 
-      image->GetPointData()->GetArray(input_variable_name.c_str(), varid);
+      const auto *array = h.find(input_variable_name);
+      if (!array) 
+        fatal("Cannot find variable in VTI.");
+      varid = array - h.point_arrays.data();
 
-      const int nv = image->GetPointData()->GetArray(varid)->GetNumberOfComponents();
-      if (nv != 1)
+      if (array->ncomponents != 1)
         fatal("Number of components is not 1 in VTI.");
 
       // determine DT
       if (DT == 0) DT = input_filenames.size();
       else DT = std::min(DT, input_filenames.size());
-#else
-      fatal("FTK not compiled with VTK.");
-#endif
     } else if (input_format == str_netcdf) {
 #if FTK_HAVE_NETCDF
       if (input_variable_name.size() == 0)
@@ -297,9 +332,9 @@ int parse_arguments(int argc, char **argv)
           fatal("Unsupported NetCDF data dimensionality.");
       } else if (nd == ncdims) { // netcdf dimensions are spatial only
       } else if (nd == ncdims - 1) { // netcdf file has time dimension
-        // NOTE: we assume the time dimension is NC_UNLIMITED, and each
-        //       NetCDF contains only one time step.  Will remove this 
-        //       limitation in future versions.
+        // NOTE: we assume the time dimension is the first (usually 
+        //       NC_UNLIMITED) dimension; each file may contain any
+        //       number of timesteps.
       } else {
         fprintf(stderr, "nd=%d, ncdims=%d\n", nd, ncdims);
         fatal("Unsupported NetCDF variable dimensionality.");
@@ -331,11 +366,14 @@ int parse_arguments(int argc, char **argv)
         DH = dimlens[0];
       } else fatal("Unsupported NetCDF variable dimensionality");
       
-      // determine DT
-      if (DT == 0) DT = input_filenames.size();
-      else DT = std::min(DT, input_filenames.size());
-
       NC_SAFE_CALL( nc_close(ncid) );
+
+      nc_series = new ftk::netcdf_time_series(input_filenames, 
+          std::vector<std::string>({input_variable_name}), nd == ncdims - 1);
+
+      // determine DT
+      if (DT == 0) DT = nc_series->n_timesteps();
+      else DT = std::min(DT, nc_series->n_timesteps());
 #else
       fatal("FTK not compiled with NetCDF.");
 #endif
@@ -356,6 +394,7 @@ int parse_arguments(int argc, char **argv)
   fprintf(stderr, "DT=%zu\n", DT);
   fprintf(stderr, "threshold=%f\n", threshold);
   fprintf(stderr, "nthreads=%d\n", nthreads);
+  fprintf(stderr, "nreaders=%d\n", nreaders);
   fprintf(stderr, "=============\n");
 
   assert(nd == 2 || nd == 3);
@@ -366,24 +405,45 @@ int parse_arguments(int argc, char **argv)
 
 void track_levelset()
 {
-  auto *tracker = new ftk::levelset_tracker<>; // ftk::connected_component_tracker<>;
+  tracker = new ftk::levelset_tracker<>; // ftk::connected_component_tracker<>;
   tracker->set_threshold( threshold );
+  tracker->set_number_of_threads(nthreads);
+
+  // with multiple processes, each reads only its local array domain
+  if (nd == 2) tracker->set_domain(ftk::lattice({DW, DH}));
+  else tracker->set_domain(ftk::lattice({DW, DH, DD}));
+  tracker->set_input_array_partial(diy::mpi::communicator().size() > 1);
+  try {
+    tracker->initialize();
+  } catch (const std::exception& e) {
+    fprintf(stderr, "%s\n", e.what());
+    exit(1);
+  }
+
+  ftk::data_stream stream;
+  stream.set_number_of_timesteps(DT);
+  stream.set_number_of_threads(nreaders);
+  stream.set_reader([](int k, ftk::data_group& g) {g.set("field", request_timestep(k));});
+  stream.initialize();
 
-  for (int current_timestep = 0; current_timestep < DT; current_timestep ++) {
-    fprintf(stderr, "current_timestep=%d\n", current_timestep);
-    ftk::ndarray<double> field_data = request_timestep(current_timestep);
-    // ftk::ndarray<size_t> label_data = threshold_filter<size_t>(field_data);
-    // size_t nc = ftk::hoshen_kopelman_2d(label_data);
-    // tracker->push_labeled_data_snapshot(label_data.std_vector());
-    
-    tracker->push_scalar_field_data_snapshot(field_data);
-    tracker->advance_timestep();
+  try {
+    tracker->consume(stream, "field");
+  } catch (const std::exception& e) { // rethrown from the reader threads
+    fprintf(stderr, "%s\n", e.what());
+    exit(1);
   }
+  stream.finalize();
+#if FTK_HAVE_NETCDF
+  delete nc_series;
+#endif
 
   tracker->finalize();
 
-  const auto &tg = tracker->get_tracking_graph();
-  tg.generate_dot_file("dot");
+  // with multiple processes, the complete tracking graph is on rank 0
+  if (diy::mpi::communicator().rank() == 0) {
+    const auto &tg = tracker->get_tracking_graph();
+    tg.generate_dot_file("dot");
+  }
 
   delete tracker;
 }
@@ -395,6 +455,8 @@ void write_outputs()
 
 int main(int argc, char **argv)
 {
+  diy::mpi::environment env(argc, argv);
+
   parse_arguments(argc, argv);
   track_levelset();
   return 0;
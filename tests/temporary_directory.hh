@@ -0,0 +1,63 @@
+#ifndef _FTK_TESTS_TEMPORARY_DIRECTORY_HH
+#define _FTK_TESTS_TEMPORARY_DIRECTORY_HH
+
+#include <gtest/gtest.h>
+#include <ftk/external/diy/mpi.hpp>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Tests with files in a temporary directory, removed after each test
+// with the files registered with path().  Tests run by several processes
+// call the shared variants in SetUp and TearDown instead: rank 0 makes
+// and removes the directory, and all processes use it.
+template <typename Base = testing::Test>
+class temporary_directory_test : public Base {
+public:
+  void SetUp() {make_directory();}
+  void TearDown() {remove_directory();}
+
+  std::string path(const std::string& name) { // of a file to be removed
+    files.push_back(dir + "/" + name);
+    return files.back();
+  }
+
+protected:
+  void make_directory() {
+    char d[] = "/tmp/ftk_test_XXXXXX";
+    ASSERT_TRUE(mkdtemp(d) != NULL);
+    dir = d;
+  }
+
+  void make_shared_directory(const diy::mpi::communicator& comm) {
+    // every process learns whether rank 0 succeeded before asserting, so
+    // that no process is left waiting in the broadcast
+    char d[] = "/tmp/ftk_test_XXXXXX";
+    int ok = 1;
+    if (comm.rank() == 0) ok = mkdtemp(d) != NULL;
+    std::vector<char> buf(d, d + sizeof(d));
+    diy::mpi::broadcast(comm, ok, 0);
+    diy::mpi::broadcast(comm, buf, 0);
+    ASSERT_TRUE(ok);
+    dir = buf.data();
+  }
+
+  void remove_directory() {
+    for (const auto &f : files)
+      remove(f.c_str());
+    if (!dir.empty()) rmdir(dir.c_str());
+  }
+
+  void remove_shared_directory(const diy::mpi::communicator& comm) {
+    comm.barrier();
+    if (comm.rank() == 0) remove_directory();
+  }
+
+protected:
+  std::string dir;
+  std::vector<std::string> files;
+};
+
+#endif
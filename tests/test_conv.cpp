@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <vector>
 #include <cmath>
+#include <random>
 #include <ftk/ndarray/conv.hh>
 #include <ftk/ndarray.hh>
 #include <ftk/numeric/rand.hh>
@@ -9,6 +10,9 @@ class conv_test : public testing::Test {
 public:
   const int nruns = 100000;
   const double epsilon = 1e-9;
+
+  std::mt19937 gen{0};
+  std::uniform_real_distribution<double> dist{-1.0, 1.0};
 };
 
 TEST_F(conv_test, 2D_conv_test) {
@@ -85,3 +89,105 @@ TEST_F(conv_test, 3D_conv_gaussian_test) {
   r.to_vector(res);
   EXPECT_EQ(res,ans);
 }
+
+TEST_F(conv_test, separable_conv_gaussian_test) {
+  ftk::ndarray<double> d({17, 13, 7});
+  for (size_t i = 0; i < d.nelem(); i ++)
+    d[i] = dist(gen);
+
+  const ftk::ndarray<double> d2 = d.slice_time(3);
+  const auto r2 = ftk::conv2D_gaussian(d2, 1.5, 5, 3, 2),
+             r2_direct = ftk::conv2D(d2, ftk::gaussian_kernel2D(1.5, 5, 3), 2);
+  ASSERT_EQ(r2.shape(), r2_direct.shape());
+  for (size_t i = 0; i < r2.nelem(); i ++)
+    EXPECT_NEAR(r2[i], r2_direct[i], epsilon);
+
+  const auto r3 = ftk::conv3D_gaussian(d, 2.0, 5, 5, 3, 1),
+             r3_direct = ftk::conv3D(d, ftk::gaussian_kernel3D(2.0, 5, 5, 3), 1);
+  ASSERT_EQ(r3.shape(), r3_direct.shape());
+  for (size_t i = 0; i < r3.nelem(); i ++)
+    EXPECT_NEAR(r3[i], r3_direct[i], epsilon);
+}
+
+TEST_F(conv_test, gaussian_filter_test) {
+  const size_t W = 23, H = 19;
+  const double sigma = 1.2;
+  const int r = 4;
+  ftk::ndarray<double> d({W, H});
+  for (size_t i = 0; i < d.nelem(); i ++)
+    d[i] = dist(gen);
+
+  // reference with replicated borders
+  const auto k = ftk::gaussian_kernel1D(sigma, 2*r+1);
+  auto clamp = [](int i, int n) {return std::min(std::max(i, 0), n-1);};
+  ftk::ndarray<double> ref({W, H});
+  for (int y = 0; y < H; y ++)
+    for (int x = 0; x < W; x ++)
+      for (int j = -r; j <= r; j ++)
+        for (int i = -r; i <= r; i ++)
+          ref(x, y) += k[i+r] * k[j+r] * d(clamp(x+i, W), clamp(y+j, H));
+
+  const auto res = ftk::gaussian_filter(d, sigma);
+  for (size_t i = 0; i < res.nelem(); i ++)
+    EXPECT_NEAR(res[i], ref[i], epsilon);
+}
+
+TEST_F(conv_test, recursive_gaussian_test) {
+  const size_t W = 256, H = 5;
+  const double sigma = 8.0;
+
+  // impulse response along both axes layouts
+  for (size_t axis = 0; axis < 2; axis ++) {
+    ftk::ndarray<double> d(axis == 0 ? std::vector<size_t>({W, H}) : std::vector<size_t>({H, W}));
+    for (size_t i = 0; i < H; i ++)
+      if (axis == 0) d(W/2, i) = 1.0; 
+      else d(i, W/2) = 1.0;
+    ftk::gaussian_filter1D_recursive(d, axis, sigma);
+
+    const double peak = 1.0 / (std::sqrt(2 * M_PI) * sigma);
+    for (size_t i = 0; i < H; i ++) {
+      double sum = 0;
+      for (size_t x = 0; x < W; x ++) {
+        const double v = axis == 0 ? d(x, i) : d(i, x);
+        const double g = peak * std::exp(-(x - W/2.0) * (x - W/2.0) / (2 * sigma * sigma));
+        EXPECT_NEAR(v, g, 0.03 * peak);
+        sum += v;
+      }
+      EXPECT_NEAR(sum, 1.0, 1e-6);
+    }
+  }
+
+  // constant fields are preserved
+  ftk::ndarray<double> c;
+  c.reshape({W, H}, 3.0);
+  const auto rc = ftk::gaussian_filter(c, 5.0);
+  for (size_t i = 0; i < rc.nelem(); i ++)
+    EXPECT_NEAR(rc[i], 3.0, epsilon);
+}
+
+TEST_F(conv_test, temporal_gaussian_filter_test) {
+  const size_t W = 8, H = 6, T = 9;
+  const double sigma = 0.9;
+  ftk::ndarray<double> d({W, H, T});
+  for (size_t i = 0; i < d.nelem(); i ++)
+    d[i] = dist(gen);
+  const ftk::ndarray<double> &cd = d;
+
+  const auto ref = ftk::gaussian_filter(cd.view(), std::vector<double>({0, 0, sigma}));
+
+  ftk::temporal_gaussian_filter<double> filter(sigma);
+  ftk::ndarray<double> out;
+  size_t t = 0;
+  auto check = [&]() {
+    ASSERT_EQ(out.shape(), std::vector<size_t>({W, H}));
+    const auto r = ref.slice_time(t ++);
+    for (size_t i = 0; i < out.nelem(); i ++)
+      EXPECT_NEAR(out[i], r[i], epsilon);
+  };
+
+  for (size_t k = 0; k < T; k ++)
+    if (filter.push(cd.slice_time_view(k), out)) check();
+  EXPECT_EQ(t, T - 3); // radius ceil(3 sigma)
+  while (filter.flush(out)) check();
+  EXPECT_EQ(t, T);
+}
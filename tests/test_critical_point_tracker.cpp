@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <ftk/filters/critical_point_tracker_2d_regular.hh>
+#include <ftk/ndarray/synthetic.hh>
+#include <fstream>
+#include <cstdlib>
+#include "temporary_directory.hh"
+
+class critical_point_tracker_test : public temporary_directory_test<> {
+public:
+  const size_t DW = 32, DH = 32, DT = 10;
+
+  // the directory is shared by all processes
+  void SetUp() {make_shared_directory(comm);}
+  void TearDown() {remove_shared_directory(comm);}
+
+  static std::string read_file(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  }
+
+  static size_t attribute(const std::string& content, const std::string& key) {
+    const size_t i = content.find(key + "=\"");
+    return i == std::string::npos ? 0 : std::stoul(content.substr(i + key.size() + 2));
+  }
+
+  diy::mpi::communicator comm;
+};
+
+TEST_F(critical_point_tracker_test, collective_pvtp) {
+  ftk::critical_point_tracker_2d_regular tracker;
+  tracker.set_domain(ftk::lattice({2, 2}, {DW-3, DH-3}));
+  tracker.set_array_domain(ftk::lattice({0, 0}, {DW, DH}));
+  tracker.set_input_array_partial(false);
+  tracker.set_scalar_field_source(ftk::SOURCE_GIVEN);
+  tracker.set_vector_field_source(ftk::SOURCE_DERIVED);
+  tracker.set_jacobian_field_source(ftk::SOURCE_DERIVED);
+  tracker.initialize();
+
+  for (size_t k = 0; k < DT; k ++) {
+    tracker.push_scalar_field_snapshot(ftk::synthetic_woven_2D<double>(DW, DH, double(k) / (DT - 1)));
+    if (k != 0) tracker.advance_timestep();
+  }
+  tracker.finalize();
+
+  const std::string single = path("a.vtp"), index = path("b.pvtp");
+  std::vector<std::string> pieces;
+  for (int p = 0; p < comm.size(); p ++)
+    pieces.push_back(path("b_" + std::to_string(p) + ".vtp"));
+
+  tracker.write_traced_critical_points_vtp(single);
+  tracker.write_traced_critical_points_vtp(index);
+  comm.barrier();
+
+  if (comm.rank() == 0) {
+    const std::string content = read_file(index);
+    for (int p = 0; p < comm.size(); p ++)
+      EXPECT_NE(content.find("<Piece Source=\"b_" + std::to_string(p) + ".vtp\"/>"), std::string::npos);
+    EXPECT_EQ(content.find("<Piece Source=\"b_" + std::to_string(comm.size()) + ".vtp\"/>"), std::string::npos);
+
+    // the pieces partition the trajectories of the single file
+    const std::string all = read_file(single);
+    size_t npoints = 0, nverts = 0, nlines = 0;
+    for (const auto &piece : pieces) {
+      const std::string c = read_file(piece);
+      ASSERT_FALSE(c.empty());
+      npoints += attribute(c, "NumberOfPoints");
+      nverts += attribute(c, "NumberOfVerts");
+      nlines += attribute(c, "NumberOfLines");
+    }
+    EXPECT_GT(attribute(all, "NumberOfPoints"), 0);
+    EXPECT_EQ(npoints, attribute(all, "NumberOfPoints"));
+    EXPECT_EQ(nverts, attribute(all, "NumberOfVerts"));
+    EXPECT_EQ(nlines, attribute(all, "NumberOfLines"));
+  }
+}
+
+int main(int argc, char **argv)
+{
+  diy::mpi::environment env(argc, argv);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
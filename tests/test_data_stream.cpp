@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <ftk/io/data_stream.hh>
+#include <ftk/ndarray/synthetic.hh>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include "temporary_directory.hh"
+
+class data_stream_test : public testing::Test {
+public:
+  const int DW = 16, DH = 12, DT = 20;
+};
+
+class data_stream_file_test : public temporary_directory_test<data_stream_test> {};
+
+TEST_F(data_stream_test, staging_order_and_history) {
+  std::atomic<int> in_flight(0), max_in_flight(0);
+
+  ftk::data_stream stream;
+  stream.set_number_of_timesteps(DT);
+  stream.set_number_of_threads(4);
+  stream.set_queue_capacity(3);
+  stream.set_history(3);
+  stream.set_reader([&](int k, ftk::data_group& g) {
+    const int n = ++ in_flight;
+    int m = max_in_flight;
+    while (n > m && !max_in_flight.compare_exchange_weak(m, n)) {}
+
+    // readers finish out of order
+    std::this_thread::sleep_for(std::chrono::milliseconds((k * 7) % 5));
+    ftk::ndarray<double> array;
+    array.reshape({size_t(DW), size_t(DH)}, double(k));
+    g.set("scalar", array);
+    in_flight --;
+  });
+  stream.initialize();
+
+  int t = 0;
+  while (stream.advance_timestep()) {
+    EXPECT_EQ(stream.get_current_timestep(), t);
+    EXPECT_EQ(stream.get<double>("scalar")(3, 4), t);
+    for (int offset = 1; offset < std::min(t+1, 3); offset ++)
+      EXPECT_EQ(stream.get<double>("scalar", offset)[0], t - offset);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1)); // slow consumer
+    t ++;
+  }
+  EXPECT_EQ(t, DT);
+  EXPECT_LE(max_in_flight, 3); // back-pressure
+  stream.finalize();
+}
+
+TEST_F(data_stream_test, early_finalize) {
+  ftk::data_stream stream;
+  stream.set_number_of_timesteps(1000);
+  stream.set_number_of_threads(2);
+  stream.set_reader([&](int k, ftk::data_group& g) {
+    g.set("scalar", ftk::ndarray<double>(std::vector<size_t>({size_t(DW)})));
+  });
+  stream.initialize();
+
+  EXPECT_TRUE(stream.advance_timestep());
+  stream.finalize(); // readers blocked on the full queue are released
+}
+
+TEST_F(data_stream_test, reader_exception) {
+  ftk::data_stream stream;
+  stream.set_number_of_timesteps(DT);
+  stream.set_number_of_threads(2);
+  stream.set_reader([&](int k, ftk::data_group& g) {
+    if (k == 3) throw std::runtime_error("unreadable timestep");
+    g.set("scalar", ftk::ndarray<double>(std::vector<size_t>({size_t(DW)})));
+  });
+  stream.initialize();
+
+  for (int t = 0; t < 3; t ++)
+    EXPECT_TRUE(stream.advance_timestep());
+  EXPECT_THROW(stream.advance_timestep(), std::runtime_error);
+
+  // the following timesteps are still delivered
+  EXPECT_TRUE(stream.advance_timestep());
+  EXPECT_EQ(stream.get_current_timestep(), 4);
+  stream.finalize();
+}
+
+TEST_F(data_stream_test, synthetic_json) {
+  ftk::json j = {{"type", "synthetic"}, {"name", "woven"},
+    {"width", DW}, {"height", DH}, {"n_timesteps", 5}, {"time_scale", 0.1}};
+  ftk::data_stream stream(j);
+  stream.set_number_of_threads(3);
+  stream.initialize();
+
+  int t = 0;
+  while (stream.advance_timestep()) {
+    EXPECT_EQ(stream.get<double>("scalar"), ftk::synthetic_woven_2D<double>(DW, DH, t * 0.1));
+    t ++;
+  }
+  EXPECT_EQ(t, 5);
+}
+
+TEST_F(data_stream_file_test, raw_files) {
+  std::vector<std::string> filenames;
+  for (int t = 0; t < 4; t ++) {
+    filenames.push_back(path(std::to_string(t) + ".raw"));
+    ftk::synthetic_woven_2D<float>(DW, DH, t * 0.1f).to_binary_file(filenames.back());
+  }
+
+  ftk::json j = {{"type", "file"}, {"format", "float32"}, {"filenames", filenames},
+    {"dimensions", {DW, DH}}, {"variables", {{{"name", "scalar"}}}}};
+  ftk::data_stream stream(j);
+  stream.set_number_of_threads(2);
+  stream.initialize();
+
+  for (int t = 0; t < 4; t ++) {
+    ASSERT_TRUE(stream.advance_timestep());
+    EXPECT_EQ(stream.get<double>("scalar"),
+        ftk::ndarray<double>(ftk::synthetic_woven_2D<float>(DW, DH, t * 0.1f).view()));
+  }
+  EXPECT_FALSE(stream.advance_timestep());
+}
+
+TEST_F(data_stream_test, shared_data_group) {
+  std::unique_ptr<ftk::data_group> g(ftk::data_group::create());
+
+  // moved in without copying
+  ftk::ndarray<float> a({size_t(DW), size_t(DH)});
+  const float *p = a.data();
+  g->set("a", std::move(a));
+  EXPECT_EQ(g->get<float>("a").data(), p);
+
+  // consumers share the array, which outlives the group
+  auto p0 = g->get_ptr<float>("a"), p1 = g->get_ptr<float>("a");
+  EXPECT_EQ(p0.get(), p1.get());
+  g->free("a");
+  EXPECT_FALSE(g->has("a"));
+  EXPECT_EQ(p0->data(), p);
+
+  // all numeric types
+  g->set("i8", ftk::ndarray<int8_t>(std::vector<size_t>({2})));
+  g->set("u16", ftk::ndarray<uint16_t>(std::vector<size_t>({2})));
+  g->set("u64", std::make_shared<ftk::ndarray<uint64_t>>(std::vector<size_t>({3})));
+  EXPECT_EQ(g->type("i8"), ftk::NDARRAY_TYPE_INT8);
+  EXPECT_EQ(g->type("u16"), ftk::NDARRAY_TYPE_UINT16);
+  EXPECT_EQ(g->type("u64"), ftk::NDARRAY_TYPE_UINT64);
+  EXPECT_EQ(g->get<uint64_t>("u64").nelem(), 3);
+  g->set("c", ftk::ndarray<char>(std::vector<size_t>({4})));
+  g->set("ll", ftk::ndarray<long long>(std::vector<size_t>({5})));
+  g->set("ull", ftk::ndarray<unsigned long long>(std::vector<size_t>({6})));
+  EXPECT_NE(g->type("c"), ftk::NDARRAY_TYPE_INT8);
+  EXPECT_NE(g->type("c"), ftk::NDARRAY_TYPE_UINT8);
+  EXPECT_NE(g->type("ll"), g->type("ull"));
+  EXPECT_EQ(g->get<char>("c").nelem(), 4);
+  EXPECT_EQ(g->get<long long>("ll").nelem(), 5);
+  EXPECT_EQ(g->get<unsigned long long>("ull").nelem(), 6);
+  EXPECT_EQ(g->type("none"), ftk::NDARRAY_TYPE_UNKNOWN);
+  EXPECT_EQ(g->get<double>("none").nd(), 0);
+  EXPECT_FALSE(g->get_ptr<double>("none"));
+
+  // staged arrays stay alive while held by a consumer
+  ftk::data_stream stream;
+  stream.set_number_of_timesteps(3);
+  stream.set_history(1);
+  stream.set_reader([&](int k, ftk::data_group& g) {
+    ftk::ndarray<double> array;
+    array.reshape({size_t(DW), size_t(DH)}, double(k));
+    g.set("scalar", std::move(array));
+  });
+  stream.initialize();
+  ASSERT_TRUE(stream.advance_timestep());
+  auto s0 = stream.get_ptr<double>("scalar");
+  while (stream.advance_timestep()) {}
+  EXPECT_EQ(s0.use_count(), 1);
+  EXPECT_EQ((*s0)[0], 0.0);
+}
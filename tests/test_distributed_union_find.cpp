@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <ftk/basic/distributed_integer_union_find.hh>
+#include <ftk/basic/integer_union_find.hh>
+#include <ftk/basic/duf.hh>
+#include <random>
+
+class distributed_union_find_test : public testing::Test {
+public:
+  const uint64_t n = 20000;
+};
+
+// elements are dealt round-robin; unions are made by the owners of their first elements
+TEST_F(distributed_union_find_test, integer_ids) {
+  diy::mpi::communicator world;
+  const int np = world.size(), rank = world.rank();
+  const uint64_t stride = uint64_t(1) << 33; // sparse 64-bit ids
+
+  std::vector<std::pair<uint64_t, uint64_t>> pairs;
+  std::mt19937_64 gen(0);
+  std::uniform_int_distribution<uint64_t> dist(0, n-1);
+  for (uint64_t k = 0; k < n * 3 / 4; k ++) {
+    const uint64_t i = dist(gen);
+    pairs.push_back(std::make_pair(i, i % 64 == 0 ? dist(gen) : (i + dist(gen) % 16) % n)); // mostly short-range
+  }
+
+  ftk::distributed_integer_union_find uf(world, [&](uint64_t i) {return int((i / stride) % np);});
+  for (uint64_t i = rank; i < n; i += np)
+    uf.add(i * stride);
+  for (const auto &p : pairs)
+    if (p.first % np == rank) uf.unite(p.first * stride, p.second * stride);
+  uf.exchange();
+  uf.print_stats();
+
+  ftk::dense_union_find<uint32_t> uf0(n); // roots are the smallest ids of the sets
+  for (const auto &p : pairs) uf0.unite(p.first, p.second);
+  std::vector<uint64_t> smallest(n, n);
+  for (uint64_t i = 0; i < n; i ++)
+    smallest[uf0.find(i)] = std::min(smallest[uf0.find(i)], i);
+
+  std::vector<uint64_t> ids, roots;
+  uf.get_roots(ids, roots);
+  EXPECT_EQ(ids.size(), (n - rank + np - 1) / np);
+  for (size_t k = 0; k < ids.size(); k ++)
+    EXPECT_EQ(roots[k], smallest[uf0.find(ids[k] / stride)] * stride);
+}
+
+// the same unions with the lightweight duf
+TEST_F(distributed_union_find_test, duf) {
+  diy::mpi::communicator world;
+  const int np = world.size(), rank = world.rank();
+
+  std::vector<std::pair<int, int>> pairs;
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> dist(0, n-1);
+  for (uint64_t k = 0; k < n / 2; k ++) {
+    const int i = dist(gen);
+    pairs.push_back(std::make_pair(i, (i + dist(gen) % 64) % n));
+  }
+
+  ftk::duf<int> uf;
+  uf.pid = [np](int i) {return i % np;};
+  for (const auto &p : pairs)
+    if (p.first % np == rank) uf.unite(p.first, p.second);
+  uf.exchange(world);
+
+  ftk::dense_union_find<uint32_t> uf0(n);
+  for (const auto &p : pairs) uf0.unite(p.first, p.second);
+  std::vector<int> smallest(n, n);
+  for (int i = 0; i < n; i ++)
+    smallest[uf0.find(i)] = std::min(smallest[uf0.find(i)], i);
+
+  std::vector<int> elements; // find() may add elements
+  for (const auto &kv : uf.parents) elements.push_back(kv.first);
+  for (const auto i : elements)
+    EXPECT_EQ(uf.find(i), smallest[uf0.find(i)]);
+}
+
+int main(int argc, char **argv)
+{
+  diy::mpi::environment env(argc, argv);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
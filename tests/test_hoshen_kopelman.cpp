@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <ftk/algorithms/hoshen_kopelman.hh>
+#include <ftk/algorithms/parallel_ccl.hh>
 #include <random>
 
 class hoshen_kopelman_test : public testing::Test {
@@ -32,3 +33,143 @@ TEST_F(hoshen_kopelman_test, hoshen_kopelman_2d)
   EXPECT_EQ(nc, 2);
   EXPECT_EQ(input, output);
 }
+
+// 6-connected components by breadth-first search, numbered in raster order
+static int bfs_ccl_3d(ftk::ndarray<int>& m)
+{
+  const int nx = m.dim(0), ny = m.dim(1), nz = m.dim(2);
+  std::vector<int> labels(m.nelem(), 0), queue;
+  int n = 0;
+  for (int i = 0; i < (int)m.nelem(); i ++) {
+    if (!m[i] || labels[i]) continue;
+    labels[i] = ++ n;
+    queue.assign(1, i);
+    for (size_t q = 0; q < queue.size(); q ++) {
+      const int j = queue[q], x = j % nx, y = (j / nx) % ny, z = j / (nx * ny);
+      const int neighbors[6][3] = {{x-1,y,z}, {x+1,y,z}, {x,y-1,z}, {x,y+1,z}, {x,y,z-1}, {x,y,z+1}};
+      for (const auto &p : neighbors) {
+        if (p[0] < 0 || p[0] >= nx || p[1] < 0 || p[1] >= ny || p[2] < 0 || p[2] >= nz) continue;
+        const int k = p[0] + nx * (p[1] + ny * p[2]);
+        if (m[k] && !labels[k]) {
+          labels[k] = n;
+          queue.push_back(k);
+        }
+      }
+    }
+  }
+  m.from_vector(labels);
+  return n;
+}
+
+TEST_F(hoshen_kopelman_test, parallel_ccl_3d)
+{
+  std::mt19937 gen(0);
+  for (const double density : {0.2, 0.35, 0.6}) {
+    std::bernoulli_distribution d(density);
+    ftk::ndarray<int> input({23, 17, 29});
+    for (size_t i = 0; i < input.nelem(); i ++)
+      input[i] = d(gen);
+
+    ftk::ndarray<int> expected = input;
+    const int n = bfs_ccl_3d(expected);
+
+    for (const int nthreads : {1, 3, 8, 64}) {
+      ftk::ndarray<int> output = input;
+      EXPECT_EQ(ftk::parallel_ccl_3d(output, nthreads), n);
+      EXPECT_EQ(output, expected);
+    }
+  }
+}
+
+TEST_F(hoshen_kopelman_test, parallel_ccl_2d)
+{
+  std::mt19937 gen(0);
+  for (const double density : {0.3, 0.5, 0.6, 0.8}) {
+    std::bernoulli_distribution d(density);
+    ftk::ndarray<int> input({57, 41});
+    for (size_t i = 0; i < input.nelem(); i ++)
+      input[i] = d(gen);
+
+    ftk::ndarray<int> expected = input;
+    const int n = hoshen_kopelman_2d(expected);
+
+    for (const int nthreads : {1, 2, 5, 64}) {
+      ftk::ndarray<int> output = input;
+      EXPECT_EQ(ftk::parallel_ccl_2d(output, nthreads), n);
+      EXPECT_EQ(output, expected);
+    }
+  }
+}
+
+TEST_F(hoshen_kopelman_test, parallel_ccl_bitmask)
+{
+  std::mt19937 gen(0);
+  std::uniform_real_distribution<float> d(0, 1);
+  const std::vector<std::vector<size_t>> shapes({{61, 37}, {13, 11, 19}});
+  for (const auto &shape : shapes) {
+    ftk::ndarray<float> input(shape);
+    for (size_t i = 0; i < input.nelem(); i ++)
+      input[i] = d(gen);
+
+    ftk::ndarray<int> expected(shape);
+    for (size_t i = 0; i < input.nelem(); i ++)
+      expected[i] = input[i] >= 0.4;
+
+    std::vector<uint64_t> bits;
+    ftk::threshold_bitmask<std::greater_equal<double>>(input.data(), input.nelem(), 0.4, bits, 3);
+    ASSERT_EQ(bits.size(), (input.nelem() + 63) / 64);
+    for (size_t i = 0; i < input.nelem(); i ++)
+      EXPECT_EQ((bits[i / 64] >> (i % 64)) & 1, expected[i]);
+    EXPECT_EQ(bits.back() >> (input.nelem() % 64), 0);
+
+    const int n = shape.size() == 2 ? hoshen_kopelman_2d(expected) : ftk::parallel_ccl_3d(expected, 1);
+    for (const int nthreads : {1, 4}) {
+      ftk::ndarray<int> output(shape);
+      EXPECT_EQ(ftk::parallel_ccl_bitmask(bits, shape, output.data(), nthreads), n);
+      EXPECT_EQ(output, expected);
+    }
+  }
+}
+
+TEST_F(hoshen_kopelman_test, component_attributes)
+{
+  std::mt19937 gen(1);
+  std::uniform_real_distribution<double> d(0, 1);
+  const std::vector<std::vector<size_t>> shapes({{31, 45}, {15, 9, 22}});
+  for (const auto &shape : shapes) {
+    ftk::ndarray<double> input(shape);
+    for (size_t i = 0; i < input.nelem(); i ++)
+      input[i] = d(gen);
+
+    std::vector<uint64_t> bits;
+    ftk::threshold_bitmask<std::less<double>>(input.data(), input.nelem(), 0.5, bits, 1);
+
+    for (const int nthreads : {1, 3, 8}) {
+      ftk::ndarray<int> labels(shape);
+      std::vector<ftk::component_attributes> attrs;
+      const int n = ftk::parallel_ccl_bitmask(bits, shape, labels.data(), nthreads, input.data(), &attrs);
+      ASSERT_EQ(attrs.size(), n);
+
+      // accumulated from the labels, in logical coordinates
+      std::vector<ftk::component_attributes> expected(n);
+      for (size_t i = 0; i < labels.nelem(); i ++) {
+        if (!labels[i]) continue;
+        const size_t x = i % shape[0], y = (i / shape[0]) % shape[1],
+                     z = shape.size() == 2 ? 0 : i / (shape[0] * shape[1]);
+        expected[labels[i] - 1].add(x, y, z, input[i]);
+      }
+
+      for (int k = 0; k < n; k ++) {
+        EXPECT_EQ(attrs[k].volume, expected[k].volume);
+        EXPECT_EQ(attrs[k].min, expected[k].min);
+        EXPECT_EQ(attrs[k].max, expected[k].max);
+        EXPECT_NEAR(attrs[k].mean(), expected[k].mean(), 1e-12);
+        for (int j = 0; j < 3; j ++) {
+          EXPECT_NEAR(attrs[k].centroid(j), expected[k].centroid(j), 1e-9);
+          EXPECT_EQ(attrs[k].lb[j], expected[k].lb[j]);
+          EXPECT_EQ(attrs[k].ub[j], expected[k].ub[j]);
+        }
+      }
+    }
+  }
+}
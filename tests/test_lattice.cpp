@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <ftk/hypermesh/lattice.hh>
+#include <ftk/hypermesh/regular_simplex_mesh.hh>
+#include <ftk/hypermesh/lattice_partitioner.hh>
+#include <sys/mman.h>
+
+class lattice_test : public testing::Test {
+public:
+  // 65536 x 65536 x 2 = 2^33 elements, well past both 2^31 and 2^32
+  const size_t DW = 65536, DH = 65536, DT = 2;
+  const size_t n = DW * DH * DT;
+};
+
+TEST_F(lattice_test, large_lattice_index) {
+  ftk::lattice l({0, 0, 0}, {DW, DH, DT});
+  EXPECT_EQ(l.n(), n);
+
+  const std::vector<int> last = {int(DW-1), int(DH-1), int(DT-1)};
+  EXPECT_EQ(l.to_integer(last), n-1);
+  EXPECT_EQ(l.from_integer(n-1), last);
+
+  const std::vector<int> idx = {12345, 54321, 1};
+  const uint64_t i = l.to_integer(idx);
+  EXPECT_EQ(i, 12345 + 54321 * DW + DW * DH);
+  EXPECT_EQ(l.from_integer(i), idx);
+}
+
+TEST_F(lattice_test, large_lattice_index_with_offset) {
+  ftk::lattice l({2, 2, 100}, {DW, DH, DT});
+  const std::vector<int> idx = {int(DW), int(DH), 101};
+  const uint64_t i = l.to_integer(idx);
+  EXPECT_EQ(i, (DW-2) + (DH-2) * DW + DW * DH);
+  EXPECT_EQ(l.from_integer(i), idx);
+}
+
+TEST_F(lattice_test, large_lattice_sparse_buffer) {
+  // sparse, mmap-backed buffer; only the touched pages are materialized
+  unsigned char *p = (unsigned char*)mmap(NULL, n, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) GTEST_SKIP();
+
+  ftk::lattice l({0, 0, 0}, {DW, DH, DT});
+  const std::vector<std::vector<int>> probes = {
+    {0, 0, 0}, {int(DW-1), 0, 0}, {0, int(DH-1), 0},
+    {7, 32768, 1}, {int(DW-1), int(DH-1), int(DT-1)}};
+
+  for (size_t k = 0; k < probes.size(); k ++)
+    p[l.to_integer(probes[k])] = k + 1;
+  for (size_t k = 0; k < probes.size(); k ++)
+    EXPECT_EQ(p[l.to_integer(probes[k])], k + 1);
+  EXPECT_EQ(p[n-1], probes.size());
+
+  munmap(p, n);
+}
+
+TEST_F(lattice_test, large_regular_simplex_mesh) {
+  ftk::regular_simplex_mesh m(3);
+  m.set_lb_ub({0, 0, 0}, {int(DW-1), int(DH-1), int(DT-1)});
+  EXPECT_EQ(m.n(0), n);
+  EXPECT_EQ(m.n(3), n * m.ntypes(3));
+
+  ftk::regular_simplex_mesh_element e(3, 2);
+  e.corner = {int(DW-2), int(DH-3), 1};
+  e.type = m.ntypes(2) - 1;
+
+  const uint64_t i = e.to_integer(m);
+  EXPECT_GT(i, uint64_t(1) << 32);
+
+  ftk::regular_simplex_mesh_element e1(3, 2);
+  e1.from_integer(m, i);
+  EXPECT_EQ(e, e1);
+}
+
+TEST_F(lattice_test, large_regular_simplex_mesh_work_index) {
+  ftk::regular_simplex_mesh m(3);
+  m.set_lb_ub({0, 0, 0}, {int(DW-1), int(DH-1), int(DT-1)});
+
+  // work indices of an ordinal sweep over the last timestep
+  ftk::lattice l({0, 0, DT-1}, {DW, DH, 1});
+  const size_t ntasks = l.n() * m.ntypes(2, ftk::ELEMENT_SCOPE_ORDINAL);
+  EXPECT_GT(ntasks, size_t(1) << 32);
+
+  for (size_t j : {size_t(0), ntasks / 3, ntasks - 1}) {
+    ftk::regular_simplex_mesh_element e(m, 2, j, l, ftk::ELEMENT_SCOPE_ORDINAL);
+    EXPECT_EQ(e.to_work_index(m, l, ftk::ELEMENT_SCOPE_ORDINAL), j);
+  }
+}
+
+TEST_F(lattice_test, partition_without_ghosts) {
+  ftk::lattice l({2, 3}, {20, 10});
+
+  for (const size_t np : {1, 4, 6}) {
+    ftk::lattice_partitioner partitioner(l);
+    partitioner.partition(np);
+    ASSERT_EQ(partitioner.np(), np);
+
+    size_t n = 0;
+    for (size_t i = 0; i < np; i ++) {
+      const auto &core = partitioner.get_core(i), &ext = partitioner.get_ext(i);
+      EXPECT_EQ(ext.starts(), core.starts());
+      EXPECT_EQ(ext.sizes(), core.sizes());
+      n += core.n();
+    }
+    EXPECT_EQ(n, l.n());
+  }
+
+  ftk::lattice_partitioner partitioner(l);
+  partitioner.partition(4, {4});
+  ASSERT_EQ(partitioner.np(), 4);
+  EXPECT_EQ(partitioner.get_ext(3).sizes(), partitioner.get_core(3).sizes());
+  EXPECT_EQ(partitioner.get_core(3).size(1), 10);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <ftk/filters/levelset_tracker.hh>
+
+class levelset_tracker_test : public testing::Test {
+public:
+};
+
+TEST_F(levelset_tracker_test, overlap_weights)
+{
+  // component 1 splits into 1 and 2; component 2 dies
+  const std::vector<uint32_t> labels0({
+    1,1,1,0,2,2,
+    1,1,1,0,0,0,
+    1,1,0,0,0,0}),
+  labels1({
+    1,1,0,0,0,0,
+    1,0,0,2,0,0,
+    0,0,0,2,2,0});
+
+  for (const int nthreads : {1, 4}) {
+    ftk::connected_component_tracker<> tracker;
+    tracker.set_number_of_threads(nthreads);
+    tracker.push_labeled_data_snapshot(labels0);
+    tracker.advance_timestep();
+    tracker.push_labeled_data_snapshot(labels1);
+    tracker.advance_timestep();
+
+    const auto &tg = tracker.get_tracking_graph();
+    EXPECT_EQ(tg.get_edge_weight(0, 1, 1, 1), 3);
+    EXPECT_EQ(tg.get_edge_weight(0, 1, 1, 2), 0);
+    EXPECT_FALSE(tg.has_edge(0, 2, 1, 1));
+  }
+}
+
+TEST_F(levelset_tracker_test, event_weights)
+{
+  ftk::tracking_graph<size_t, uint32_t, size_t, size_t> tg;
+  tg.add_edge(0, 1, 1, 1, 3); // 1 and 2 merge into 1
+  tg.add_edge(0, 2, 1, 1, 1);
+  tg.add_edge(0, 2, 1, 1, 1);
+  tg.add_edge(0, 3, 1, 2, 4); // no event
+
+  tg.detect_events();
+  const auto &events = tg.get_events().at(0);
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_EQ(events[0].type(), ftk::FTK_EVENT_MERGE);
+  EXPECT_EQ(events[0].lhs_weight(1), 3);
+  EXPECT_EQ(events[0].lhs_weight(2), 2);
+  EXPECT_EQ(events[0].rhs_weight(1), 5);
+}
+
+TEST_F(levelset_tracker_test, node_attributes)
+{
+  ftk::ndarray<double> field({4, 3});
+  field.fill({
+    0.9, 0.8, 0.0, 0.0,
+    0.7, 0.0, 0.0, 0.6,
+    0.0, 0.0, 0.5, 0.9});
+
+  ftk::levelset_tracker<> tracker;
+  tracker.set_threshold(0.5);
+  tracker.push_scalar_field_data_snapshot(field);
+
+  const auto &tg = tracker.get_tracking_graph();
+  ASSERT_TRUE(tg.has_node_attributes(0, 1));
+  ASSERT_TRUE(tg.has_node_attributes(0, 2));
+  EXPECT_FALSE(tg.has_node_attributes(0, 3));
+
+  const auto a1 = tg.get_node_attributes(0, 1), a2 = tg.get_node_attributes(0, 2);
+  EXPECT_EQ(a1.volume, 3);
+  EXPECT_DOUBLE_EQ(a1.centroid(0), 1.0 / 3);
+  EXPECT_DOUBLE_EQ(a1.centroid(1), 1.0 / 3);
+  EXPECT_DOUBLE_EQ(a1.mean(), 0.8);
+  EXPECT_EQ(a1.ub[0], 1);
+  EXPECT_EQ(a1.ub[1], 1);
+
+  EXPECT_EQ(a2.volume, 3);
+  EXPECT_EQ(a2.lb[0], 2);
+  EXPECT_EQ(a2.lb[1], 1);
+  EXPECT_EQ(a2.ub[0], 3);
+  EXPECT_EQ(a2.ub[1], 2);
+  EXPECT_DOUBLE_EQ(a2.min, 0.5);
+  EXPECT_DOUBLE_EQ(a2.max, 0.9);
+}
+
+// unless the input is partial, trackers are independent on every process,
+// so that the single-domain tests pass under mpiexec as well
+
+TEST_F(levelset_tracker_test, distributed_labels)
+{
+  // with any number of processes, each given its local array domain only,
+  // labels of the local domain are the same as those of a single process
+  const size_t nx = 23, ny = 17, nz = 11;
+  ftk::ndarray<double> field({nx, ny, nz});
+  ftk::ndarray<uint32_t> expected({nx, ny, nz});
+  for (size_t z = 0, i = 0; z < nz; z ++)
+    for (size_t y = 0; y < ny; y ++)
+      for (size_t x = 0; x < nx; x ++, i ++) {
+        field[i] = sin(0.7 * x) * cos(0.5 * y) + sin(0.9 * z + 0.3 * x);
+        expected[i] = field[i] >= 0.5;
+      }
+  const uint32_t n = ftk::parallel_ccl_3d(expected, 1);
+
+  ftk::levelset_tracker<> tracker;
+  tracker.set_threshold(0.5);
+  tracker.set_domain(field.get_lattice());
+  tracker.set_input_array_partial(true);
+  tracker.initialize();
+  tracker.push_scalar_field_data_snapshot(field.slice(tracker.get_local_array_domain()));
+
+  const auto &domain = tracker.get_local_domain();
+  const auto labels = tracker.get_last_labeled_array_snapshot();
+  for (size_t z = 0, i = 0; z < domain.size(2); z ++)
+    for (size_t y = 0; y < domain.size(1); y ++)
+      for (size_t x = 0; x < domain.size(0); x ++, i ++) {
+        const size_t j = (x + domain.start(0)) + nx * ((y + domain.start(1)) + ny * (z + domain.start(2)));
+        ASSERT_EQ(labels[i], expected[j]);
+      }
+
+  if (diy::mpi::communicator().rank() == 0) { // where the graph is
+    const auto &tg = tracker.get_tracking_graph();
+    std::vector<size_t> volumes(n, 0);
+    for (size_t i = 0; i < expected.nelem(); i ++)
+      if (expected[i]) volumes[expected[i] - 1] ++;
+    for (uint32_t l = 1; l <= n; l ++) {
+      ASSERT_TRUE(tg.has_node_attributes(0, l));
+      EXPECT_EQ(tg.get_node_attributes(0, l).volume, volumes[l - 1]);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  diy::mpi::environment env(argc, argv);
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,604 @@
+#include <gtest/gtest.h>
+#include <ftk/ndarray.hh>
+#include <ftk/ndarray/grad.hh>
+#include <ftk/ndarray/synthetic.hh>
+#include <ftk/io/vtp.hh>
+#include <sys/mman.h>
+#include <fstream>
+#include <cstdlib>
+#include <sstream>
+#include <cmath>
+#include "temporary_directory.hh"
+
+class ndarray_test : public testing::Test {
+public:
+  const size_t DW = 16, DH = 12, DT = 5;
+
+  ftk::ndarray<double> spacetime() const {
+    ftk::ndarray<double> array({DW, DH, DT});
+    for (size_t i = 0; i < array.nelem(); i ++)
+      array[i] = i;
+    return array;
+  }
+};
+
+// tests with files in a temporary directory, removed after each test
+class ndarray_file_test : public temporary_directory_test<ndarray_test> {};
+
+TEST_F(ndarray_test, slice_time_view) {
+  const auto array = spacetime();
+
+  for (size_t t = 0; t < DT; t ++) {
+    auto v = array.slice_time_view(t);
+    EXPECT_EQ(v.shape(), std::vector<size_t>({DW, DH}));
+    EXPECT_TRUE(v.is_contiguous());
+    EXPECT_EQ(v.data(), array.data() + t * DW * DH); // zero-copy
+    EXPECT_EQ(ftk::ndarray<double>(v), array.slice_time(t));
+  }
+}
+
+TEST_F(ndarray_test, slice_view) {
+  const auto array = spacetime();
+  const ftk::lattice l({3, 2, 1}, {5, 4, 3});
+
+  auto v = array.slice_view(l);
+  EXPECT_EQ(v.shape(), l.sizes());
+  EXPECT_FALSE(v.is_contiguous());
+  EXPECT_EQ(&v(0, 0, 0), &array(3, 2, 1));
+  EXPECT_EQ(v(4, 3, 2), array(7, 5, 3));
+
+  // nested slicing composes offsets and keeps the parent strides
+  auto v1 = v.slice_time(2).slice({1, 1}, {2, 2});
+  EXPECT_EQ(&v1(1, 1), &array(5, 4, 3));
+
+  const ftk::ndarray<double> copy(v);
+  for (size_t i = 0; i < l.n(); i ++)
+    EXPECT_EQ(copy[i], v[i]);
+  EXPECT_EQ(copy, array.slice(l));
+}
+
+TEST_F(ndarray_test, view_to_binary_file) {
+  const auto array = spacetime();
+  auto v = array.slice_view({1, 1, 0}, {4, 3, 2});
+
+  FILE *fp = tmpfile();
+  v.to_binary_file(fp);
+  rewind(fp);
+
+  ftk::ndarray<double> array1({4, 3, 2});
+  array1.from_binary_file(fp);
+  fclose(fp);
+
+  EXPECT_EQ(array1, ftk::ndarray<double>(v));
+}
+
+TEST_F(ndarray_test, gradient_of_view) {
+  ftk::ndarray<double> array({DW, DH, DT});
+  for (size_t t = 0; t < DT; t ++) {
+    auto s = ftk::synthetic_woven_2D<double>(DW, DH, double(t) / (DT - 1));
+    std::copy(s.data(), s.data() + s.nelem(), array.data() + t * DW * DH);
+  }
+
+  const auto &carray = array;
+  for (size_t t = 0; t < DT; t ++) {
+    const auto g = ftk::gradient2D(carray.slice_time_view(t)),
+               g1 = ftk::gradient2D(carray.slice_time(t));
+    EXPECT_EQ(g, g1);
+    EXPECT_EQ(ftk::jacobian2D(g.view()), ftk::jacobian2D(g1));
+  }
+}
+
+TEST_F(ndarray_test, large_external_view) {
+  // view of externally owned, sparse memory with 2^33 elements
+  const size_t W = 65536, H = 65536, T = 2, n = W * H * T;
+  unsigned char *p = (unsigned char*)mmap(NULL, n, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) GTEST_SKIP();
+
+  ftk::ndarray_view<unsigned char> v(p, {W, H, T});
+  EXPECT_EQ(v.nelem(), n);
+
+  auto v1 = v.slice_time(1);
+  EXPECT_EQ(v1.data(), p + W * H);
+  v1(W-1, H-1) = 42;
+  EXPECT_EQ(p[n-1], 42);
+
+  auto v2 = v.slice({W-2, H-2, 1}, {2, 2, 1});
+  EXPECT_EQ(v2(1, 1, 0), 42);
+  EXPECT_EQ(v2[3], 42);
+
+  munmap(p, n);
+}
+
+TEST_F(ndarray_test, npy_header) {
+  // header as written by numpy.save for a float32 array of shape (3, 4)
+  std::string dict = "{'descr': '<f4', 'fortran_order': False, 'shape': (3, 4), }";
+  dict.resize(128 - 10 - 1, ' ');
+  dict += '\n';
+  const std::string buf = std::string("\x93NUMPY\x01\x00\x76\x00", 10) + dict;
+
+  ftk::npy_header h;
+  ASSERT_TRUE(h.parse(buf.data(), buf.size()));
+  EXPECT_EQ(h.dtype, "f4");
+  EXPECT_EQ(h.offset, 128);
+  EXPECT_EQ(h.shape, std::vector<size_t>({3, 4}));
+  EXPECT_EQ(h.dims(), std::vector<size_t>({4, 3}));
+
+  const std::string buf1 = ftk::npy_header::make("f4", {4, 3});
+  EXPECT_EQ(buf1, buf);
+}
+
+TEST_F(ndarray_file_test, numpy_mmap) {
+  const std::string filename = path("a.npy");
+
+  ftk::ndarray<float> array({DW, DH, DT});
+  for (size_t i = 0; i < array.nelem(); i ++)
+    array[i] = i * 0.5f;
+  array.to_numpy(filename);
+
+  auto v = ftk::ndarray<float>::from_numpy_mmap(filename);
+  ASSERT_EQ(v.shape(), array.shape());
+  EXPECT_TRUE(v.mapped() != nullptr);
+  EXPECT_EQ(ftk::ndarray<float>(v), array);
+
+  // slices keep the mapping alive
+  auto v1 = v.slice_time(DT-1).slice({2, 3}, {4, 4});
+  v = ftk::ndarray_view<const float>();
+  v1.advise(ftk::FTK_ACCESS_WILLNEED);
+  EXPECT_EQ(v1(1, 2), array(3, 5, DT-1));
+
+  ftk::ndarray<double> array64; // converting read
+  array64.from_numpy(filename);
+  EXPECT_EQ(array64.shape(), array.shape());
+  EXPECT_EQ(array64(7, 5, 3), array(7, 5, 3));
+}
+
+TEST_F(ndarray_file_test, bov_and_raw_mmap) {
+  const std::string filename = path("a.bov");
+
+  const auto array = spacetime();
+  array.to_bov(filename);
+
+  ftk::bov_header h;
+  ASSERT_TRUE(h.parse(filename));
+  EXPECT_EQ(h.data_file, path("a.raw")); // the payload
+  EXPECT_EQ(h.dtype, "f8");
+  EXPECT_EQ(h.dims(), array.shape());
+
+  auto v = ftk::ndarray<double>::from_bov_mmap(filename, ftk::FTK_ACCESS_RANDOM);
+  EXPECT_EQ(ftk::ndarray<double>(v), array);
+
+  ftk::ndarray<float> array32;
+  array32.from_bov(filename);
+  EXPECT_EQ(array32(3, 4, 2), float(array(3, 4, 2)));
+
+  // raw binary with a byte offset, e.g. the payload of the bov file
+  auto v1 = ftk::ndarray<double>::from_binary_file_mmap(h.data_file, {DW, DH}, DW*DH*sizeof(double));
+  EXPECT_EQ(ftk::ndarray<double>(v1), array.slice_time(1));
+}
+
+TEST_F(ndarray_test, aligned_pooled_storage) {
+  auto &pool = ftk::ndarray_pool::instance();
+
+  ftk::ndarray<double> small({3, 5});
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(small.data()) % 64, 0);
+
+  const size_t n = 512; // 2 MiB of doubles
+  const double *p;
+  {
+    ftk::ndarray<double> large({n, n});
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(large.data()) % 64, 0);
+    p = large.data();
+  }
+
+  // the buffer of the next array of the same size class is recycled
+  const auto stats = pool.stats();
+  ftk::ndarray<double> large1({n, n - 1});
+  EXPECT_EQ(large1.data(), p);
+  EXPECT_EQ(pool.stats().reused, stats.reused + 1);
+  EXPECT_EQ(pool.stats().fresh, stats.fresh);
+  EXPECT_EQ(large1(n-1, n-2), 0.0); // still value-initialized
+  EXPECT_EQ(large1.std_vector().data(), large1.data()); // not a copy
+}
+
+TEST_F(ndarray_test, fused_gradient_jacobian) {
+  const auto &array = spacetime();
+  const auto s2 = array.slice_time_view(DT-1);
+
+  // reference: central differences through operator()
+  ftk::ndarray<double> g2({2, DW, DH});
+  for (size_t j = 1; j < DH-1; j ++)
+    for (size_t i = 1; i < DW-1; i ++) {
+      g2(0, i, j) = 0.5 * (s2(i+1, j) - s2(i-1, j)) * (DW-1);
+      g2(1, i, j) = 0.5 * (s2(i, j+1) - s2(i, j-1)) * (DH-1);
+    }
+  EXPECT_EQ(ftk::gradient2D(s2), g2);
+
+  // stale contents of reused buffers, including the borders, are overwritten
+  for (size_t block : {1, 3, 64}) {
+    ftk::ndarray<double> grad, J;
+    grad.reshape({2, DW, DH}, 42.0);
+    J.reshape({2, 2, DW, DH}, 42.0);
+    ftk::gradient_jacobian2D(s2, grad, J, block);
+    EXPECT_EQ(grad, g2);
+    EXPECT_EQ(J, ftk::jacobian2D(g2));
+  }
+
+  // 3D, on a strided subvolume
+  const ftk::ndarray<double> &carray = array;
+  const auto s3 = carray.slice_view({1, 2, 0}, {DW-3, DH-4, DT});
+  const ftk::ndarray<double> s3copy(s3);
+  for (size_t block : {1, 2, 16}) {
+    ftk::ndarray<double> grad, J;
+    grad.reshape({3, DW-3, DH-4, DT}, 42.0);
+    J.reshape({3, 3, DW-3, DH-4, DT}, 42.0);
+    ftk::gradient_jacobian3D(s3, grad, J, block);
+    EXPECT_EQ(grad, ftk::gradient3D(s3copy));
+    EXPECT_EQ(J, ftk::jacobian3D(grad));
+    EXPECT_EQ(grad(2, 3, 4, 2), 0.5 * (s3(3, 4, 3) - s3(3, 4, 1)));
+    EXPECT_EQ(J(1, 0, 2, 2, 2), 0.5 * (grad(1, 3, 2, 2) - grad(1, 1, 2, 2)));
+    EXPECT_EQ(J(1, 0, 1, 2, 2), 0.0);
+  }
+}
+
+TEST_F(ndarray_file_test, raw_subdomain) {
+  const std::string filename = path("a.raw");
+
+  const auto array = spacetime();
+  array.to_binary_file(filename);
+
+  // runs of partial rows, of full rows, and a single run
+  const std::vector<ftk::lattice> subs({
+      ftk::lattice({3, 2, 1}, {5, 4, 3}), 
+      ftk::lattice({0, 2, 1}, {DW, 4, 3}), 
+      ftk::lattice({0, 0, 2}, {DW, DH, 2})});
+  for (const auto &l : subs) {
+    ftk::ndarray<double> sub;
+    sub.from_binary_file(filename, array.shape(), l);
+    EXPECT_EQ(sub, array.slice(l));
+  }
+
+  // with a byte offset
+  ftk::ndarray<double> sub;
+  sub.from_binary_file(filename, {DW, DH}, ftk::lattice({1, 1}, {4, 3}), DW*DH*sizeof(double));
+  EXPECT_EQ(sub, array.slice_time(1).slice(ftk::lattice({1, 1}, {4, 3})));
+}
+
+#if FTK_HAVE_HDF5
+TEST_F(ndarray_file_test, h5_hyperslab) {
+  const std::string filename = path("a.h5");
+
+  const auto array = spacetime();
+  { // the last hdf5 dimension varies fastest
+    const hsize_t h5dims[3] = {DT, DH, DW};
+    auto fid = H5Fcreate(filename.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    auto sid = H5Screate_simple(3, h5dims, NULL);
+    auto did = H5Dcreate2(fid, "/data", H5T_NATIVE_DOUBLE, sid, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    H5Dwrite(did, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, array.data());
+    H5Dclose(did);
+    H5Sclose(sid);
+    H5Fclose(fid);
+  }
+
+  const ftk::lattice l({3, 2, 1}, {5, 4, 3});
+  ftk::ndarray<float> sub;
+  sub.from_h5(filename, "/data", l);
+  EXPECT_EQ(sub.shape(), l.sizes());
+  EXPECT_EQ(sub(0, 0, 0), float(array(3, 2, 1)));
+  EXPECT_EQ(sub(4, 3, 2), float(array(7, 5, 3)));
+}
+#endif
+
+// writes a vti file in the layout of vtkXMLImageDataWriter, with a scalar 
+// float64 array "s" and a float32 vector array "v"
+static void write_vti(const std::string& filename, 
+    const ftk::ndarray<double>& s, const ftk::ndarray<float>& v,
+    const std::string& format, bool compressed, bool uint64_header)
+{
+  auto base64 = [](const std::string& in) {
+    const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < in.size(); i += 3) {
+      uint32_t b = (uint8_t(in[i]) << 16);
+      if (i + 1 < in.size()) b |= uint8_t(in[i+1]) << 8;
+      if (i + 2 < in.size()) b |= uint8_t(in[i+2]);
+      out += alphabet[(b >> 18) & 63];
+      out += alphabet[(b >> 12) & 63];
+      out += i + 1 < in.size() ? alphabet[(b >> 6) & 63] : '=';
+      out += i + 2 < in.size() ? alphabet[b & 63] : '=';
+    }
+    return out;
+  };
+  auto header_value = [&](size_t x) {
+    if (uint64_header) { uint64_t y = x; return std::string((const char*)&y, 8); }
+    else { uint32_t y = x; return std::string((const char*)&y, 4); }
+  };
+  auto encode = [&](const std::string& data) { // binary encoding of an array
+    std::string header, blocks;
+    if (!compressed) header = header_value(data.size());
+#if FTK_HAVE_ZLIB
+    else {
+      const size_t bs = 256; // small blocks to have many of them
+      const size_t nb = (data.size() + bs - 1) / bs;
+      header = header_value(nb) + header_value(bs) + header_value(data.size() % bs);
+      for (size_t i = 0; i < nb; i ++) {
+        const size_t len = std::min(bs, data.size() - i*bs);
+        std::string c(compressBound(len), 0);
+        uLongf clen = c.size();
+        compress2((Bytef*)&c[0], &clen, (const Bytef*)data.data() + i*bs, len, 6);
+        header += header_value(clen);
+        blocks += c.substr(0, clen);
+      }
+    }
+#endif
+    if (format == "raw") return header + (compressed ? blocks : data);
+    else if (compressed) return base64(header) + base64(blocks);
+    else return base64(header + data);
+  };
+
+  const std::string ds((const char*)s.data(), s.nelem() * sizeof(double)),
+                    dv((const char*)v.data(), v.nelem() * sizeof(float));
+  const std::string es = encode(ds), ev = encode(dv);
+
+  auto ascii = [](const double *p, size_t n) {
+    std::ostringstream ss;
+    ss.precision(17);
+    for (size_t i = 0; i < n; i ++) ss << p[i] << (i % 6 == 5 ? "\n" : " ");
+    return ss.str();
+  };
+  std::vector<double> vd(v.data(), v.data() + v.nelem());
+
+  std::ofstream out(filename, std::ios::binary);
+  out << "<?xml version=\"1.0\"?>\n"
+      << "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"" 
+      << (uint64_header ? "UInt64" : "UInt32") << "\"" 
+      << (compressed ? " compressor=\"vtkZLibDataCompressor\"" : "") << ">\n"
+      << "  <ImageData WholeExtent=\"0 " << s.dim(0)-1 << " 0 " << s.dim(1)-1 << " 0 " << s.dim(2)-1 
+      << "\" Origin=\"0 0 0\" Spacing=\"1 1 1\">\n"
+      << "  <Piece Extent=\"0 " << s.dim(0)-1 << " 0 " << s.dim(1)-1 << " 0 " << s.dim(2)-1 << "\">\n"
+      << "    <PointData Scalars=\"s\">\n";
+  if (format == "raw" || format == "base64") {
+    out << "      <DataArray type=\"Float64\" Name=\"s\" format=\"appended\" RangeMin=\"0\" RangeMax=\"1\" offset=\"0\"/>\n"
+        << "      <DataArray type=\"Float32\" Name=\"v\" NumberOfComponents=\"3\" format=\"appended\" offset=\"" << es.size() << "\"/>\n";
+  } else if (format == "binary") {
+    out << "      <DataArray type=\"Float64\" Name=\"s\" format=\"binary\">\n        " << es << "\n      </DataArray>\n"
+        << "      <DataArray type=\"Float32\" Name=\"v\" NumberOfComponents=\"3\" format=\"binary\">\n        " << ev << "\n      </DataArray>\n";
+  } else { // ascii
+    out << "      <DataArray type=\"Float64\" Name=\"s\" format=\"ascii\">\n" << ascii(s.data(), s.nelem()) << "      </DataArray>\n"
+        << "      <DataArray type=\"Float32\" Name=\"v\" NumberOfComponents=\"3\" format=\"ascii\">\n" << ascii(vd.data(), vd.size()) << "      </DataArray>\n";
+  }
+  out << "    </PointData>\n    <CellData>\n    </CellData>\n  </Piece>\n  </ImageData>\n";
+  if (format == "raw" || format == "base64")
+    out << "  <AppendedData encoding=\"" << format << "\">\n   _" << es << ev << "\n  </AppendedData>\n";
+  out << "</VTKFile>\n";
+}
+
+TEST_F(ndarray_file_test, native_vti) {
+  const std::string filename = path("a.vti");
+
+  ftk::ndarray<double> s({DW, DH, DT}); // the third dimension is z
+  ftk::ndarray<float> v({3, DW, DH, DT});
+  for (size_t i = 0; i < s.nelem(); i ++) s[i] = std::sin(i * 0.1);
+  for (size_t i = 0; i < v.nelem(); i ++) v[i] = std::cos(i * 0.1);
+
+  struct config {std::string format; bool compressed, uint64_header;};
+  std::vector<config> configs({
+    {"raw", false, false}, {"raw", false, true}, {"base64", false, false},
+    {"binary", false, true}, {"ascii", false, false}});
+#if FTK_HAVE_ZLIB
+  configs.push_back({"raw", true, false});
+  configs.push_back({"raw", true, true});
+  configs.push_back({"base64", true, false});
+  configs.push_back({"binary", true, true});
+#endif
+
+  for (const auto &c : configs) {
+    SCOPED_TRACE(c.format + (c.compressed ? " zlib" : "") + (c.uint64_header ? " uint64" : ""));
+    write_vti(filename, s, v, c.format, c.compressed, c.uint64_header);
+
+    ftk::ndarray<double> s1, v1; 
+    s1.from_vti(filename, "s");
+    v1.from_vti(filename, "v");
+    EXPECT_EQ(s1, s);
+    EXPECT_EQ(v1.shape(), v.shape());
+    EXPECT_EQ(ftk::ndarray<float>(v1.view()), v);
+
+    ftk::ndarray<double> s2;
+    s2.from_vtk_image_data_file(filename); // the first array
+    EXPECT_EQ(s2, s);
+  }
+}
+
+// a 4x3x2 image with a float32 scalar array "s" and a float64 vector array
+// "v", in the layout of vtkXMLImageDataWriter (VTK 9), including the
+// Direction and RangeMin/RangeMax attributes and the InformationKey
+// children of the vector array
+static const char *vtk_ascii_vti =
+    "<?xml version=\"1.0\"?>\n"
+    "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+    "  <ImageData WholeExtent=\"0 3 0 2 0 1\" Origin=\"0 0 0\" Spacing=\"1 1 1\" Direction=\"1 0 0 0 1 0 0 0 1\">\n"
+    "  <Piece Extent=\"0 3 0 2 0 1\">\n"
+    "    <PointData Scalars=\"s\" Vectors=\"v\">\n"
+    "      <DataArray type=\"Float32\" Name=\"s\" format=\"ascii\" RangeMin=\"0\" RangeMax=\"11.5\">\n"
+    "        0 0.5 1 1.5 2 2.5\n"
+    "        3 3.5 4 4.5 5 5.5\n"
+    "        6 6.5 7 7.5 8 8.5\n"
+    "        9 9.5 10 10.5 11 11.5\n"
+    "      </DataArray>\n"
+    "      <DataArray type=\"Float64\" Name=\"v\" NumberOfComponents=\"3\" format=\"ascii\" RangeMin=\"0.25\" RangeMax=\"51.430171106\">\n"
+    "        <InformationKey name=\"L2_NORM_RANGE\" location=\"vtkDataArray\" length=\"2\">\n"
+    "          <Value index=\"0\">\n"
+    "            0.25\n"
+    "          </Value>\n"
+    "          <Value index=\"1\">\n"
+    "            51.430171106\n"
+    "          </Value>\n"
+    "        </InformationKey>\n"
+    "        0 0 0.25 1 2 0.25\n"
+    "        2 4 0.25 3 6 0.25\n"
+    "        4 8 0.25 5 10 0.25\n"
+    "        6 12 0.25 7 14 0.25\n"
+    "        8 16 0.25 9 18 0.25\n"
+    "        10 20 0.25 11 22 0.25\n"
+    "        12 24 0.25 13 26 0.25\n"
+    "        14 28 0.25 15 30 0.25\n"
+    "        16 32 0.25 17 34 0.25\n"
+    "        18 36 0.25 19 38 0.25\n"
+    "        20 40 0.25 21 42 0.25\n"
+    "        22 44 0.25 23 46 0.25\n"
+    "      </DataArray>\n"
+    "    </PointData>\n"
+    "    <CellData>\n"
+    "    </CellData>\n"
+    "  </Piece>\n"
+    "  </ImageData>\n"
+    "</VTKFile>\n";
+
+// the same image in appended raw form; the data are appended in the test
+static const char *vtk_appended_vti_header =
+    "<?xml version=\"1.0\"?>\n"
+    "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\">\n"
+    "  <ImageData WholeExtent=\"0 3 0 2 0 1\" Origin=\"0 0 0\" Spacing=\"1 1 1\" Direction=\"1 0 0 0 1 0 0 0 1\">\n"
+    "  <Piece Extent=\"0 3 0 2 0 1\">\n"
+    "    <PointData Scalars=\"s\" Vectors=\"v\">\n"
+    "      <DataArray type=\"Float32\" Name=\"s\" format=\"appended\" RangeMin=\"0\" RangeMax=\"11.5\" offset=\"0\"/>\n"
+    "      <DataArray type=\"Float64\" Name=\"v\" NumberOfComponents=\"3\" format=\"appended\" RangeMin=\"0.25\" RangeMax=\"51.430171106\" offset=\"104\">\n"
+    "        <InformationKey name=\"L2_NORM_RANGE\" location=\"vtkDataArray\" length=\"2\">\n"
+    "          <Value index=\"0\">\n"
+    "            0.25\n"
+    "          </Value>\n"
+    "          <Value index=\"1\">\n"
+    "            51.430171106\n"
+    "          </Value>\n"
+    "        </InformationKey>\n"
+    "      </DataArray>\n"
+    "    </PointData>\n"
+    "    <CellData>\n"
+    "    </CellData>\n"
+    "  </Piece>\n"
+    "  </ImageData>\n"
+    "  <AppendedData encoding=\"raw\">\n"
+    "   _";
+
+TEST_F(ndarray_file_test, vtk_written_vti) {
+  ftk::ndarray<float> s({4, 3, 2});
+  ftk::ndarray<double> v({3, 4, 3, 2});
+  for (size_t i = 0; i < s.nelem(); i ++) {
+    s[i] = i * 0.5f;
+    v[i*3] = i;
+    v[i*3+1] = 2 * i;
+    v[i*3+2] = 0.25;
+  }
+
+  std::string appended(vtk_appended_vti_header);
+  const uint64_t ns = s.nelem() * sizeof(float), nv = v.nelem() * sizeof(double);
+  appended += std::string((const char*)&ns, 8) + std::string((const char*)s.data(), ns)
+    + std::string((const char*)&nv, 8) + std::string((const char*)v.data(), nv)
+    + "\n  </AppendedData>\n</VTKFile>\n";
+
+  const std::vector<std::string> contents({vtk_ascii_vti, appended});
+  for (size_t k = 0; k < contents.size(); k ++) {
+    SCOPED_TRACE(k == 0 ? "ascii" : "appended raw");
+    const std::string filename = path(k == 0 ? "ascii.vti" : "appended.vti");
+    std::ofstream(filename, std::ios::binary) << contents[k];
+
+    ftk::ndarray<float> s1;
+    ftk::ndarray<double> v1;
+    s1.from_vti(filename, "s");
+    v1.from_vti(filename, "v");
+    EXPECT_EQ(s1, s);
+    EXPECT_EQ(v1, v);
+  }
+}
+
+TEST_F(ndarray_file_test, truncated_ascii_vti) {
+  // cut in the middle of the values of the last array
+  const std::string content(vtk_ascii_vti);
+  const size_t n = content.find("22 44 0.25");
+  ASSERT_NE(n, std::string::npos);
+
+  ftk::vti_header h;
+  ASSERT_TRUE(h.parse(content.data(), n));
+  std::vector<char> storage;
+  const char *bytes;
+  std::string dtype;
+  EXPECT_TRUE(h.decode(content.data(), n, *h.find("s"), storage, bytes, dtype));
+  EXPECT_FALSE(h.decode(content.data(), n, *h.find("v"), storage, bytes, dtype));
+}
+
+// decodes an appended array of a vtp file written by ftk::vtp_polydata
+static std::vector<char> read_vtp_array(const std::string& content, const std::string& section, const std::string& name)
+{
+  const size_t s = content.find("<" + section);
+  const size_t a = content.find("Name=\"" + name + "\"", s);
+  const size_t o = content.find("offset=\"", a) + 8;
+  const size_t pos = content.find('_', content.find("<AppendedData")) + 1 + std::stoul(content.substr(o));
+  const bool compressed = content.find("vtkZLibDataCompressor") != std::string::npos;
+
+  uint64_t h[3];
+  memcpy(h, &content[pos], sizeof(uint64_t) * (compressed ? 3 : 1));
+  if (!compressed) return std::vector<char>(&content[pos + 8], &content[pos + 8] + h[0]);
+
+  std::vector<char> data;
+#if FTK_HAVE_ZLIB
+  const uint64_t nblocks = h[0];
+  size_t p = pos + (3 + nblocks) * sizeof(uint64_t);
+  for (uint64_t i = 0; i < nblocks; i ++) {
+    uint64_t csize;
+    memcpy(&csize, &content[pos + (3 + i) * sizeof(uint64_t)], sizeof(csize));
+    uLongf len = (i == nblocks - 1) ? h[2] : h[1];
+    const size_t base = data.size();
+    data.resize(base + len);
+    uncompress(reinterpret_cast<Bytef*>(&data[base]), &len, reinterpret_cast<const Bytef*>(&content[p]), csize);
+    p += csize;
+  }
+#endif
+  return data;
+}
+
+TEST_F(ndarray_file_test, native_vtp) {
+  const std::string filename = path("a.vtp");
+
+  const size_t n = 10000; // multiple compression blocks
+  ftk::vtp_polydata poly;
+  poly.points.resize(n * 3);
+  for (size_t i = 0; i < poly.points.size(); i ++) poly.points[i] = std::sin(i * 0.1);
+  poly.verts_connectivity = {0};
+  poly.verts_offsets = {1};
+  for (size_t i = 1; i < n; i ++) poly.lines_connectivity.push_back(i);
+  poly.lines_offsets = {int64_t(n/2), int64_t(n-1)};
+  uint32_t *ids = poly.add_point_data<uint32_t>("id");
+  for (size_t i = 0; i < n; i ++) ids[i] = i < n/2 ? 0 : 1;
+
+  std::vector<bool> compressions({false});
+#if FTK_HAVE_ZLIB
+  compressions.push_back(true);
+#endif
+  for (const bool compressed : compressions) {
+    SCOPED_TRACE(compressed ? "zlib" : "raw");
+    ASSERT_TRUE(poly.write(filename, compressed));
+
+    std::ifstream in(filename, std::ios::binary);
+    const std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_NE(content.find("NumberOfPoints=\"10000\" NumberOfVerts=\"1\" NumberOfLines=\"2\""), std::string::npos);
+
+    auto points = read_vtp_array(content, "Points", "Points");
+    ASSERT_EQ(points.size(), n * 3 * sizeof(double));
+    EXPECT_EQ(memcmp(points.data(), poly.points.data(), points.size()), 0);
+
+    auto offsets = read_vtp_array(content, "Lines", "offsets");
+    ASSERT_EQ(offsets.size(), 2 * sizeof(int64_t));
+    EXPECT_EQ(reinterpret_cast<const int64_t*>(offsets.data())[1], n-1);
+
+    auto ids1 = read_vtp_array(content, "PointData", "id");
+    ASSERT_EQ(ids1.size(), n * sizeof(uint32_t));
+    EXPECT_EQ(memcmp(ids1.data(), ids, ids1.size()), 0);
+  }
+
+  const std::string index = path("a.pvtp");
+  ASSERT_TRUE(poly.write_pvtp(index, {"a_0.vtp", "a_1.vtp"}));
+  std::ifstream in(index);
+  const std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  EXPECT_NE(content.find("<PDataArray type=\"UInt32\" Name=\"id\"/>"), std::string::npos);
+  EXPECT_NE(content.find("<Piece Source=\"a_1.vtp\"/>"), std::string::npos);
+}
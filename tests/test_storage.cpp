@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <ftk/storage/native.h>
+#include <ftk/filters/critical_point.hh>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include "temporary_directory.hh"
+
+class storage_test : public temporary_directory_test<> {
+public:
+  void SetUp() {
+    temporary_directory_test<>::SetUp();
+    path("db/log"); // files of the database, removed before the database directory
+    path("db/index");
+    dbname = path("db");
+  }
+
+  static std::string value(int i) { // binary, with embedded zeros
+    std::string v(i % 100, '\0');
+    for (size_t j = 0; j < v.size(); j += 3) v[j] = char(i + j);
+    return v;
+  }
+
+  std::string dbname;
+};
+
+TEST_F(storage_test, put_get_reopen) {
+  {
+    ftk::storage_native db;
+    ASSERT_TRUE(db.open(dbname));
+    db.set_group_commit_bytes(1000);
+    for (int i = 0; i < 1000; i ++)
+      db.put("key" + std::to_string(i), value(i));
+    db.put("key7", std::string("overwritten"));
+
+    // both committed and buffered records are visible
+    EXPECT_EQ(db.get("key0"), value(0));
+    EXPECT_EQ(db.get("key999"), value(999));
+    EXPECT_EQ(db.get("key7"), "overwritten");
+    EXPECT_EQ(db.get("missing"), "");
+    EXPECT_FALSE(db.has("missing"));
+    EXPECT_EQ(db.size(), 1000);
+    db.close();
+  }
+
+  // with the checkpointed index, plus records appended afterwards
+  for (int pass = 0; pass < 2; pass ++) {
+    ftk::storage_native db;
+    ASSERT_TRUE(db.open(dbname));
+    EXPECT_EQ(db.size(), 1000 + pass);
+    for (int i = 0; i < 1000; i += 37) {
+      if (i != 7) {
+        EXPECT_EQ(db.get("key" + std::to_string(i)), value(i));
+      }
+    }
+    EXPECT_EQ(db.get("key7"), "overwritten");
+    if (pass == 0) db.put("appended", std::string("x"));
+    else EXPECT_EQ(db.get("appended"), "x");
+    db.flush();
+    if (pass == 0) { // no checkpoint; the index is rebuilt from the log
+      db.close();
+      remove((dbname + "/index").c_str());
+    }
+  }
+}
+
+TEST_F(storage_test, torn_tail) {
+  {
+    ftk::storage_native db;
+    ASSERT_TRUE(db.open(dbname));
+    for (int i = 0; i < 10; i ++)
+      db.put("key" + std::to_string(i), value(i + 50));
+  }
+  remove((dbname + "/index").c_str());
+
+  // a partially written record
+  FILE *fp = fopen((dbname + "/log").c_str(), "ab");
+  const char garbage[] = "\x10\x20\x30\x40\x03\x00\x00\x00\xff";
+  fwrite(garbage, 1, sizeof(garbage), fp);
+  fclose(fp);
+
+  ftk::storage_native db;
+  ASSERT_TRUE(db.open(dbname));
+  EXPECT_EQ(db.size(), 10);
+  db.put("after", std::string("recovery"));
+  db.close();
+
+  ASSERT_TRUE(db.open(dbname));
+  EXPECT_EQ(db.get("key9"), value(59));
+  EXPECT_EQ(db.get("after"), "recovery");
+}
+
+TEST_F(storage_test, concurrent_group_commit) {
+  const int nthreads = 8, n = 2000;
+
+  ftk::storage_native db;
+  ASSERT_TRUE(db.open(dbname));
+  db.set_group_commit_bytes(4096);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; t ++)
+    threads.push_back(std::thread([&, t]() {
+      for (int i = 0; i < n; i ++) {
+        const std::string key = std::to_string(t) + "/" + std::to_string(i);
+        db.put(key, value(i));
+        if (i % 10 == 0) { // read-your-writes
+          EXPECT_EQ(db.get(key), value(i));
+        }
+      }
+    }));
+  for (auto &th : threads) th.join();
+  db.close();
+
+  ASSERT_TRUE(db.open(dbname));
+  EXPECT_EQ(db.size(), nthreads * n);
+  for (int t = 0; t < nthreads; t ++)
+    for (int i = 0; i < n; i += 101)
+      EXPECT_EQ(db.get(std::to_string(t) + "/" + std::to_string(i)), value(i));
+}
+
+TEST_F(storage_test, batch_binary_multi_get) {
+  typedef ftk::critical_point_t<3, double> cp_t;
+  std::vector<cp_t> cps(100);
+  for (size_t i = 0; i < cps.size(); i ++) {
+    for (int j = 0; j < 3; j ++) cps[i].x[j] = i + j * 0.5;
+    cps[i].scalar = -double(i);
+    cps[i].type = i % 4;
+    cps[i].tag = i * 1000003;
+  }
+
+  ftk::storage_native db;
+  ASSERT_TRUE(db.open(dbname));
+  db.set_sync(true);
+
+  ftk::storage::batch b;
+  for (size_t i = 0; i < cps.size(); i ++)
+    b.put_bin("cp/" + std::to_string(i), cps[i]);
+  b.put_bin("cps", cps);
+  b.put("text", std::string("plain"));
+  db.write(b);
+  db.close();
+
+  ASSERT_TRUE(db.open(dbname));
+  std::vector<std::string> keys({"cp/3", "missing", "text", "cp/99"});
+  const auto vals = db.multi_get(keys);
+  ASSERT_EQ(vals.size(), keys.size());
+  EXPECT_EQ(vals[1], "");
+  EXPECT_EQ(vals[2], "plain");
+
+  cp_t cp;
+  ASSERT_TRUE(db.get_bin("cp/99", cp));
+  EXPECT_EQ(cp.x[2], 100.0);
+  EXPECT_EQ(cp.scalar, -99.0);
+  EXPECT_EQ(cp.type, 3u);
+  EXPECT_EQ(cp.tag, 99 * 1000003ull);
+  EXPECT_FALSE(db.get_bin("missing", cp));
+
+  std::vector<cp_t> cps1;
+  ASSERT_TRUE(db.get_bin("cps", cps1));
+  ASSERT_EQ(cps1.size(), cps.size());
+  EXPECT_EQ(cps1[42].tag, cps[42].tag);
+  EXPECT_EQ(cps1[42].x[1], cps[42].x[1]);
+}
@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
 #include <ftk/basic/union_find.hh>
 #include <ftk/basic/simple_union_find.hh>
+#include <ftk/basic/integer_union_find.hh>
+#include <ftk/basic/concurrent_union_find.hh>
+#include <thread>
+#include <random>
 #include <string>
 
 class union_find_test : public testing::Test {
@@ -42,3 +46,93 @@ TEST_F(union_find_test, simple_union_find) {
   EXPECT_TRUE(!UF.same_set(0, 1));
   EXPECT_TRUE(!UF.same_set(1, 5));
 }
+
+// test dense union-find and its CSR grouping against union_find
+TEST_F(union_find_test, dense_union_find) {
+  const int n = 1000;
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dist(0, n-1);
+
+  ftk::dense_union_find<uint32_t> UF(n);
+  ftk::union_find<int> UF0;
+  for (int i = 0; i < n; i ++) UF0.add(i);
+  for (int k = 0; k < n * 3 / 4; k ++) {
+    const int i = dist(gen), j = dist(gen);
+    EXPECT_EQ(UF.unite(i, j), !UF0.same_set(i, j));
+    UF0.unite(i, j);
+  }
+
+  std::vector<size_t> offsets;
+  std::vector<uint32_t> ids;
+  const size_t nsets = UF.get_sets(offsets, ids);
+  const auto sets0 = UF0.get_sets(); // ordered by the smallest roots, not members
+  ASSERT_EQ(nsets, sets0.size());
+  ASSERT_EQ(ids.size(), n);
+
+  std::set<std::set<int>> sets, expected(sets0.begin(), sets0.end());
+  for (size_t k = 0; k < nsets; k ++) {
+    if (k > 0) { // ordered by smallest members
+      EXPECT_LT(ids[offsets[k-1]], ids[offsets[k]]);
+    }
+    for (size_t j = offsets[k] + 1; j < offsets[k+1]; j ++)
+      EXPECT_LT(ids[j-1], ids[j]);
+    sets.insert(std::set<int>(ids.begin() + offsets[k], ids.begin() + offsets[k+1]));
+  }
+  EXPECT_EQ(sets, expected);
+}
+
+// test sparse union-find over integer keys
+TEST_F(union_find_test, sparse_union_find) {
+  ftk::sparse_union_find<uint64_t> UF;
+  const uint64_t big = uint64_t(1) << 40;
+  for (uint64_t i = 0; i < 100; i ++) 
+    EXPECT_EQ(UF.add(big * i + 7), i); // ids in order of addition, across rehashing
+  EXPECT_EQ(UF.add(big + 7), 1);
+  EXPECT_EQ(UF.size(), 100);
+
+  UF.unite(big + 7, 2 * big + 7);
+  UF.unite(2 * big + 7, 50 * big + 7);
+
+  EXPECT_TRUE(UF.has(50 * big + 7));
+  EXPECT_TRUE(!UF.has(50 * big));
+  EXPECT_EQ(UF.id(50 * big), UF.none);
+  EXPECT_TRUE(UF.same_set(big + 7, 50 * big + 7));
+  EXPECT_TRUE(!UF.same_set(7, big + 7));
+
+  std::vector<size_t> offsets;
+  std::vector<uint64_t> members;
+  EXPECT_EQ(UF.get_sets(offsets, members), 98);
+  EXPECT_EQ(offsets[2] - offsets[1], 3);
+  EXPECT_EQ(members[offsets[1] + 2], 50 * big + 7);
+}
+
+// test concurrent union-find with threads uniting random pairs
+TEST_F(union_find_test, concurrent_union_find) {
+  const int n = 100000, nthreads = 8;
+  std::vector<std::pair<int, int>> pairs;
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<int> dist(0, n-1);
+  for (int k = 0; k < n * 3 / 4; k ++)
+    pairs.push_back(std::make_pair(dist(gen), dist(gen)));
+
+  ftk::concurrent_union_find UF(n);
+  std::vector<std::thread> workers;
+  for (int tid = 0; tid < nthreads; tid ++)
+    workers.push_back(std::thread([&, tid]() {
+      for (size_t k = tid; k < pairs.size(); k += nthreads) {
+        UF.unite(pairs[k].first, pairs[k].second);
+        EXPECT_TRUE(UF.same_set(pairs[k].first, pairs[k].second));
+      }
+    }));
+  for (auto &w : workers) w.join();
+
+  ftk::dense_union_find<uint32_t> UF0(n);
+  for (const auto &p : pairs) UF0.unite(p.first, p.second);
+
+  std::vector<size_t> offsets, offsets0;
+  std::vector<uint64_t> ids;
+  std::vector<uint32_t> ids0;
+  EXPECT_EQ(UF.get_sets(offsets, ids), UF0.get_sets(offsets0, ids0));
+  EXPECT_EQ(offsets, offsets0);
+  EXPECT_TRUE(std::equal(ids.begin(), ids.end(), ids0.begin()));
+}